@@ -21,13 +21,15 @@ public:
     virtual void start_recording() = 0;
     virtual void stop_recording() = 0;
 
-    /// @brief This method should provide the pointer to the SamplesType structure containing
-    /// last acquired audio sample.
-    /// @param sample - pointer to the data structure where the last collected samples should  be placed
-    /// @return OK, if correct samples have been provided, Error code otherwise.
-    /// @note data should be acquired within a certain time limit after the data_ready callback. If delay
-    /// is too long, the microphone class is allowed to invalidate the data, error can be returned in this case.
-    virtual result::Result get_samples(SampleType& sample) = 0;
+    /// @brief Take the last collected audio sample in place (without a copy). Microphone doesn't reuse
+    /// the buffer of the sample, until it is returned with release_samples().
+    /// @return pointer to the last collected sample, nullptr if there is no new sample.
+    /// @note sample should be acquired within a certain time limit after the data_ready callback. If delay
+    /// is too long, the microphone class is allowed to reuse the buffer, nullptr is returned in this case.
+    virtual SampleType* acquire_samples() = 0;
+
+    /// @brief Return the buffer of the sample taken by acquire_samples() to the microphone.
+    virtual void release_samples() = 0;
 
     /// TODO: replace with a callable (check if std::function<..> is available for this purpose).
     using DataReadyCallback = std::function<void()>;
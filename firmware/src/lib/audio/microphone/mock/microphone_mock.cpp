@@ -13,11 +13,13 @@ void MicrophoneMock::start_recording() { }
 
 void MicrophoneMock::stop_recording() { }
 
-result::Result MicrophoneMock::get_samples(MockAudioSample& samples)
+MockAudioSample* MicrophoneMock::acquire_samples()
 {
-    return result::Result::ERROR_NOT_IMPLEMENTED;
+    return nullptr;
 }
 
+void MicrophoneMock::release_samples() { }
+
 void MicrophoneMock::register_data_ready_callback(DataReadyCallback callback) { }
 
 } // namespace audio
@@ -22,7 +22,8 @@ public:
     void init() override;
     void start_recording() override;
     void stop_recording() override;
-    result::Result get_samples(MockAudioSample& samples) override;
+    MockAudioSample* acquire_samples() override;
+    void release_samples() override;
 
     void register_data_ready_callback(DataReadyCallback callback) override;
 };
@@ -39,23 +39,51 @@ public:
     void start_recording() override;
     void stop_recording() override;
 
-    result::Result get_samples(SampleType& sample) override;
+    SampleType* acquire_samples() override;
+    void release_samples() override;
 
     using PdmDataReadyCallback = std::function<void()>;
     void register_data_ready_callback(PdmDataReadyCallback callback) override;
     void pdm_event_handler(const nrfx_pdm_evt_t* const p_evt);
 
+    /// @return amount of collected samples, that have been overwritten before the user acquired them
+    uint32_t get_lost_samples_count() const
+    {
+        return lost_samples_count_;
+    }
+
 private:
+    enum class BufferState : uint8_t
+    {
+        FREE,
+        /// being filled by the PDM or queued for the filling
+        DRIVER,
+        /// filled, waits for the user
+        READY,
+        /// acquired by the user
+        HELD,
+    };
+
     uint8_t clk_pin_;
     uint8_t data_pin_;
+    // The driver owns 2 buffers (active and queued), the third one is processed by the user meanwhile
     static constexpr size_t buffers_count{3U};
     static constexpr size_t buffer_size{SampleBufferSize /
                                         2}; // divided by 2, as the buffer element is 2 bytes
-    int16_t buffers_[buffers_count][buffer_size];
-    size_t previous_buffer_index_{0};
-    size_t current_buffer_index_{0};
-    int16_t* _released_buffer_ptr{nullptr};
+    // samples are consumed in place, so buffers are stored as samples (EasyDMA needs word alignment)
+    alignas(4) SampleType buffers_[buffers_count];
+    // changed both from the PDM interrupt and the user context
+    volatile BufferState buffer_states_[buffers_count]{};
+    size_t held_buffer_index_{0};
+    volatile uint32_t lost_samples_count_{0};
     PdmDataReadyCallback data_ready_callback{nullptr};
+
+    int16_t* get_buffer(size_t index)
+    {
+        return reinterpret_cast<int16_t*>(buffers_[index].data);
+    }
+    /// @return false, if there is no buffer that could be passed to the driver
+    bool set_next_buffer();
 };
 
 } // namespace microphone
@@ -34,26 +34,94 @@ void PdmMicrophone<SampleBufferSize>::init()
     }
 }
 
+template <size_t SampleBufferSize>
+bool PdmMicrophone<SampleBufferSize>::set_next_buffer()
+{
+    size_t next_index{buffers_count};
+    for (size_t i = 0; i < buffers_count; ++i)
+    {
+        if (buffer_states_[i] == BufferState::FREE)
+        {
+            next_index = i;
+            break;
+        }
+    }
+    if (next_index == buffers_count)
+    {
+        // the user holds the previous sample for too long, the last collected one is overwritten
+        for (size_t i = 0; i < buffers_count; ++i)
+        {
+            if (buffer_states_[i] == BufferState::READY)
+            {
+                next_index = i;
+                lost_samples_count_ = lost_samples_count_ + 1;
+                break;
+            }
+        }
+    }
+    if (next_index == buffers_count)
+    {
+        return false;
+    }
+    buffer_states_[next_index] = BufferState::DRIVER;
+    nrf_drv_pdm_buffer_set(get_buffer(next_index), buffer_size);
+    return true;
+}
+
 template <size_t SampleBufferSize>
 void PdmMicrophone<SampleBufferSize>::pdm_event_handler(const nrfx_pdm_evt_t * const p_evt)
 {
+    bool is_sample_ready{false};
+    if (p_evt->buffer_released != nullptr)
+    {
+        for (size_t i = 0; i < buffers_count; ++i)
+        {
+            if (buffer_states_[i] == BufferState::READY)
+            {
+                // the user has skipped the previous sample
+                buffer_states_[i] = BufferState::FREE;
+                lost_samples_count_ = lost_samples_count_ + 1;
+            }
+        }
+        for (size_t i = 0; i < buffers_count; ++i)
+        {
+            if (get_buffer(i) == p_evt->buffer_released)
+            {
+                buffer_states_[i] = BufferState::READY;
+                is_sample_ready = true;
+            }
+        }
+    }
     if (p_evt->buffer_requested)
     {
-        previous_buffer_index_ = current_buffer_index_;
-        current_buffer_index_ = (current_buffer_index_ + 1) % buffers_count;
-        nrf_drv_pdm_buffer_set(buffers_[current_buffer_index_], buffer_size);
-        data_ready_callback();
+        if (!set_next_buffer())
+        {
+            NRF_LOG_ERROR("pdm: no buffer for the driver");
+        }
     }
-    if (p_evt->buffer_released != nullptr)
+    if (is_sample_ready)
+    {
+        // the released sample could have been passed back to the driver
+        is_sample_ready = false;
+        for (size_t i = 0; i < buffers_count; ++i)
+        {
+            is_sample_ready = is_sample_ready || (buffer_states_[i] == BufferState::READY);
+        }
+    }
+    if (is_sample_ready && data_ready_callback)
     {
-        _released_buffer_ptr = p_evt->buffer_released;
+        data_ready_callback();
     }
 }
 
 template <size_t SampleBufferSize>
 void PdmMicrophone<SampleBufferSize>::start_recording() 
 {
-    nrf_drv_pdm_buffer_set(buffers_[current_buffer_index_], buffer_size);
+    for (size_t i = 0; i < buffers_count; ++i)
+    {
+        buffer_states_[i] = BufferState::FREE;
+    }
+    set_next_buffer();
 
     const auto start_result = nrf_drv_pdm_start();
     if (start_result != 0)
@@ -69,10 +137,32 @@ void PdmMicrophone<SampleBufferSize>::stop_recording()
 }
 
 template <size_t SampleBufferSize>
-result::Result PdmMicrophone<SampleBufferSize>::get_samples(SampleType& sample) 
+typename PdmMicrophone<SampleBufferSize>::SampleType* PdmMicrophone<SampleBufferSize>::acquire_samples()
+{
+    SampleType* sample{nullptr};
+    // state of the ready buffer shall not be changed by the interrupt in the middle
+    NVIC_DisableIRQ(PDM_IRQn);
+    for (size_t i = 0; i < buffers_count; ++i)
+    {
+        if (buffer_states_[i] == BufferState::READY)
+        {
+            buffer_states_[i] = BufferState::HELD;
+            held_buffer_index_ = i;
+            sample = &buffers_[i];
+            break;
+        }
+    }
+    NVIC_EnableIRQ(PDM_IRQn);
+    return sample;
+}
+
+template <size_t SampleBufferSize>
+void PdmMicrophone<SampleBufferSize>::release_samples()
 {
-    memcpy(sample.data, _released_buffer_ptr, SampleBufferSize);
-    return result::Result::OK;
+    if (buffer_states_[held_buffer_index_] == BufferState::HELD)
+    {
+        buffer_states_[held_buffer_index_] = BufferState::FREE;
+    }
 }
 
 template <size_t SampleBufferSize>
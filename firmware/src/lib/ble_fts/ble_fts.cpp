@@ -50,6 +50,7 @@ FtsService::Context FtsService::_context{0xDEADBEEF,
                                          {0, 0, 0, 0,},
                                          {0, 0, 0, 0,},
                                          {0, 0, 0, 0,},
+                                         {0, 0, 0, 0,},
                                          0,
                                          false,
                                          &_link_ctx_storage,
@@ -264,6 +265,19 @@ result::Result FtsService::init()
         return pairing_char_add_result;
     }
 
+    const auto diagnostics_char_add_result =
+        add_characteristic(BLE_UUID_TYPE_BLE,
+                           diagnostics_char_uuid,
+                           diagnostics_char_max_len,
+                           &_context.diagnostics,
+                           CharacteristicInUseType::READ_NOTIFY,
+                           true);
+
+    if(result::Result::OK != diagnostics_char_add_result)
+    {
+        return diagnostics_char_add_result;
+    }
+
     _context.conn_handle = BLE_CONN_HANDLE_INVALID;
 
     return result::Result::OK;
@@ -320,6 +334,11 @@ void FtsService::on_write(ble_evt_t const* p_ble_evt, ClientContext& client_cont
         client_context.is_status_notifications_enabled =
             ble_srv_is_notification_enabled(p_evt_write->data);
     }
+    else if((p_evt_write->handle == _context.diagnostics.cccd_handle) && (p_evt_write->len == 2))
+    {
+        client_context.is_diagnostics_notifications_enabled =
+            ble_srv_is_notification_enabled(p_evt_write->data);
+    }
     else if (p_evt_write->handle == _context.pairer.value_handle)
     {
         on_pairer_write(p_evt_write->len, p_evt_write->data);
@@ -378,6 +397,10 @@ void FtsService::on_control_point_write(const uint32_t len, const uint8_t* data)
         on_req_receive_complete(len - 1);
         break;
     }
+    case static_cast<int>(ControlPointOpcode::REQ_DIAGNOSTICS): {
+        on_req_diagnostics(len - 1, &data[1]);
+        break;
+    }
     default: {
         NRF_LOG_ERROR("cp.write: wrong opcode");
         // TODO: send a response to the client in order to notify it about an error.
@@ -448,6 +471,19 @@ void FtsService::on_req_receive_complete(uint32_t size)
     _context.pending_command = FtsService::ControlPointOpcode::REQ_RECEIVE_COMPLETE;
 }
 
+// Parameters: byte 0 - section id, byte 1 (optional) - reset flag
+void FtsService::on_req_diagnostics(const uint32_t data_size, const uint8_t* data)
+{
+    if(data_size == 0 || data_size > 2 || data == nullptr)
+    {
+        NRF_LOG_ERROR("cp.write: diagnostics request wrong size");
+        return;
+    }
+    _transaction_ctx.diagnostics_section = data[0];
+    _transaction_ctx.should_reset_diagnostics = (data_size == 2) && (data[1] != 0);
+    _context.pending_command = FtsService::ControlPointOpcode::REQ_DIAGNOSTICS;
+}
+
 void FtsService::on_connect(ble_evt_t const* p_ble_evt, ClientContext& client_context)
 {
     _context.conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
@@ -730,6 +766,27 @@ void FtsService::process_client_request(ControlPointOpcode client_request)
         _context.is_disconnect_requested = true;
         break;
     }
+    case FtsService::ControlPointOpcode::REQ_DIAGNOSTICS: {
+        NRF_LOG_DEBUG("ble::fts::processing diagnostics request");
+        if(_context.client_context == nullptr ||
+           !_context.client_context->is_diagnostics_notifications_enabled)
+        {
+            NRF_LOG_ERROR("ble::fts::diagnostics: notifications are not enabled. Aborting");
+            _context.pending_command = FtsService::ControlPointOpcode::IDLE;
+            return;
+        }
+
+        const auto result = send_diagnostics();
+        if(result != result::Result::OK)
+        {
+            NRF_LOG_ERROR("ble::fts::diagnostics send failed");
+            _context.pending_command = FtsService::ControlPointOpcode::IDLE;
+            return;
+        }
+        _context.active_command = _context.pending_command;
+        _context.pending_command = FtsService::ControlPointOpcode::IDLE;
+        break;
+    }
     default:
         break;
     }
@@ -990,6 +1047,44 @@ result::Result FtsService::send_fs_status()
     return result::Result::OK;
 }
 
+result::Result FtsService::send_diagnostics()
+{
+    static constexpr size_t size_field_size{2};
+    if(!_fs_if.diagnostics_get_function)
+    {
+        return result::Result::ERROR_NOT_IMPLEMENTED;
+    }
+
+    const auto diagnostics_result =
+        _fs_if.diagnostics_get_function(_transaction_ctx.diagnostics_section,
+                                        _transaction_ctx.should_reset_diagnostics,
+                                        &_transaction_ctx.buffer[size_field_size],
+                                        _transaction_ctx.size,
+                                        TransactionContext::buffer_size - size_field_size);
+    if(result::Result::OK != diagnostics_result)
+    {
+        NRF_LOG_ERROR("ble::fts::send diagnostics failed");
+        (void)update_general_status(GeneralStatus::GENERIC_ERROR, file_id_type());
+        return diagnostics_result;
+    }
+
+    _transaction_ctx.idx = 0;
+    _transaction_ctx.buffer[0] = static_cast<uint8_t>(_transaction_ctx.size & 0xFF);
+    _transaction_ctx.buffer[1] = static_cast<uint8_t>((_transaction_ctx.size >> 8) & 0xFF);
+    _transaction_ctx.size += size_field_size;
+
+    const auto push_result = push_data_packets(ControlPointOpcode::REQ_DIAGNOSTICS);
+    if(push_result == result::Result::OK)
+    {
+        NRF_LOG_DEBUG("ble::fts::diagnostics: sending %d bytes", _transaction_ctx.size);
+    }
+    else
+    {
+        NRF_LOG_ERROR("ble::fts::diagnostics: push has failed");
+    }
+    return result::Result::OK;
+}
+
 result::Result FtsService::update_general_status(GeneralStatus status,
                                                  ble::fts::file_id_type parameter)
 {
@@ -1076,7 +1171,8 @@ result::Result FtsService::push_data_packets(ControlPointOpcode opcode)
         : (opcode == ControlPointOpcode::REQ_FILES_LIST_NEXT)
             ? _context.files_list_next.value_handle
         : (opcode == ControlPointOpcode::GENERAL_STATUS) ? _context.status.value_handle
-                                                         : BLE_CONN_HANDLE_INVALID;
+        : (opcode == ControlPointOpcode::REQ_DIAGNOSTICS) ? _context.diagnostics.value_handle
+                                                          : BLE_CONN_HANDLE_INVALID;
 
     hvx_params.p_data = &_transaction_ctx.buffer[_transaction_ctx.idx];
     hvx_params.p_len = &_transaction_ctx.packet_size;
@@ -73,6 +73,9 @@ struct FileSystemInterface
     } __attribute__((packed));
     using fs_status_function_type = std::function<result::Result(FSStatus&)>;
     using receive_completion_type = std::function<void()>;
+    // Parameters: diagnostics section id, reset-after-read flag, output buffer, actual size, max size
+    using diagnostics_get_function_type =
+        std::function<result::Result(uint8_t, bool, uint8_t*, uint32_t&, uint32_t)>;
 
     file_list_get_function_type file_list_get_function;
     file_info_get_function_type file_info_get_function;
@@ -82,6 +85,7 @@ struct FileSystemInterface
     fs_status_function_type fs_status_function;
     file_list_get_next_function_type file_list_get_next_function;
     receive_completion_type receive_completed_function;
+    diagnostics_get_function_type diagnostics_get_function;
 };
 
 // TODO: consider replacing the glue structures above with a template
@@ -151,6 +155,7 @@ private:
     static constexpr uint32_t fs_status_char_uuid{0x1006};
     static constexpr uint32_t status_char_uuid{0x1007};
     static constexpr uint32_t file_list_next_char_uuid{0x1008};
+    static constexpr uint32_t diagnostics_char_uuid{0x1009};
     static constexpr uint32_t pairing_char_uuid{0x10FE};
 
     static constexpr uint32_t cp_char_max_len{17};
@@ -160,6 +165,7 @@ private:
     static constexpr uint32_t file_data_char_max_len{256};
     static constexpr uint32_t fs_status_char_max_len{14};
     static constexpr uint32_t status_char_max_len{17};
+    static constexpr uint32_t diagnostics_char_max_len{256};
     static constexpr uint32_t pairing_char_max_len{1};
 
     static constexpr uint8_t unpair_magic_value{0xAD};
@@ -173,6 +179,7 @@ private:
         REQ_FS_STATUS = 4,
         REQ_FILES_LIST_NEXT = 5,
         REQ_RECEIVE_COMPLETE = 6,
+        REQ_DIAGNOSTICS = 7,
 
         GENERAL_STATUS = 240,
 
@@ -185,7 +192,8 @@ private:
         return ControlPointOpcode::REQ_FILES_LIST == opcode ||
                ControlPointOpcode::REQ_FILE_INFO == opcode ||
                ControlPointOpcode::REQ_FILE_DATA == opcode ||
-               ControlPointOpcode::REQ_FS_STATUS == opcode;
+               ControlPointOpcode::REQ_FS_STATUS == opcode ||
+               ControlPointOpcode::REQ_DIAGNOSTICS == opcode;
     }
     struct ClientContext
     {
@@ -195,6 +203,7 @@ private:
         bool is_file_info_notifications_enabled{false};
         bool is_fs_status_notifications_enabled{false};
         bool is_status_notifications_enabled{false};
+        bool is_diagnostics_notifications_enabled{false};
     };
 
     // Canaries are added in the beginning of the structure, as I've noticed, that first 5-8 bytes 
@@ -214,6 +223,7 @@ private:
         ble_gatts_char_handles_t fs_status;
         ble_gatts_char_handles_t status;
         ble_gatts_char_handles_t pairer;
+        ble_gatts_char_handles_t diagnostics;
 
         uint16_t conn_handle;
         bool is_notification_enabled;
@@ -266,6 +276,7 @@ private:
     void on_req_file_data(uint32_t data_size, const uint8_t* file_id_data);
     void on_req_fs_status(uint32_t size);
     void on_req_receive_complete(uint32_t size);
+    void on_req_diagnostics(uint32_t data_size, const uint8_t* data);
 
     file_id_type get_file_id_from_raw(const uint8_t* data) const;
 
@@ -276,6 +287,7 @@ private:
     result::Result send_file_data();
     result::Result continue_sending_file_data();
     result::Result send_fs_status();
+    result::Result send_diagnostics();
 
     enum GeneralStatus : uint8_t
     {
@@ -303,6 +315,8 @@ private:
         uint32_t file_size{0};
         uint32_t file_sent_size{0};
         uint32_t files_count_left{0};
+        uint8_t diagnostics_section{0};
+        bool should_reset_diagnostics{false};
         void update_next_packet_size()
         {
             const auto leftover_size{size - idx};
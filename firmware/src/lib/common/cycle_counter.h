@@ -0,0 +1,36 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "nrf.h"
+
+#include <cstdint>
+
+namespace common
+{
+
+// Cycle counter of the core (DWT), for the measurements that need sub-tick resolution.
+// It wraps in ~67 s at 64 MHz, so intervals are limited to this duration.
+class CycleCounter
+{
+public:
+    static void enable()
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    static std::uint32_t now()
+    {
+        return DWT->CYCCNT;
+    }
+
+    static std::uint32_t to_us(const std::uint32_t cycles)
+    {
+        return cycles / (SystemCoreClock / 1000000UL);
+    }
+};
+
+} // namespace common
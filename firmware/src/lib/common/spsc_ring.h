@@ -0,0 +1,160 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace common
+{
+
+/// Lock-free ring of elements between a single producer and a single consumer (f.e. two tasks).
+/// Producer writes the element in place (acquire/commit) or copies it (push), consumer processes
+/// the oldest element in place (peek) and releases it (pop), so there is no copy out of the ring.
+/// Full ring drops the new elements, drops and the highest fill level are counted.
+/// Consumer can be notified when the fill level reaches a watermark, so it processes the elements in batches.
+template <typename T, uint32_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "ring capacity has to be a power of 2");
+
+public:
+    /// Called in the producer context
+    using NotifyFunction = void (*)();
+
+    struct Statistics
+    {
+        uint32_t pushed{0};
+        uint32_t dropped{0};
+        /// highest fill level, in elements
+        uint32_t high_water{0};
+    };
+
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing(SpscRing&&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    SpscRing& operator=(SpscRing&&) = delete;
+    ~SpscRing() = default;
+
+    static constexpr uint32_t capacity()
+    {
+        return Capacity;
+    }
+
+    // ===== Producer side
+
+    /// @return slot for the next element, nullptr if the ring is full (the element is counted as dropped)
+    T* acquire()
+    {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        if(head - _tail.load(std::memory_order_acquire) >= Capacity)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &_elements[head % Capacity];
+    }
+
+    /// Publish the element written into the slot returned by acquire()
+    void commit()
+    {
+        const uint32_t head = _head.load(std::memory_order_relaxed) + 1;
+        _head.store(head, std::memory_order_release);
+        _pushed.fetch_add(1, std::memory_order_relaxed);
+        // level grows by 1 per commit, so it can't pass the watermark without hitting it
+        const uint32_t level = head - _tail.load(std::memory_order_acquire);
+        if(level > _high_water.load(std::memory_order_relaxed))
+        {
+            _high_water.store(level, std::memory_order_relaxed);
+        }
+        if(level == _watermark && _notify != nullptr)
+        {
+            _notify();
+        }
+    }
+
+    /// @return false if the ring is full, the element is dropped then
+    bool push(const T& element)
+    {
+        T* slot = acquire();
+        if(slot == nullptr)
+        {
+            return false;
+        }
+        *slot = element;
+        commit();
+        return true;
+    }
+
+    // ===== Consumer side
+
+    /// @return the oldest element, nullptr if the ring is empty. It stays valid until pop().
+    const T* peek() const
+    {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if(tail == _head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &_elements[tail % Capacity];
+    }
+
+    /// Release the element returned by peek()
+    void pop()
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /// Drop all stored elements
+    void clear()
+    {
+        _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // ===== Any side
+
+    uint32_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    /// @brief Call notify each time the fill level reaches the given level. Has to be set before the producer starts.
+    void setWatermark(uint32_t level, NotifyFunction notify)
+    {
+        _watermark = level;
+        _notify = notify;
+    }
+
+    Statistics getStatistics() const
+    {
+        return Statistics{_pushed.load(std::memory_order_relaxed),
+                          _dropped.load(std::memory_order_relaxed),
+                          _high_water.load(std::memory_order_relaxed)};
+    }
+
+    /// Counters are updated by the producer, so values from an ongoing push may survive the reset
+    void resetStatistics()
+    {
+        _pushed.store(0, std::memory_order_relaxed);
+        _dropped.store(0, std::memory_order_relaxed);
+        _high_water.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    T _elements[Capacity];
+    // free-running counters, the index is taken modulo the capacity
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+
+    uint32_t _watermark{0};
+    NotifyFunction _notify{nullptr};
+
+    std::atomic<uint32_t> _pushed{0};
+    std::atomic<uint32_t> _dropped{0};
+    std::atomic<uint32_t> _high_water{0};
+};
+
+} // namespace common
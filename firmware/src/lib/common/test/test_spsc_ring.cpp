@@ -0,0 +1,155 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "spsc_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace common;
+
+struct Frame
+{
+    uint32_t sequence;
+    uint8_t data[60];
+};
+
+using Ring = SpscRing<Frame, 8>;
+
+static uint32_t notifications_count{0};
+static void count_notification()
+{
+    notifications_count++;
+}
+
+TEST(SpscRingTest, ElementsComeOutInOrder)
+{
+    Ring ring;
+    EXPECT_EQ(ring.peek(), nullptr);
+    for(uint32_t i = 0; i < 5; ++i)
+    {
+        EXPECT_TRUE(ring.push(Frame{i, {0}}));
+    }
+    EXPECT_EQ(ring.size(), 5U);
+    for(uint32_t i = 0; i < 5; ++i)
+    {
+        const Frame* frame = ring.peek();
+        ASSERT_NE(frame, nullptr);
+        EXPECT_EQ(frame->sequence, i);
+        ring.pop();
+    }
+    EXPECT_EQ(ring.peek(), nullptr);
+    EXPECT_EQ(ring.size(), 0U);
+}
+
+TEST(SpscRingTest, FullRingDropsNewElements)
+{
+    Ring ring;
+    for(uint32_t i = 0; i < Ring::capacity() + 3; ++i)
+    {
+        EXPECT_EQ(ring.push(Frame{i, {0}}), i < Ring::capacity());
+    }
+    auto statistics = ring.getStatistics();
+    EXPECT_EQ(statistics.pushed, Ring::capacity());
+    EXPECT_EQ(statistics.dropped, 3U);
+    EXPECT_EQ(statistics.high_water, Ring::capacity());
+    // the oldest elements are kept
+    EXPECT_EQ(ring.peek()->sequence, 0U);
+
+    ring.clear();
+    EXPECT_EQ(ring.size(), 0U);
+    ring.resetStatistics();
+    EXPECT_TRUE(ring.push(Frame{100, {0}}));
+    statistics = ring.getStatistics();
+    EXPECT_EQ(statistics.pushed, 1U);
+    EXPECT_EQ(statistics.dropped, 0U);
+    EXPECT_EQ(statistics.high_water, 1U);
+    EXPECT_EQ(ring.peek()->sequence, 100U);
+}
+
+TEST(SpscRingTest, ElementIsWrittenInPlace)
+{
+    Ring ring;
+    for(uint32_t i = 0; i < 3 * Ring::capacity(); ++i)
+    {
+        Frame* slot = ring.acquire();
+        ASSERT_NE(slot, nullptr);
+        slot->sequence = i;
+        EXPECT_EQ(ring.size(), 0U);
+        ring.commit();
+        EXPECT_EQ(ring.peek(), slot);
+        ring.pop();
+    }
+    EXPECT_EQ(ring.getStatistics().high_water, 1U);
+}
+
+TEST(SpscRingTest, ConsumerIsNotifiedAtWatermark)
+{
+    Ring ring;
+    notifications_count = 0;
+    ring.setWatermark(4, count_notification);
+    for(uint32_t i = 0; i < 3; ++i)
+    {
+        ring.push(Frame{i, {0}});
+    }
+    EXPECT_EQ(notifications_count, 0U);
+    ring.push(Frame{3, {0}});
+    EXPECT_EQ(notifications_count, 1U);
+    // above the watermark the consumer has been notified already
+    ring.push(Frame{4, {0}});
+    EXPECT_EQ(notifications_count, 1U);
+
+    while(ring.peek() != nullptr)
+    {
+        ring.pop();
+    }
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        ring.push(Frame{i, {0}});
+    }
+    EXPECT_EQ(notifications_count, 2U);
+}
+
+TEST(SpscRingTest, ConcurrentProducerAndConsumer)
+{
+    static constexpr uint32_t frames_count{200000};
+    Ring ring;
+    std::thread producer([&ring]() {
+        uint32_t sequence{0};
+        while(sequence < frames_count)
+        {
+            Frame* slot = ring.acquire();
+            if(slot == nullptr)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            slot->sequence = sequence;
+            slot->data[59] = static_cast<uint8_t>(sequence);
+            ring.commit();
+            sequence++;
+        }
+    });
+
+    uint32_t expected{0};
+    while(expected < frames_count)
+    {
+        const Frame* frame = ring.peek();
+        if(frame == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(frame->sequence, expected);
+        ASSERT_EQ(frame->data[59], static_cast<uint8_t>(expected));
+        ring.pop();
+        expected++;
+    }
+    producer.join();
+    const auto statistics = ring.getStatistics();
+    EXPECT_EQ(statistics.pushed, frames_count);
+    EXPECT_LE(statistics.high_water, Ring::capacity());
+}
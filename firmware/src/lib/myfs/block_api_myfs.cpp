@@ -16,7 +16,6 @@ static uint32_t sector_size_{0};
 static uint32_t page_size_{0};
 static uint32_t memory_size_{0};
 static uint32_t erasure_bits_sector_start_{0};
-constexpr uint32_t max_supported_memory_size{16 * 1024 * 1024};
 constexpr uint32_t min_supported_block_size{4096};
 
 
@@ -53,27 +52,13 @@ int myfs_program(const struct ::filesystem::myfs_config* c,
                  const void* buffer,
                  const myfs_size_t size)
 {
-    if(size % page_size_ != 0)
+    // flash splits the data on its page boundaries and programs the pages back to back
+    const auto program_result =
+        flash_->program(block * sector_size_ + off, reinterpret_cast<const uint8_t*>(buffer), size);
+    if(program_result != memory::SpiNorFlashIf::Result::OK)
     {
         return -1;
     }
-
-    if(0 != off % page_size_)
-    {
-        return -1;
-    }
-
-    for(auto page_id = 0; page_id < size / page_size_; ++page_id)
-    {
-        const auto address = block * sector_size_ + off + page_id * page_size_;
-        const uint8_t* data_ptr = &(reinterpret_cast<const uint8_t*>(buffer))[page_id * page_size_];
-
-        const auto program_result = flash_->program(address, data_ptr, size);
-        if(program_result != memory::SpiNorFlashIf::Result::OK)
-        {
-            return -1;
-        }
-    }
     return 0;
 }
 
@@ -28,39 +28,198 @@ int read_myfs_descriptor(myfs_file_descriptor& d,
                          const uint32_t descriptor_address,
                          const myfs_config& c);
 void print_flash_memory_area(const myfs_config& c, uint32_t start_address, uint32_t size);
+int bd_read(const myfs_config& c, myfs_block_t block, myfs_off_t off, void* buffer, myfs_size_t size);
+int bd_prog(
+    const myfs_config& c, myfs_block_t block, myfs_off_t off, const void* buffer, myfs_size_t size);
+int bd_erase_multiple(const myfs_config& c, myfs_block_t block, uint32_t blocks_count);
+int finalize_written_file(myfs_t& myfs, uint32_t file_size);
+
+// Accounting target for the block device accesses. It is only valid during execution of a public call.
+static myfs_op_stats* active_op_stats{nullptr};
+
+/// Directs block device accounting of the current scope to the counters of the given operation.
+class OpAccounting
+{
+public:
+    OpAccounting(myfs_t& myfs, myfs_op op)
+        : previous_(active_op_stats)
+    {
+        active_op_stats = &myfs.io_stats.ops[static_cast<uint32_t>(op)];
+        active_op_stats->calls++;
+    }
+    ~OpAccounting() { active_op_stats = previous_; }
+
+    OpAccounting(const OpAccounting&) = delete;
+    OpAccounting& operator=(const OpAccounting&) = delete;
+
+private:
+    myfs_op_stats* previous_;
+};
 
 // This variable is set up at the mounting stage. It defines boundaries for the binary search algorithm.
 static uint32_t max_files_in_fs{legacy_first_file_start_location / single_file_descriptor_size_bytes};
 
 static uint32_t get_first_file_offset() { return max_files_in_fs * single_file_descriptor_size_bytes; }
 
+// If the area written by the previous generation is unknown, the next one is shifted by this part of the data area
+static constexpr uint32_t generation_shift_divider{8};
+
+static uint32_t data_area_end(const myfs_t& myfs) { return myfs.config.block_count * myfs.config.block_size; }
+static uint32_t data_area_size(const myfs_t& myfs) { return data_area_end(myfs) - myfs.data_area_start; }
+
+// Data of the generation is addressed by the offset from the generation start, that wraps around the end of the flash.
+static uint32_t to_offset(const myfs_t& myfs, const uint32_t address)
+{
+    return (address >= myfs.generation_start_address)
+               ? address - myfs.generation_start_address
+               : address + data_area_size(myfs) - myfs.generation_start_address;
+}
+
+static uint32_t to_address(const myfs_t& myfs, const uint32_t offset)
+{
+    const uint32_t address = myfs.generation_start_address + offset;
+    return (address >= data_area_end(myfs)) ? address - data_area_size(myfs) : address;
+}
+
+// Space occupied by a record: data is followed by at least one (padding) page
+static uint32_t record_footprint(const uint32_t file_size) { return ((file_size / page_size) + 1) * page_size; }
+
+static int erase_range(const myfs_config& c, const uint32_t start_address, const uint32_t end_address)
+{
+    const uint32_t first_block = start_address / c.block_size;
+    const uint32_t end_block = (end_address + c.block_size - 1) / c.block_size;
+    if (end_block <= first_block)
+    {
+        return 0;
+    }
+    return bd_erase_multiple(c, first_block, end_block - first_block);
+}
+
+static bool is_geometry_supported(const myfs_config& c)
+{
+    return c.prog_size == page_size && c.block_size >= page_size && (c.block_size % page_size) == 0 &&
+           myfs_get_table_size(c) < c.block_count * c.block_size;
+}
+
+uint32_t myfs_get_table_size(const myfs_config& c)
+{
+    if (c.table_size > 0)
+    {
+        return c.table_size;
+    }
+    static constexpr uint32_t capacity_per_default_table{16 * 1024 * 1024};
+    const uint64_t capacity = static_cast<uint64_t>(c.block_count) * c.block_size;
+    uint32_t table_size{first_file_start_location};
+    while (table_size < max_table_size &&
+           static_cast<uint64_t>(table_size) * (capacity_per_default_table / first_file_start_location) < capacity)
+    {
+        table_size *= 2;
+    }
+    if (c.block_size > 0 && (table_size % c.block_size) != 0)
+    {
+        table_size = ((table_size / c.block_size) + 1) * c.block_size;
+    }
+    return table_size;
+}
+
 /// @brief erase the flash memory that belongs to the FS instance and introduce a FS marker at the first word.
+/// If the FS is mounted, only the table and the area written by the current generation get erased,
+/// the next generation starts at the first sector after the written area. Otherwise the whole flash is erased.
 /// @return 0, if operation was successful, error code otherwise (TODO: change to optional/result type)
 int myfs_format(myfs_t& myfs)
 {
+    OpAccounting accounting(myfs, myfs_op::FORMAT);
     const myfs_config config(myfs.config);
+    if (!is_geometry_supported(config))
+    {
+        return INVALID_PARAMETERS;
+    }
 
-    const auto erase_result = config.erase_multiple(&config, 0, config.block_count);
-    if (erase_result != 0)
+    const uint32_t table_end = myfs_get_table_size(config);
+    myfs_format_marker marker;
+    memset(&marker, 0xFF, sizeof(marker));
+    marker.magic = global_magic_value;
+    marker.table_size = table_end / single_file_descriptor_size_bytes;
+    marker.generation = 0;
+    marker.generation_start_address = table_end;
+
+    myfs_format_marker previous_marker;
+    const auto marker_read_result = bd_read(config, 0, 0, &previous_marker, sizeof(previous_marker));
+    if (marker_read_result != 0)
+    {
+        return marker_read_result;
+    }
+    const bool is_layout_kept = (previous_marker.magic == global_magic_value) && (myfs.data_area_start == table_end);
+    if (is_layout_kept)
     {
-        return erase_result;
+        marker.generation = (previous_marker.generation == empty_word_value) ? 1 : previous_marker.generation + 1;
     }
 
-    // propagate a magic value into the first 32 bytes
-    uint8_t format_marker[myfs_format_marker_size];
-    uint32_t fs_size{first_file_start_location / single_file_descriptor_size_bytes};
-    memset(format_marker, 0xFF, myfs_format_marker_size);
-    memcpy(format_marker, &global_magic_value, sizeof(global_magic_value));
-    memcpy(&format_marker[4], &fs_size, sizeof(fs_size));
-    const auto read_result = config.read(&config, 0, 0, config.read_buffer, config.prog_size);
+    // mount of a full FS doesn't find the end of the data (it's the whole area anyway), so it's erased as a whole
+    if (is_layout_kept && myfs.is_mounted && !myfs.is_file_open && !myfs.is_full)
+    {
+        uint32_t data_end_offset = to_offset(myfs, myfs.next_file_start_address);
+        if (myfs.is_file_paused)
+        {
+            data_end_offset += record_footprint(myfs.paused_file_size + myfs.paused_buffer_position);
+        }
+        data_end_offset = std::min(data_end_offset, data_area_size(myfs));
+
+        // descriptors table is erased first, so an interrupted format leads to a full format at the next mount.
+        const auto table_erase_result = erase_range(config, 0, table_end);
+        if (table_erase_result != 0)
+        {
+            return table_erase_result;
+        }
+        const uint32_t start = myfs.generation_start_address;
+        const uint32_t end = start + data_end_offset;
+        const auto first_erase_result = erase_range(config, start, std::min(end, data_area_end(myfs)));
+        if (first_erase_result != 0)
+        {
+            return first_erase_result;
+        }
+        if (end > data_area_end(myfs))
+        {
+            const auto wrapped_erase_result = erase_range(config, table_end, end - data_area_size(myfs));
+            if (wrapped_erase_result != 0)
+            {
+                return wrapped_erase_result;
+            }
+        }
+
+        const uint32_t next_generation_offset =
+            ((data_end_offset + config.block_size - 1) / config.block_size) * config.block_size;
+        marker.generation_start_address = to_address(myfs, next_generation_offset % data_area_size(myfs));
+    }
+    else
+    {
+        const auto erase_result = bd_erase_multiple(config, 0, config.block_count);
+        if (erase_result != 0)
+        {
+            return erase_result;
+        }
+        if (is_layout_kept && previous_marker.generation_start_address != empty_word_value &&
+            previous_marker.generation_start_address >= table_end &&
+            previous_marker.generation_start_address < data_area_end(myfs))
+        {
+            // written area is unknown, shift the start by a fixed part of the data area
+            const uint32_t area_size = data_area_end(myfs) - table_end;
+            const uint32_t shift = ((area_size / generation_shift_divider) / config.block_size) * config.block_size;
+            const uint32_t offset = previous_marker.generation_start_address - table_end + shift;
+            marker.generation_start_address = table_end + ((area_size > 0) ? (offset % area_size) : 0);
+        }
+    }
+
+    // propagate the marker into the first 32 bytes
+    const auto read_result = bd_read(config, 0, 0, config.read_buffer, config.prog_size);
     if(read_result != 0)
     {
         return read_result;
     }
     memcpy(config.prog_buffer, config.read_buffer, config.prog_size);
-    memcpy(config.prog_buffer, format_marker, sizeof(format_marker));
+    memcpy(config.prog_buffer, &marker, sizeof(marker));
 
-    const auto program_result = config.prog(&config, 0, 0, config.prog_buffer, config.prog_size);
+    const auto program_result = bd_prog(config, 0, 0, config.prog_buffer, config.prog_size);
     if(program_result != 0)
     {
         return program_result;
@@ -69,6 +228,7 @@ int myfs_format(myfs_t& myfs)
     myfs.is_full = false;
     myfs.is_corrupt = false;
     myfs.is_file_open = false;
+    myfs.is_file_paused = false;
     myfs.is_mounted = false;
     return 0;
 }
@@ -77,39 +237,53 @@ int myfs_format(myfs_t& myfs)
 // If it is, calculate count of existing on FS files and prepare the next writable file address
 int myfs_mount(myfs_t& myfs)
 {
+    OpAccounting accounting(myfs, myfs_op::MOUNT);
     const myfs_config config(myfs.config);
 
     if(myfs.is_mounted)
     {
         return REMOUNT_ATTEMPTED;
     }
+    if (!is_geometry_supported(config))
+    {
+        return INVALID_PARAMETERS;
+    }
     // 0. get the FS start address from the config (TODO: place it into the config)
     myfs.fs_start_address = 0;
     static constexpr uint32_t local_buffer_size{page_size};
     uint8_t tmp[local_buffer_size];
 
     // 1. check if the marker is in place
-    const auto read_result = config.read(&config, myfs.fs_start_address, 0, tmp, local_buffer_size);
+    const auto read_result = bd_read(config, myfs.fs_start_address, 0, tmp, local_buffer_size);
     if(read_result != 0)
     {
         return INTERNAL_ERROR;
     }
 
-    uint32_t marker{0};
+    myfs_format_marker marker;
     memcpy(&marker, tmp, sizeof(marker));
 
-    if(marker != global_magic_value)
+    if(marker.magic != global_magic_value)
     {
         return INTERNAL_ERROR;
     }
 
-    uint32_t fs_size{0};
-    memcpy(&fs_size, &tmp[sizeof(marker)], sizeof(fs_size));
+    const uint32_t fs_size{marker.table_size};
 
     if (fs_size > 0 && fs_size < 4096) 
     {
         max_files_in_fs = fs_size;
     }
+    myfs.data_area_start = get_first_file_offset();
+    myfs.generation = (marker.generation == empty_word_value) ? 0 : marker.generation;
+    myfs.generation_start_address = marker.generation_start_address;
+    if (myfs.generation_start_address < myfs.data_area_start ||
+        myfs.generation_start_address >= data_area_end(myfs) ||
+        (myfs.generation_start_address % page_size) != 0)
+    {
+        // legacy marker
+        myfs.generation_start_address = myfs.data_area_start;
+    }
 
     // offset is relative to the start of the read buffer
     uint32_t current_file_id{max_files_in_fs / 2};
@@ -160,6 +334,7 @@ int myfs_mount(myfs_t& myfs)
             // special case of the first written file
             if (current_file_id == 1 || current_file_id == 2)
             {
+                uint32_t data_end_offset{0};
                 myfs_file_descriptor first_d;
                 myfs_file_descriptor second_d;
                 uint32_t first_descriptor_address = single_file_descriptor_size_bytes;
@@ -169,27 +344,38 @@ int myfs_mount(myfs_t& myfs)
                 if (first_d.magic == empty_word_value)
                 {
                     myfs.files_count = 0;
-                    myfs.next_file_start_address = get_first_file_offset();
+                    data_end_offset = 0;
                     myfs.next_file_descriptor_address = single_file_descriptor_size_bytes;
                 }
                 else if (second_d.magic == empty_word_value)
                 {
+                    if (first_d.file_size == empty_word_value)
+                    {
+                        // the only record has not been finalized (f.e. power loss while it was paused)
+                        const auto repair_result = myfs_repair(myfs, first_d, first_descriptor_address);
+                        if (repair_result != 0)
+                        {
+                            return repair_result;
+                        }
+                        return REPAIR_HAS_BEEN_PERFORMED;
+                    }
                     myfs.files_count = 1;
                     const auto first_file_size = first_d.file_size;
-                    myfs.next_file_start_address = get_first_file_offset() + ((first_file_size / page_size) + 1) * page_size;
+                    data_end_offset = to_offset(myfs, first_d.start_address) + record_footprint(first_file_size);
                     myfs.next_file_descriptor_address = 2 * single_file_descriptor_size_bytes;
                 }
                 else 
                 {
                     return IMPLEMENTATION_ERROR;
                 }
-                if (myfs.next_file_start_address >= (config.block_count * config.block_size - 1024))
+                if (data_end_offset >= (data_area_size(myfs) - 1024))
                 {
                     myfs.is_mounted = true;
                     myfs.is_full = true;
                     return NO_SPACE_LEFT;
                 }
 
+                myfs.next_file_start_address = to_address(myfs, data_end_offset);
                 myfs.is_mounted = true;
                 return 0;
             }
@@ -217,12 +403,13 @@ int myfs_mount(myfs_t& myfs)
                 if (last_written_descriptor.file_size != empty_word_value)
                 {
                     const auto next_descriptor_address = (last_written_file_idx + 1) * single_file_descriptor_size_bytes;
-                    const auto next_file_start_address = last_written_descriptor.start_address + ((last_written_descriptor.file_size / page_size) + 1) * page_size;
+                    const auto data_end_offset = to_offset(myfs, last_written_descriptor.start_address) +
+                                                 record_footprint(last_written_descriptor.file_size);
                     
-                    if (next_file_start_address <= (config.block_count * config.block_size))
+                    if (data_end_offset < data_area_size(myfs))
                     {
                         myfs.files_count = last_written_file_idx;
-                        myfs.next_file_start_address = next_file_start_address;
+                        myfs.next_file_start_address = to_address(myfs, data_end_offset);
                         myfs.next_file_descriptor_address = next_descriptor_address;
                         
                         myfs.is_mounted = true;
@@ -237,8 +424,16 @@ int myfs_mount(myfs_t& myfs)
                 }
                 else 
                 {
-                    // probably a repair is required
-                    return FS_CORRUPT_REPAIRABLE;
+                    // the last record has not been finalized (f.e. power loss while it was paused)
+                    const auto repair_result = myfs_repair(
+                        myfs,
+                        last_written_descriptor,
+                        last_written_file_idx * single_file_descriptor_size_bytes);
+                    if (repair_result != 0)
+                    {
+                        return FS_CORRUPT_REPAIRABLE;
+                    }
+                    return REPAIR_HAS_BEEN_PERFORMED;
                 }
             }
         }
@@ -249,6 +444,8 @@ int myfs_mount(myfs_t& myfs)
 
 int myfs_file_open(myfs_t& myfs, myfs_file_t& file, uint8_t* file_id, uint8_t flags)
 {
+    OpAccounting accounting(
+        myfs, ((flags & (MYFS_CREATE_FLAG | MYFS_APPEND_FLAG)) > 0) ? myfs_op::CREATE : myfs_op::META);
     const myfs_config config(myfs.config);
 
     if(myfs.is_file_open)
@@ -256,6 +453,15 @@ int myfs_file_open(myfs_t& myfs, myfs_file_t& file, uint8_t* file_id, uint8_t fl
         return -1;
     }
 
+    if((flags & (MYFS_CREATE_FLAG | MYFS_READ_FLAG)) > 0)
+    {
+        const auto finalize_result = myfs_finalize_paused_file(myfs);
+        if(0 != finalize_result)
+        {
+            return finalize_result;
+        }
+    }
+
     if((flags & MYFS_CREATE_FLAG) > 0)
     {
         // at this point all checks have passed
@@ -263,7 +469,8 @@ int myfs_file_open(myfs_t& myfs, myfs_file_t& file, uint8_t* file_id, uint8_t fl
         myfs_file_descriptor d;
         d.magic = file_magic_value;
         d.start_address = myfs.next_file_start_address;
-        if (myfs.next_file_start_address >= config.block_count * config.block_size)
+        // padding page written at close should still fit
+        if (to_offset(myfs, myfs.next_file_start_address) + 2 * page_size > data_area_size(myfs))
         {
             return NO_SPACE_LEFT;
         }
@@ -339,12 +546,59 @@ int myfs_file_open(myfs_t& myfs, myfs_file_t& file, uint8_t* file_id, uint8_t fl
             return 0;
         }
     }
+    else if((flags & MYFS_APPEND_FLAG) > 0)
+    {
+        if(!myfs.is_file_paused)
+        {
+            return ERROR_FILE_NOT_FOUND;
+        }
+        myfs_file_descriptor d;
+        const auto descr_read_result =
+            read_myfs_descriptor(d, myfs.next_file_descriptor_address, config);
+        if(0 != descr_read_result)
+        {
+            return descr_read_result;
+        }
+        if(d.magic != file_magic_value || memcmp(d.file_id, file_id, d.file_id_size) != 0)
+        {
+            return ERROR_FILE_NOT_FOUND;
+        }
+
+        myfs.buffer_pointer = reinterpret_cast<uint8_t*>(config.prog_buffer);
+        myfs.buffer_size = config.prog_size;
+        myfs.buffer_position = myfs.paused_buffer_position;
+        if(myfs.buffer_position > 0)
+        {
+            // tail page has been partially programmed on pause, its content has to be restored
+            const auto tail_address =
+                to_address(myfs, to_offset(myfs, myfs.next_file_start_address) + myfs.paused_file_size);
+            const auto read_res = bd_read(config,
+                                          tail_address / config.block_size,
+                                          tail_address % config.block_size,
+                                          myfs.buffer_pointer,
+                                          myfs.buffer_size);
+            if(0 != read_res)
+            {
+                return read_res;
+            }
+        }
+
+        file.flags = flags;
+        file.is_open = true;
+        file.is_write = true;
+        file.size = myfs.paused_file_size;
+        memcpy(file.id, file_id, myfs_file_t::id_size);
+        myfs.is_file_paused = false;
+        myfs.is_file_open = true;
+        return 0;
+    }
     return -1;
 }
 
 // close operation updates the descriptor contained in flash memory with value of size and (maybe later) CRC value
 int myfs_file_close(myfs_t& myfs, myfs_file_t& file)
 {
+    OpAccounting accounting(myfs, myfs_op::CLOSE);
     const myfs_config& config(myfs.config);
 
     if(!file.is_open)
@@ -354,18 +608,8 @@ int myfs_file_close(myfs_t& myfs, myfs_file_t& file)
 
     if(file.is_write)
     {
-        myfs_file_descriptor d;
-        const auto read_res = read_myfs_descriptor(d, myfs.next_file_descriptor_address, config);
-        if(0 != read_res)
-        {
-            return read_res;
-        }
-        if(d.magic != file_magic_value)
-        {
-            return -1;
-        }
         // first flush contents of the prog buffer into flash memory
-        const auto prog_address = myfs.next_file_start_address + file.size;
+        const auto prog_address = to_address(myfs, to_offset(myfs, myfs.next_file_start_address) + file.size);
         // should be page-aligned at this point
         if(prog_address % page_size != 0)
         {
@@ -377,7 +621,7 @@ int myfs_file_close(myfs_t& myfs, myfs_file_t& file)
                0x00,
                myfs.buffer_size - myfs.buffer_position);
         const auto prog_result =
-            config.prog(&config, block, off, myfs.buffer_pointer, myfs.buffer_size);
+            bd_prog(config, block, off, myfs.buffer_pointer, myfs.buffer_size);
         if(prog_result != 0)
         {
             // it's not a critical error, we just lose data, but we still can proceed
@@ -385,22 +629,11 @@ int myfs_file_close(myfs_t& myfs, myfs_file_t& file)
         }
         file.size += myfs.buffer_position;
 
-        d.file_size = file.size;
-        const auto prog_res = write_myfs_descriptor(d, myfs.next_file_descriptor_address, config);
-        if(0 != prog_res)
+        const auto finalize_res = finalize_written_file(myfs, file.size);
+        if(0 != finalize_res)
         {
-            return prog_res;
+            return finalize_res;
         }
-
-        const uint32_t next_descriptor_position =
-            myfs.next_file_descriptor_address + single_file_descriptor_size_bytes;
-        const uint32_t next_file_start_address =
-            myfs.next_file_start_address + ((file.size / page_size) + 1) * page_size;
-
-        myfs.next_file_descriptor_address = next_descriptor_position;
-        myfs.next_file_start_address = next_file_start_address;
-        myfs.files_count++;
-        myfs.is_file_open = false;
         file.is_open = false;
 
         return 0;
@@ -415,13 +648,69 @@ int myfs_file_close(myfs_t& myfs, myfs_file_t& file)
     return -1;
 }
 
+// Pause keeps the record appendable: buffered data is flushed with the erased-state padding, so the
+// tail page can be programmed once more after the record is reopened, and the descriptor is left
+// without the size.
+int myfs_file_pause(myfs_t& myfs, myfs_file_t& file)
+{
+    OpAccounting accounting(myfs, myfs_op::CLOSE);
+    const myfs_config& config(myfs.config);
+
+    if(!file.is_open || !file.is_write)
+    {
+        return INVALID_PARAMETERS;
+    }
+
+    if(myfs.buffer_position > 0)
+    {
+        const auto prog_address = to_address(myfs, to_offset(myfs, myfs.next_file_start_address) + file.size);
+        if(prog_address % page_size != 0)
+        {
+            return ALIGNMENT_ERROR;
+        }
+        memset(&myfs.buffer_pointer[myfs.buffer_position],
+               0xFF,
+               myfs.buffer_size - myfs.buffer_position);
+        const auto prog_result = bd_prog(config,
+                                         prog_address / config.block_size,
+                                         prog_address % config.block_size,
+                                         myfs.buffer_pointer,
+                                         myfs.buffer_size);
+        if(prog_result != 0)
+        {
+            return INTERNAL_ERROR;
+        }
+    }
+
+    myfs.is_file_paused = true;
+    myfs.paused_file_size = file.size;
+    myfs.paused_buffer_position = myfs.buffer_position;
+    myfs.is_file_open = false;
+    file.is_open = false;
+
+    return 0;
+}
+
+int myfs_finalize_paused_file(myfs_t& myfs)
+{
+    if(!myfs.is_file_paused)
+    {
+        return 0;
+    }
+    OpAccounting accounting(myfs, myfs_op::CLOSE);
+    myfs.is_file_paused = false;
+    return finalize_written_file(myfs, myfs.paused_file_size + myfs.paused_buffer_position);
+}
+
 int myfs_file_write(myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t size)
 {
+    OpAccounting accounting(myfs, myfs_op::WRITE);
     const myfs_config& config(myfs.config);
     if(nullptr == buffer || !file.is_open || !file.is_write)
     {
         return INVALID_PARAMETERS;
     }
+    myfs.io_stats.user_bytes_written += size;
     // handle case of data fitting into the buffer
     const auto leftover_space = myfs.buffer_size - myfs.buffer_position;
     if(leftover_space > size)
@@ -432,11 +721,13 @@ int myfs_file_write(myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t s
     }
     // fill in the buffer until full, then flush onto the disk
     memcpy(&myfs.buffer_pointer[myfs.buffer_position], buffer, leftover_space);
-    const auto prog_address = myfs.next_file_start_address + file.size;
-    if (prog_address >= (config.block_count * config.block_size))
+    const auto prog_offset = to_offset(myfs, myfs.next_file_start_address) + file.size;
+    // this page, the padding page of the close and the start of the next record should fit
+    if (prog_offset + 3 * page_size > data_area_size(myfs))
     {
         return NO_SPACE_LEFT;
     }
+    const auto prog_address = to_address(myfs, prog_offset);
     // should be page-aligned at this point
     if(prog_address % page_size != 0)
     {
@@ -445,7 +736,7 @@ int myfs_file_write(myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t s
     const auto block = prog_address / config.block_size;
     const auto off = prog_address % config.block_size;
     const auto prog_result =
-        config.prog(&config, block, off, myfs.buffer_pointer, myfs.buffer_size);
+        bd_prog(config, block, off, myfs.buffer_pointer, myfs.buffer_size);
     if(prog_result != 0)
     {
         // it's not a critical error, we just lose data, but we still can proceed
@@ -473,6 +764,7 @@ int myfs_file_write(myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t s
 int myfs_file_read(
     myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t max_size, myfs_size_t& read_size)
 {
+    OpAccounting accounting(myfs, myfs_op::READ);
     const myfs_config& config(myfs.config);
     if(nullptr == buffer || !file.is_open || file.is_write)
     {
@@ -484,12 +776,13 @@ int myfs_file_read(
         read_size = 0;
         return 0;
     }
-    read_size = std::min(max_size, leftover_size);
+    const auto read_address = to_address(myfs, to_offset(myfs, file.start_address) + file.read_pos);
+    // data wraps at the end of the flash, such chunk is returned in 2 reads
+    read_size = std::min(std::min(max_size, leftover_size), data_area_end(myfs) - read_address);
 
-    const auto read_address = file.start_address + file.read_pos;
     const auto block = read_address / config.block_size;
     const auto off = read_address % config.block_size;
-    const auto read_res = config.read(&config, block, off, buffer, read_size);
+    const auto read_res = bd_read(config, block, off, buffer, read_size);
     if(read_res != 0)
     {
         return -1;
@@ -501,8 +794,23 @@ int myfs_file_read(
 
 int myfs_unmount(myfs_t& myfs)
 {
+    const auto finalize_result = myfs_finalize_paused_file(myfs);
     myfs.is_mounted = false;
-    return 0;
+    return finalize_result;
+}
+
+int myfs_remount(myfs_t& myfs)
+{
+    if(myfs.is_mounted && myfs.is_file_paused && !myfs.is_file_open)
+    {
+        return 0;
+    }
+    const auto unmount_result = myfs_unmount(myfs);
+    if(0 != unmount_result)
+    {
+        return unmount_result;
+    }
+    return myfs_mount(myfs);
 }
 
 uint32_t myfs_get_files_count(myfs_t& myfs)
@@ -510,18 +818,30 @@ uint32_t myfs_get_files_count(myfs_t& myfs)
     return myfs.files_count;
 }
 
+uint32_t myfs_get_files_capacity(const myfs_t& myfs)
+{
+    // first slot is occupied by the marker, the last one is reserved for full FS detection
+    return (myfs.data_area_start / single_file_descriptor_size_bytes) - 2;
+}
+
 int myfs_rewind_dir(myfs_t& myfs)
 {
     if(!myfs.is_mounted)
     {
         return -1;
     }
+    const auto finalize_result = myfs_finalize_paused_file(myfs);
+    if(0 != finalize_result)
+    {
+        return finalize_result;
+    }
     myfs.current_id_search_pos = single_file_descriptor_size_bytes;
     return 0;
 }
 
 int myfs_get_next_id(myfs_t& myfs, uint8_t* file_id)
 {
+    OpAccounting accounting(myfs, myfs_op::META);
     const myfs_config& config(myfs.config);
     if(nullptr == file_id)
     {
@@ -547,11 +867,17 @@ int myfs_get_next_id(myfs_t& myfs, uint8_t* file_id)
 // TODO: utilize binary search here
 int myfs_file_get_size(myfs_t& myfs, uint8_t* file_id)
 {
+    OpAccounting accounting(myfs, myfs_op::META);
     const myfs_config& config(myfs.config);
     if(nullptr == file_id)
     {
         return -1;
     }
+    const auto finalize_result = myfs_finalize_paused_file(myfs);
+    if(0 != finalize_result)
+    {
+        return finalize_result;
+    }
     bool is_file_found{false};
     uint32_t current_descriptor_address{myfs.fs_start_address + single_file_descriptor_size_bytes};
 
@@ -595,6 +921,7 @@ int myfs_file_get_size(myfs_t& myfs, uint8_t* file_id)
 
 int myfs_get_fs_stat(myfs_t& myfs, uint32_t& files_count, uint32_t& occupied_space)
 {
+    OpAccounting accounting(myfs, myfs_op::META);
     const myfs_config& config(myfs.config);
     if(!myfs.is_mounted)
     {
@@ -602,6 +929,11 @@ int myfs_get_fs_stat(myfs_t& myfs, uint32_t& files_count, uint32_t& occupied_spa
         occupied_space = 0;
         return -1;
     }
+    const auto finalize_result = myfs_finalize_paused_file(myfs);
+    if(0 != finalize_result)
+    {
+        return finalize_result;
+    }
 
     uint32_t current_descriptor_address{myfs.fs_start_address + single_file_descriptor_size_bytes};
     files_count = 0;
@@ -633,6 +965,37 @@ int myfs_get_fs_stat(myfs_t& myfs, uint32_t& files_count, uint32_t& occupied_spa
     return 0;
 }
 
+int finalize_written_file(myfs_t& myfs, uint32_t file_size)
+{
+    const myfs_config& config(myfs.config);
+    myfs_file_descriptor d;
+    const auto read_res = read_myfs_descriptor(d, myfs.next_file_descriptor_address, config);
+    if(0 != read_res)
+    {
+        return read_res;
+    }
+    if(d.magic != file_magic_value)
+    {
+        return -1;
+    }
+
+    d.file_size = file_size;
+    const auto prog_res = write_myfs_descriptor(d, myfs.next_file_descriptor_address, config);
+    if(0 != prog_res)
+    {
+        return prog_res;
+    }
+
+    myfs.next_file_descriptor_address += single_file_descriptor_size_bytes;
+    myfs.next_file_start_address =
+        to_address(myfs, to_offset(myfs, myfs.next_file_start_address) + record_footprint(file_size));
+    myfs.files_count++;
+    myfs.io_stats.records_closed++;
+    myfs.is_file_open = false;
+
+    return 0;
+}
+
 int write_myfs_descriptor(myfs_file_descriptor d,
                           const uint32_t descriptor_address,
                           const myfs_config& c)
@@ -642,14 +1005,14 @@ int write_myfs_descriptor(myfs_file_descriptor d,
     const auto page_address = (descriptor_address / page_size) * page_size;
     const auto block_id = page_address / c.block_size;
     const auto block_offset = page_address % c.block_size;
-    const auto read_res = c.read(&c, block_id, block_offset, tmp, page_size);
+    const auto read_res = bd_read(c, block_id, block_offset, tmp, page_size);
     if(read_res != 0)
     {
         return read_res;
     }
     const auto descriptor_offset_to_page = descriptor_address - page_address;
     memcpy(&tmp[descriptor_offset_to_page], &d, sizeof(d));
-    const auto prog_res = c.prog(&c, block_id, block_offset, tmp, page_size);
+    const auto prog_res = bd_prog(c, block_id, block_offset, tmp, page_size);
 
     if(prog_res != 0)
     {
@@ -665,7 +1028,7 @@ int read_myfs_descriptor(myfs_file_descriptor& d,
     const auto block_id = descriptor_address / c.block_size;
     const auto block_offset = descriptor_address % c.block_size;
 
-    const auto read_res = c.read(&c, block_id, block_offset, &d, single_file_descriptor_size_bytes);
+    const auto read_res = bd_read(c, block_id, block_offset, &d, single_file_descriptor_size_bytes);
     if(read_res != 0)
     {
         return read_res;
@@ -676,44 +1039,85 @@ int read_myfs_descriptor(myfs_file_descriptor& d,
 
 int myfs_repair(myfs_t& myfs, myfs_file_descriptor& first_invalid_descriptor, uint32_t descriptor_address)
 {
-    bool is_file_end_found{false};
-    uint32_t file_size{0};
-    uint32_t written_address = first_invalid_descriptor.start_address;
-    static constexpr uint32_t max_files_count{256};
     const auto& c{myfs.config};
-    uint32_t timeout{max_files_count};
-    while (!is_file_end_found && written_address < (c.block_count * c.block_size) && --timeout > 0)
+    const uint32_t start_address = first_invalid_descriptor.start_address;
+    if (start_address % page_size != 0 || start_address < myfs.data_area_start || start_address >= data_area_end(myfs))
     {
-        const auto block_id = written_address / c.block_size;
-        const auto block_offset = written_address % c.block_size;
-        uint32_t buff{0xFFFFFFFFUL};
-        const auto read_res = c.read(&c, block_id, block_offset, &buff, sizeof(buff));
+        return -1;
+    }
+    const uint32_t start_offset = to_offset(myfs, start_address);
+
+    // records are written sequentially into the erased space, so the record ends at the first page that is
+    // erased as a whole. Recorded data may contain erased words and the space past the record isn't ordered,
+    // so the pages are checked one by one from the record start.
+    const uint32_t max_pages_count{(data_area_size(myfs) - start_offset) / page_size};
+    uint8_t tmp[page_size];
+    uint32_t pages_count{0};
+    uint32_t tail_size{0};
+    for (; pages_count < max_pages_count; ++pages_count)
+    {
+        const uint32_t address = to_address(myfs, start_offset + pages_count * page_size);
+        const auto read_res = bd_read(c, address / c.block_size, address % c.block_size, tmp, page_size);
         if (read_res != 0)
         {
             return -1;
         }
-        if (written_address == empty_word_value)
+        // the last page may be padded with the erased value (record has been paused)
+        uint32_t used_size{page_size};
+        while (used_size > 0 && tmp[used_size - 1] == 0xFF)
         {
-            is_file_end_found = true;
+            --used_size;
         }
-        else 
+        if (used_size == 0)
         {
-            written_address += sizeof(buff);
-            file_size += sizeof(buff);
+            break;
         }
+        tail_size = used_size;
     }
-    if (timeout == 0)
+    const uint32_t file_size = (pages_count > 0) ? (pages_count - 1) * page_size + tail_size : 0;
+
+    first_invalid_descriptor.file_size = file_size;
+    return write_myfs_descriptor(first_invalid_descriptor, descriptor_address, c);
+}
+
+const myfs_io_stats& myfs_get_io_stats(const myfs_t& myfs)
+{
+    return myfs.io_stats;
+}
+
+void myfs_reset_io_stats(myfs_t& myfs)
+{
+    myfs.io_stats = myfs_io_stats{};
+}
+
+int bd_read(const myfs_config& c, myfs_block_t block, myfs_off_t off, void* buffer, myfs_size_t size)
+{
+    if(nullptr != active_op_stats)
     {
-        return -1;
+        active_op_stats->reads++;
+        active_op_stats->bytes_read += size;
     }
-    if (is_file_end_found)
+    return c.read(&c, block, off, buffer, size);
+}
+
+int bd_prog(
+    const myfs_config& c, myfs_block_t block, myfs_off_t off, const void* buffer, myfs_size_t size)
+{
+    if(nullptr != active_op_stats)
     {
-        first_invalid_descriptor.file_size = file_size;
-        const auto write_res = write_myfs_descriptor(first_invalid_descriptor, descriptor_address, c);
-        return write_res;
+        active_op_stats->programs++;
+        active_op_stats->bytes_programmed += size;
     }
+    return c.prog(&c, block, off, buffer, size);
+}
 
-    return -1;
+int bd_erase_multiple(const myfs_config& c, myfs_block_t block, uint32_t blocks_count)
+{
+    if(nullptr != active_op_stats)
+    {
+        active_op_stats->erases += blocks_count;
+    }
+    return c.erase_multiple(&c, block, blocks_count);
 }
 
 } // namespace filesystem
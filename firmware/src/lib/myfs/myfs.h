@@ -25,8 +25,11 @@ static constexpr uint32_t empty_word_value{0xFFFFFFFFUL};
 static constexpr uint32_t single_file_descriptor_size_bytes{32};
 static constexpr uint32_t myfs_format_marker_size{single_file_descriptor_size_bytes};
 static constexpr uint32_t legacy_first_file_start_location{4096};
-// TODO: derive this value from the memory size
+// Default size of the descriptors table, it is doubled for every doubling of the capacity above 16MB
 static constexpr uint32_t first_file_start_location{8192};
+static constexpr uint32_t max_table_size{64 * 1024};
+// Allocation unit of the FS, prog_size of the configuration has to be equal to it.
+// It doesn't have to match the page of the device, as long as the block device splits programming accordingly.
 static constexpr uint32_t page_size{256};
 
 
@@ -66,6 +69,45 @@ struct myfs_config
 
     void* read_buffer;
     void* prog_buffer;
+
+    // Size of the descriptors table in bytes (used by format only, mount takes it from the FS marker).
+    // 0 scales the table with the capacity of the device.
+    myfs_size_t table_size;
+};
+
+/// Storage operations, for which I/O accounting is performed separately
+enum class myfs_op : uint8_t
+{
+    FORMAT,
+    MOUNT,
+    CREATE,
+    WRITE,
+    CLOSE,
+    READ,
+    // listing, stat, size requests and file lookup on open
+    META,
+    COUNT,
+};
+
+/// Block device accesses issued by the FS while executing a single operation type
+struct myfs_op_stats
+{
+    uint32_t calls{0};
+    uint32_t reads{0};
+    uint32_t programs{0};
+    uint32_t erases{0};
+    uint32_t bytes_read{0};
+    uint32_t bytes_programmed{0};
+};
+
+/// Ratio of `bytes_programmed` summed over all operations to `user_bytes_written` gives
+/// the write amplification, `programs` of CREATE/WRITE/CLOSE divided by `records_closed` gives
+/// the count of transactions per record.
+struct myfs_io_stats
+{
+    myfs_op_stats ops[static_cast<uint32_t>(myfs_op::COUNT)];
+    uint32_t user_bytes_written{0};
+    uint32_t records_closed{0};
 };
 
 struct myfs_t
@@ -86,6 +128,20 @@ struct myfs_t
 
     uint32_t current_id_search_pos{single_file_descriptor_size_bytes};
 
+    // Data area follows the descriptors table. Every format generation starts writing where the previous
+    // one has stopped and wraps around the end of the flash, so erase wear spreads over the whole area.
+    uint32_t data_area_start{first_file_start_location};
+    uint32_t generation{0};
+    uint32_t generation_start_address{first_file_start_location};
+
+    // Paused record keeps its descriptor without the size, so it can be reopened for append.
+    // Size is written (record is finalized) as soon as any other operation needs a consistent FS.
+    bool is_file_paused{false};
+    uint32_t paused_file_size{0};
+    uint32_t paused_buffer_position{0};
+
+    myfs_io_stats io_stats;
+
     myfs_config& config;
 
     myfs_t(myfs_config& cfg)
@@ -93,6 +149,21 @@ struct myfs_t
     { }
 };
 
+/// Bytes 0..3: global magic
+/// Bytes 4..7: size of the descriptors table in descriptors (the marker occupies the first one)
+/// Bytes 8..11: format generation (erased value in legacy markers is treated as 0)
+/// Bytes 12..15: address of the first file of this generation (erased value - the end of the descriptors table)
+struct __attribute__((__packed__)) myfs_format_marker
+{
+    uint32_t magic;
+    uint32_t table_size;
+    uint32_t generation;
+    uint32_t generation_start_address;
+    uint8_t reserved[16];
+
+    void size_assertion()  { static_assert(myfs_format_marker_size == sizeof(myfs_format_marker)); }
+};
+
 /// Bytes 0..3: magic, corresponding to a created file
 /// Bytes 4..7: start address
 /// Bytes 8..15: file identifier/name (0 is a valid value, shall be converted to text `00`)
@@ -124,6 +195,8 @@ struct myfs_file_t
 
 static constexpr uint8_t MYFS_CREATE_FLAG{1 << 0};
 static constexpr uint8_t MYFS_READ_FLAG{1 << 1};
+// Reopen the paused record (see myfs_file_pause) and continue writing at its tail
+static constexpr uint8_t MYFS_APPEND_FLAG{1 << 2};
 
 int myfs_format(myfs_t& myfs);
 int myfs_mount(myfs_t& myfs);
@@ -131,10 +204,15 @@ int myfs_mount(myfs_t& myfs);
 int myfs_file_open(myfs_t& myfs, myfs_file_t& file, uint8_t* file_id, uint8_t flags);
 int myfs_file_get_size(myfs_t& myfs, uint8_t* file_id);
 int myfs_file_close(myfs_t& myfs, myfs_file_t& file);
+int myfs_file_pause(myfs_t& myfs, myfs_file_t& file);
+int myfs_finalize_paused_file(myfs_t& myfs);
 int myfs_file_write(myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t size);
 int myfs_file_read(
     myfs_t& myfs, myfs_file_t& file, void* buffer, myfs_size_t max_size, myfs_size_t& read_size);
 int myfs_unmount(myfs_t& myfs);
+// Mount anew for another user of the FS. Paused record stays appendable: it's the last record and only its size
+// is missing, so the mounted state is kept as is. Otherwise it's an unmount followed by a mount.
+int myfs_remount(myfs_t& myfs);
 
 int myfs_repair(myfs_t& myfs, myfs_file_descriptor& first_invalid_descriptor, uint32_t descriptor_address);
 
@@ -145,4 +223,12 @@ int myfs_get_next_id(myfs_t& myfs, uint8_t* file_id);
 
 // "stat"-related call
 int myfs_get_fs_stat(myfs_t& myfs, uint32_t& files_count, uint32_t& occupied_space);
+// amount of records that can be created in the mounted FS
+uint32_t myfs_get_files_capacity(const myfs_t& myfs);
+// size of the descriptors table that format creates for this configuration
+uint32_t myfs_get_table_size(const myfs_config& config);
+
+// I/O accounting
+const myfs_io_stats& myfs_get_io_stats(const myfs_t& myfs);
+void myfs_reset_io_stats(myfs_t& myfs);
 } // namespace filesystem
@@ -0,0 +1,302 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "myfs_fsck.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace filesystem
+{
+
+// All reads are done by whole pages: descriptor table is checked 8 descriptors per read, the tail - page by page.
+static constexpr uint32_t descriptors_per_page{page_size / single_file_descriptor_size_bytes};
+static constexpr uint32_t max_table_descriptors{4096};
+static constexpr uint32_t legacy_table_size{legacy_first_file_start_location / single_file_descriptor_size_bytes};
+
+static int read_page(const myfs_config& c, myfs_fsck_report& report, uint32_t address, uint8_t* page)
+{
+    report.bytes_read += page_size;
+    return c.read(&c, address / c.block_size, address % c.block_size, page, page_size);
+}
+
+static void report_issue(myfs_fsck_report& report, myfs_fsck_issue issue, uint32_t location)
+{
+    report.issues[static_cast<uint32_t>(issue)]++;
+    if (report.first_issue_location == empty_word_value)
+    {
+        report.first_issue_location = location;
+    }
+}
+
+static uint32_t data_area_size(const myfs_config& c, const myfs_fsck_cursor& cursor)
+{
+    return c.block_count * c.block_size - cursor.data_area_start;
+}
+
+static uint32_t to_offset(const myfs_config& c, const myfs_fsck_cursor& cursor, const uint32_t address)
+{
+    return (address >= cursor.generation_start_address)
+               ? address - cursor.generation_start_address
+               : address + data_area_size(c, cursor) - cursor.generation_start_address;
+}
+
+static uint32_t to_address(const myfs_config& c, const myfs_fsck_cursor& cursor, const uint32_t offset)
+{
+    const uint32_t address = cursor.generation_start_address + offset;
+    return (address >= c.block_count * c.block_size) ? address - data_area_size(c, cursor) : address;
+}
+
+static bool is_page_erased(const uint8_t* page)
+{
+    for (uint32_t i = 0; i < page_size; ++i)
+    {
+        if (page[i] != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void finish_descriptors(const myfs_config& c, myfs_fsck_cursor& cursor, myfs_fsck_report& report)
+{
+    const uint32_t area_size = data_area_size(c, cursor);
+    cursor.tail_offset = cursor.expected_start_offset;
+    cursor.tail_end_offset = area_size;
+    if (cursor.tail_check_limit > 0 && cursor.tail_offset + cursor.tail_check_limit < area_size)
+    {
+        cursor.tail_end_offset = cursor.tail_offset + cursor.tail_check_limit;
+    }
+    report.data_end_address = to_address(c, cursor, std::min(cursor.tail_offset, area_size - page_size));
+    cursor.phase = myfs_fsck_phase::TAIL;
+}
+
+static void check_descriptor(const myfs_config& c,
+                             myfs_fsck_cursor& cursor,
+                             myfs_fsck_report& report,
+                             const myfs_file_descriptor& d)
+{
+    const uint32_t flash_size = c.block_count * c.block_size;
+    const uint32_t area_size = data_area_size(c, cursor);
+    const uint32_t index = cursor.descriptor_index;
+    report.descriptors_checked++;
+
+    if (cursor.is_table_end_found)
+    {
+        if (d.magic != empty_word_value)
+        {
+            report_issue(report, myfs_fsck_issue::DESCRIPTOR_AFTER_END, index);
+        }
+        return;
+    }
+    if (d.magic == empty_word_value)
+    {
+        cursor.is_table_end_found = true;
+        return;
+    }
+    if (d.magic != file_magic_value)
+    {
+        report_issue(report, myfs_fsck_issue::BAD_DESCRIPTOR_MAGIC, index);
+        return;
+    }
+
+    report.records_count++;
+    if (report.is_last_record_unfinalized)
+    {
+        // previous record has been left without size, but the FS has been written further
+        report_issue(report, myfs_fsck_issue::UNFINALIZED_RECORD, index - 1);
+        report.is_last_record_unfinalized = false;
+    }
+    if (d.start_address < cursor.data_area_start || d.start_address >= flash_size)
+    {
+        report_issue(report, myfs_fsck_issue::START_MISMATCH, index);
+        cursor.expected_start_offset = area_size;
+        return;
+    }
+    const uint32_t start_offset = to_offset(c, cursor, d.start_address);
+    if (start_offset != cursor.expected_start_offset || (d.start_address % page_size) != 0)
+    {
+        report_issue(report, myfs_fsck_issue::START_MISMATCH, index);
+    }
+
+    if (d.file_size == empty_word_value)
+    {
+        // end of this record can only be found by scanning the data area (it's done in the tail phase)
+        report.is_last_record_unfinalized = true;
+        cursor.expected_start_offset = start_offset;
+        return;
+    }
+    if (d.file_size > area_size - start_offset)
+    {
+        report_issue(report, myfs_fsck_issue::SIZE_OUT_OF_RANGE, index);
+        cursor.expected_start_offset = area_size;
+        return;
+    }
+    cursor.expected_start_offset = start_offset + ((d.file_size / page_size) + 1) * page_size;
+}
+
+void myfs_fsck_begin(myfs_fsck_cursor& cursor, myfs_fsck_report& report, const uint32_t tail_check_limit)
+{
+    cursor = myfs_fsck_cursor{};
+    cursor.tail_check_limit = tail_check_limit;
+    report = myfs_fsck_report{};
+}
+
+int myfs_fsck_step(const myfs_config& c,
+                   myfs_fsck_cursor& cursor,
+                   myfs_fsck_report& report,
+                   const uint32_t read_budget_bytes)
+{
+    uint8_t page[page_size];
+    const uint32_t budget_end = report.bytes_read + read_budget_bytes;
+
+    while (cursor.phase != myfs_fsck_phase::DONE && report.bytes_read < budget_end)
+    {
+        switch (cursor.phase)
+        {
+            case myfs_fsck_phase::MARKER: {
+                const auto read_result = read_page(c, report, 0, page);
+                if (read_result != 0)
+                {
+                    return read_result;
+                }
+                myfs_format_marker marker;
+                memcpy(&marker, page, sizeof(marker));
+                if (marker.magic != global_magic_value)
+                {
+                    report_issue(report, myfs_fsck_issue::BAD_MARKER, 0);
+                    cursor.phase = myfs_fsck_phase::DONE;
+                    break;
+                }
+                // same interpretation as at the mount: invalid values mean a legacy marker
+                cursor.table_size = (marker.table_size > 0 && marker.table_size < max_table_descriptors)
+                                        ? marker.table_size
+                                        : legacy_table_size;
+                cursor.data_area_start = cursor.table_size * single_file_descriptor_size_bytes;
+                if (cursor.data_area_start >= c.block_count * c.block_size)
+                {
+                    report_issue(report, myfs_fsck_issue::BAD_MARKER, 0);
+                    cursor.phase = myfs_fsck_phase::DONE;
+                    break;
+                }
+                cursor.generation_start_address = marker.generation_start_address;
+                if (cursor.generation_start_address < cursor.data_area_start ||
+                    cursor.generation_start_address >= c.block_count * c.block_size ||
+                    (cursor.generation_start_address % page_size) != 0)
+                {
+                    cursor.generation_start_address = cursor.data_area_start;
+                }
+                report.generation = (marker.generation == empty_word_value) ? 0 : marker.generation;
+                cursor.expected_start_offset = 0;
+                cursor.descriptor_index = 1;
+                cursor.phase = myfs_fsck_phase::DESCRIPTORS;
+                break;
+            }
+            case myfs_fsck_phase::DESCRIPTORS: {
+                const uint32_t page_address =
+                    ((cursor.descriptor_index * single_file_descriptor_size_bytes) / page_size) * page_size;
+                const auto read_result = read_page(c, report, page_address, page);
+                if (read_result != 0)
+                {
+                    return read_result;
+                }
+                const uint32_t last_index_in_page = page_address / single_file_descriptor_size_bytes + descriptors_per_page;
+                while (cursor.descriptor_index < last_index_in_page && cursor.descriptor_index < cursor.table_size)
+                {
+                    myfs_file_descriptor d;
+                    memcpy(&d,
+                           &page[cursor.descriptor_index * single_file_descriptor_size_bytes - page_address],
+                           sizeof(d));
+                    check_descriptor(c, cursor, report, d);
+                    cursor.descriptor_index++;
+                }
+                if (cursor.descriptor_index >= cursor.table_size)
+                {
+                    finish_descriptors(c, cursor, report);
+                }
+                break;
+            }
+            case myfs_fsck_phase::TAIL: {
+                if (cursor.tail_offset >= cursor.tail_end_offset)
+                {
+                    report.is_complete = true;
+                    cursor.phase = myfs_fsck_phase::DONE;
+                    break;
+                }
+                const uint32_t tail_address = to_address(c, cursor, cursor.tail_offset);
+                const auto read_result = read_page(c, report, tail_address, page);
+                if (read_result != 0)
+                {
+                    return read_result;
+                }
+                if (report.is_last_record_unfinalized && report.data_end_address == tail_address)
+                {
+                    // data of the unfinalized record continues until the first page that is erased as a whole,
+                    // as in myfs_repair: recorded data may contain erased words
+                    if (!is_page_erased(page))
+                    {
+                        cursor.tail_offset += page_size;
+                        report.data_end_address = to_address(c, cursor, cursor.tail_offset);
+                        break;
+                    }
+                }
+                if (!is_page_erased(page))
+                {
+                    report_issue(report, myfs_fsck_issue::TAIL_NOT_ERASED, tail_address);
+                }
+                report.tail_bytes_checked += page_size;
+                cursor.tail_offset += page_size;
+                break;
+            }
+            case myfs_fsck_phase::DONE:
+                break;
+        }
+    }
+
+    return (cursor.phase == myfs_fsck_phase::DONE) ? 0 : 1;
+}
+
+int myfs_fsck(const myfs_config& config, myfs_fsck_report& report, const uint32_t tail_check_limit)
+{
+    myfs_fsck_cursor cursor;
+    myfs_fsck_begin(cursor, report, tail_check_limit);
+    int result{1};
+    while (result == 1)
+    {
+        result = myfs_fsck_step(config, cursor, report, config.block_size);
+    }
+    return result;
+}
+
+bool myfs_fsck_is_clean(const myfs_fsck_report& report)
+{
+    for (const auto count : report.issues)
+    {
+        if (count > 0)
+        {
+            return false;
+        }
+    }
+    return report.is_complete;
+}
+
+const char* myfs_fsck_issue_name(const myfs_fsck_issue issue)
+{
+    switch (issue)
+    {
+        case myfs_fsck_issue::BAD_MARKER: return "bad marker";
+        case myfs_fsck_issue::BAD_DESCRIPTOR_MAGIC: return "bad descriptor magic";
+        case myfs_fsck_issue::DESCRIPTOR_AFTER_END: return "descriptor after end";
+        case myfs_fsck_issue::START_MISMATCH: return "start mismatch";
+        case myfs_fsck_issue::SIZE_OUT_OF_RANGE: return "size out of range";
+        case myfs_fsck_issue::UNFINALIZED_RECORD: return "unfinalized record";
+        case myfs_fsck_issue::TAIL_NOT_ERASED: return "tail not erased";
+        case myfs_fsck_issue::COUNT: break;
+    }
+    return "unknown";
+}
+
+} // namespace filesystem
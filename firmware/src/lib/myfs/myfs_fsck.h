@@ -0,0 +1,96 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "myfs.h"
+
+// Integrity checker of the myfs layout. It does not need a mounted FS (it only uses the block
+// device callbacks of the configuration), so it can be run both on the target and on raw dumps.
+// Check is split into steps with a bounded amount of read bytes, so it can be interleaved with
+// other operations of the owning task.
+namespace filesystem
+{
+
+/// Kinds of the detected inconsistencies
+enum class myfs_fsck_issue : uint8_t
+{
+    // format marker is missing or declares an invalid descriptor table size
+    BAD_MARKER,
+    // descriptor slot is neither empty nor contains a file descriptor
+    BAD_DESCRIPTOR_MAGIC,
+    // file descriptor found after the first empty slot
+    DESCRIPTOR_AFTER_END,
+    // file does not start where the previous one has ended (or is not page-aligned, or is outside of the data area)
+    START_MISMATCH,
+    // file end lies beyond the end of the flash
+    SIZE_OUT_OF_RANGE,
+    // file has no size written, while it is not the last one
+    UNFINALIZED_RECORD,
+    // data has been found after the end of the last file
+    TAIL_NOT_ERASED,
+    COUNT,
+};
+
+struct myfs_fsck_report
+{
+    uint32_t issues[static_cast<uint32_t>(myfs_fsck_issue::COUNT)]{0};
+    uint32_t generation{0};
+    uint32_t descriptors_checked{0};
+    uint32_t records_count{0};
+    // last record has no size written (f.e. it is paused or power has been lost), mount repairs it
+    bool is_last_record_unfinalized{false};
+    uint32_t data_end_address{0};
+    uint32_t tail_bytes_checked{0};
+    uint32_t bytes_read{0};
+    // index of the descriptor or address of the page, where the first issue has been detected
+    uint32_t first_issue_location{empty_word_value};
+    bool is_complete{false};
+};
+
+enum class myfs_fsck_phase : uint8_t
+{
+    MARKER,
+    DESCRIPTORS,
+    TAIL,
+    DONE,
+};
+
+/// Position of the check, allows to resume it in the next step
+struct myfs_fsck_cursor
+{
+    myfs_fsck_phase phase{myfs_fsck_phase::MARKER};
+    uint32_t table_size{0};
+    uint32_t data_area_start{0};
+    uint32_t generation_start_address{0};
+    uint32_t descriptor_index{1};
+    // data positions are offsets from the generation start (data wraps at the end of the flash)
+    uint32_t expected_start_offset{0};
+    bool is_table_end_found{false};
+    uint32_t tail_offset{0};
+    uint32_t tail_end_offset{0};
+    // 0 means check of the whole free part of the data area
+    uint32_t tail_check_limit{0};
+};
+
+/// @brief prepare the check. Previous report content is dropped.
+/// @param tail_check_limit amount of bytes after the end of the last file that should be verified to be erased
+void myfs_fsck_begin(myfs_fsck_cursor& cursor, myfs_fsck_report& report, uint32_t tail_check_limit = 0);
+
+/// @brief perform the next portion of the check.
+/// @param read_budget_bytes amount of bytes that can be read in this step (rounded up to a page)
+/// @return 0 when the check is complete, 1 if it should be continued, error code of the block device otherwise
+int myfs_fsck_step(const myfs_config& config,
+                   myfs_fsck_cursor& cursor,
+                   myfs_fsck_report& report,
+                   uint32_t read_budget_bytes);
+
+/// @brief run the whole check in one call
+int myfs_fsck(const myfs_config& config, myfs_fsck_report& report, uint32_t tail_check_limit = 0);
+
+bool myfs_fsck_is_clean(const myfs_fsck_report& report);
+
+const char* myfs_fsck_issue_name(myfs_fsck_issue issue);
+
+} // namespace filesystem
@@ -3,20 +3,20 @@
  * Copyright (c) 2024, Roman Turkin
  */
 
+#include "block_api_myfs.h"
 #include "myfs.h"
+#include "myfs_fsck.h"
+#include "simulated_flash.h"
 
 #include <gtest/gtest.h>
 
 #include <iostream>
+#include <memory>
+#include <vector>
 using namespace std;
 
 using namespace filesystem;
-
-int sim_read(const struct myfs_config* c, myfs_block_t block, myfs_off_t off, void* buffer, myfs_size_t size);
-int sim_prog(const struct myfs_config* c, myfs_block_t block, myfs_off_t off, const void* buffer, myfs_size_t size);
-int sim_erase(const struct myfs_config* c, myfs_block_t block);
-int sim_erase_multiple(const struct myfs_config* c, myfs_block_t block, uint32_t blocks_count);
-int sim_sync(const struct myfs_config* c);
+using namespace memory::block_device;
 
 static constexpr uint32_t MEMORY_SIMULATION_SIZE{16*1024*1024};
 static constexpr uint32_t MEMORY_SIMULATION_READ_SIZE{16};
@@ -24,17 +24,20 @@ static constexpr uint32_t MEMORY_SIMULATION_PROG_SIZE{256};
 static constexpr uint32_t MEMORY_SIMULATION_BLOCK_SIZE{4096};
 static constexpr uint8_t ERASED_MEMORY_CELL_VALUE{0xFFU};
 static constexpr uint32_t MEMORY_SIMULATION_BLOCK_COUNT{MEMORY_SIMULATION_SIZE / MEMORY_SIMULATION_BLOCK_SIZE};
-uint8_t memory_simulation[MEMORY_SIMULATION_SIZE];
+// file system accesses the simulated chip through the same block device layer, as on the target
+flash::SimulatedFlash simulated_flash{{MEMORY_SIMULATION_PROG_SIZE, MEMORY_SIMULATION_BLOCK_SIZE, MEMORY_SIMULATION_SIZE}};
+// raw content of the chip, for the corruption of the stored data
+uint8_t* const memory_simulation{simulated_flash.getMemory()};
 uint8_t sim_read_buffer[MEMORY_SIMULATION_PROG_SIZE];
 uint8_t sim_prog_buffer[MEMORY_SIMULATION_PROG_SIZE];
 
 filesystem::myfs_config cut_config {
     .context = nullptr,
-    .read = sim_read,
-    .prog = sim_prog,
-    .erase = sim_erase,
-    .erase_multiple = sim_erase_multiple,
-    .sync = sim_sync,
+    .read = myfs_read,
+    .prog = myfs_program,
+    .erase = myfs_erase,
+    .erase_multiple = myfs_erase_multiple,
+    .sync = myfs_sync,
 
     .read_size = MEMORY_SIMULATION_READ_SIZE,
     .prog_size = MEMORY_SIMULATION_PROG_SIZE,
@@ -43,6 +46,8 @@ filesystem::myfs_config cut_config {
 
     .read_buffer = sim_read_buffer,
     .prog_buffer = sim_prog_buffer,
+
+    .table_size = 0,
 };
 
 void dump_memory(uint8_t * buffer, uint32_t size);
@@ -52,7 +57,9 @@ protected:
     
     virtual void SetUp() 
     {
-        memset(memory_simulation, ERASED_MEMORY_CELL_VALUE, MEMORY_SIMULATION_SIZE);
+        simulated_flash.reset();
+        myfs_register_flash_device(
+            &simulated_flash, MEMORY_SIMULATION_BLOCK_SIZE, MEMORY_SIMULATION_PROG_SIZE, MEMORY_SIMULATION_SIZE);
     }
 
     void mountCut() 
@@ -119,7 +126,7 @@ TEST_F(MyfsTest, VerifySimulationCorrectness)
     {
         // check that per default memory is "erased"
         static constexpr uint32_t simple_read_size{16};
-        const auto read_res = sim_read(&cut_config, 10, 0, tmp, simple_read_size);
+        const auto read_res = myfs_read(&cut_config, 10, 0, tmp, simple_read_size);
         EXPECT_EQ(read_res, 0);
         for (auto i = 0; i < simple_read_size; ++i) 
         {
@@ -137,9 +144,9 @@ TEST_F(MyfsTest, VerifySimulationCorrectness)
         static constexpr uint32_t BLOCK_ID{150};
         static constexpr uint32_t TEST_SIZE{256};
 
-        const auto prog_res = sim_prog(&cut_config, BLOCK_ID, TEST_SIZE, tmp, MEMORY_SIMULATION_PROG_SIZE);
+        const auto prog_res = myfs_program(&cut_config, BLOCK_ID, TEST_SIZE, tmp, MEMORY_SIMULATION_PROG_SIZE);
         EXPECT_EQ(prog_res, 0);
-        const auto read_res = sim_read(&cut_config, BLOCK_ID, TEST_SIZE, tmp_read, MEMORY_SIMULATION_PROG_SIZE);
+        const auto read_res = myfs_read(&cut_config, BLOCK_ID, TEST_SIZE, tmp_read, MEMORY_SIMULATION_PROG_SIZE);
         EXPECT_EQ(read_res, 0);
 
         for (auto i = 0; i < sizeof(tmp); ++i) 
@@ -147,10 +154,10 @@ TEST_F(MyfsTest, VerifySimulationCorrectness)
             EXPECT_EQ(tmp_read[i], static_cast<uint8_t>(i));
         }
 
-        const auto erase_res = sim_erase(&cut_config, BLOCK_ID);
+        const auto erase_res = myfs_erase(&cut_config, BLOCK_ID);
         EXPECT_EQ(erase_res, 0);
 
-        const auto read_res_2 = sim_read(&cut_config, BLOCK_ID, TEST_SIZE, tmp_read, MEMORY_SIMULATION_PROG_SIZE);
+        const auto read_res_2 = myfs_read(&cut_config, BLOCK_ID, TEST_SIZE, tmp_read, MEMORY_SIMULATION_PROG_SIZE);
         EXPECT_EQ(read_res_2, 0);
         for (auto i = 0; i < MEMORY_SIMULATION_PROG_SIZE; ++i) 
         {
@@ -159,12 +166,12 @@ TEST_F(MyfsTest, VerifySimulationCorrectness)
     }
     {
         // verify fault cases
-        const auto read_res_1 = sim_read(&cut_config, 
+        const auto read_res_1 = myfs_read(&cut_config, 
             (MEMORY_SIMULATION_SIZE / MEMORY_SIMULATION_BLOCK_SIZE) - 1, 
             MEMORY_SIMULATION_BLOCK_SIZE - 1, tmp, 1);
         EXPECT_EQ(read_res_1, 0);
 
-        const auto read_res_2 = sim_read(&cut_config, 
+        const auto read_res_2 = myfs_read(&cut_config, 
             (MEMORY_SIMULATION_SIZE / MEMORY_SIMULATION_BLOCK_SIZE) - 1, 
             MEMORY_SIMULATION_BLOCK_SIZE + 1, tmp, 1);
 
@@ -442,78 +449,707 @@ TEST_F(MyfsTest, Create3rdFile)
     EXPECT_EQ(close_res_3, 0);
 }
 
-int sim_read(const struct myfs_config* c, myfs_block_t block, myfs_off_t off, void* buffer, myfs_size_t size) 
+TEST_F(MyfsTest, IoStatsAccounting)
 {
-    if (nullptr == c || nullptr == buffer) {
-        return -1;   
+    mountCut();
+    myfs_reset_io_stats(cut);
+
+    static constexpr uint32_t file_size{1000U};
+    static constexpr uint32_t tmp_buf_size{16};
+    uint8_t tmp[tmp_buf_size]{0};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 0);
+    myfs_file_t file;
+    const auto open_res = myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG);
+    ASSERT_EQ(open_res, 0);
+    uint32_t written_size = 0;
+    while (written_size < file_size)
+    {
+        const auto write_res = myfs_file_write(cut, file, tmp, tmp_buf_size);
+        ASSERT_EQ(write_res, 0);
+        written_size += tmp_buf_size;
+    }
+    const auto close_res = myfs_file_close(cut, file);
+    ASSERT_EQ(close_res, 0);
+
+    const auto& stats = myfs_get_io_stats(cut);
+    const auto& create_stats = stats.ops[static_cast<uint32_t>(myfs_op::CREATE)];
+    const auto& write_stats = stats.ops[static_cast<uint32_t>(myfs_op::WRITE)];
+    const auto& close_stats = stats.ops[static_cast<uint32_t>(myfs_op::CLOSE)];
+
+    EXPECT_EQ(stats.user_bytes_written, written_size);
+    EXPECT_EQ(stats.records_closed, 1);
+
+    // descriptor page update: read-modify-write
+    EXPECT_EQ(create_stats.calls, 1);
+    EXPECT_EQ(create_stats.reads, 1);
+    EXPECT_EQ(create_stats.programs, 1);
+
+    // only full pages are flushed during the write
+    EXPECT_EQ(write_stats.calls, written_size / tmp_buf_size);
+    EXPECT_EQ(write_stats.programs, written_size / page_size);
+    EXPECT_EQ(write_stats.bytes_programmed, (written_size / page_size) * page_size);
+    EXPECT_EQ(write_stats.reads, 0);
+
+    // tail flush and descriptor update
+    EXPECT_EQ(close_stats.programs, 2);
+    EXPECT_EQ(close_stats.erases, 0);
+
+    myfs_reset_io_stats(cut);
+    EXPECT_EQ(myfs_get_io_stats(cut).user_bytes_written, 0);
+    EXPECT_EQ(myfs_get_io_stats(cut).ops[static_cast<uint32_t>(myfs_op::WRITE)].programs, 0);
+}
+
+// content of the record at position i is (i % 251), so both parts of an appended record can be verified
+static void writePattern(myfs_t& fs, myfs_file_t& file, const uint32_t start_position, const uint32_t size)
+{
+    static constexpr uint32_t chunk_size{8};
+    uint8_t tmp[chunk_size];
+    for (uint32_t pos = start_position; pos < start_position + size; pos += chunk_size)
+    {
+        for (uint32_t i = 0; i < chunk_size; ++i)
+        {
+            tmp[i] = static_cast<uint8_t>((pos + i) % 251);
+        }
+        const auto write_res = myfs_file_write(fs, file, tmp, chunk_size);
+        ASSERT_EQ(write_res, 0);
+    }
+}
+
+static void verifyPattern(myfs_t& fs, uint8_t* file_id, const uint32_t size)
+{
+    myfs_file_t file;
+    const auto open_res = myfs_file_open(fs, file, file_id, MYFS_READ_FLAG);
+    ASSERT_EQ(open_res, 0);
+    ASSERT_EQ(file.size, size);
+    uint8_t tmp[64];
+    uint32_t position{0};
+    while (position < size)
+    {
+        uint32_t read_size{0};
+        const auto read_res = myfs_file_read(fs, file, tmp, sizeof(tmp), read_size);
+        ASSERT_EQ(read_res, 0);
+        ASSERT_GT(read_size, 0);
+        for (uint32_t i = 0; i < read_size; ++i)
+        {
+            ASSERT_EQ(tmp[i], static_cast<uint8_t>((position + i) % 251));
+        }
+        position += read_size;
     }
-    const auto start_address = block * c->block_size + off;
-    const auto end_address = block * c->block_size + off + size;
+    EXPECT_EQ(position, size);
+    myfs_file_close(fs, file);
+}
+
+TEST_F(MyfsTest, AppendToPausedRecord)
+{
+    mountCut();
+    static constexpr uint32_t first_part_size{1000U};
+    static constexpr uint32_t second_part_size{600U};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 0);
+
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, first_part_size);
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+    EXPECT_FALSE(file.is_open);
+    EXPECT_EQ(myfs_get_files_count(cut), 0);
+
+    myfs_file_t appended_file;
+    ASSERT_EQ(myfs_file_open(cut, appended_file, file_id, MYFS_APPEND_FLAG), 0);
+    EXPECT_EQ(appended_file.size + cut.buffer_position, first_part_size);
+    writePattern(cut, appended_file, first_part_size, second_part_size);
+    ASSERT_EQ(myfs_file_close(cut, appended_file), 0);
+    EXPECT_EQ(myfs_get_files_count(cut), 1);
+    EXPECT_EQ(myfs_file_get_size(cut, file_id), first_part_size + second_part_size);
+
+    myfs_t remounted{cut_config};
+    ASSERT_EQ(myfs_mount(remounted), 0);
+    verifyPattern(remounted, file_id, first_part_size + second_part_size);
+}
+
+TEST_F(MyfsTest, PausedRecordIsFinalizedOnCreate)
+{
+    mountCut();
+    static constexpr uint32_t first_file_size{1000U};
+    uint8_t first_id[myfs_file_descriptor::file_id_size + 1] {0};
+    uint8_t second_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(first_id), 9, "%08d", 0);
+    snprintf(reinterpret_cast<char*>(second_id), 9, "%08d", 1);
+
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, first_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, first_file_size);
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+
+    ASSERT_EQ(myfs_file_open(cut, file, second_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, 104);
+    ASSERT_EQ(myfs_file_close(cut, file), 0);
+
+    EXPECT_EQ(myfs_get_files_count(cut), 2);
+    EXPECT_EQ(myfs_file_get_size(cut, first_id), first_file_size);
+    EXPECT_EQ(myfs_file_get_size(cut, second_id), 104);
+
+    // only the most recent record can be appended
+    EXPECT_EQ(myfs_file_open(cut, file, first_id, MYFS_APPEND_FLAG), ERROR_FILE_NOT_FOUND);
+}
+
+TEST_F(MyfsTest, PausedRecordIsRecoveredOnMount)
+{
+    mountCut();
+    createFiles(3);
+    static constexpr uint32_t paused_file_size{1000U};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 3);
 
-    if (end_address > MEMORY_SIMULATION_SIZE)
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, paused_file_size);
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+
+    // power loss: the paused record is never finalized
+    myfs_t remounted{cut_config};
+    EXPECT_EQ(myfs_mount(remounted), REPAIR_HAS_BEEN_PERFORMED);
+    myfs_t repaired{cut_config};
+    ASSERT_EQ(myfs_mount(repaired), 0);
+    EXPECT_EQ(myfs_get_files_count(repaired), 4);
+    EXPECT_EQ(myfs_file_get_size(repaired, file_id), paused_file_size);
+    verifyPattern(repaired, file_id, paused_file_size);
+}
+
+TEST_F(MyfsTest, PausedRecordWithErasedWordsIsRecoveredOnMount)
+{
+    mountCut();
+    createFiles(1);
+    static constexpr uint32_t paused_file_size{8 * page_size + 40};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 1);
+
+    // some pages of the record start with an erased word, a search for the first such page stops early
+    std::vector<uint8_t> data(paused_file_size, 0x5A);
+    for (uint32_t page = 1; page < 8; page += 2)
     {
-        return -2;
+        memset(&data[page * page_size], 0xFF, sizeof(uint32_t));
     }
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    for (uint32_t pos = 0; pos < paused_file_size; pos += 8)
+    {
+        ASSERT_EQ(myfs_file_write(cut, file, &data[pos], 8), 0);
+    }
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+
+    // power loss: the paused record is never finalized
+    myfs_t remounted{cut_config};
+    EXPECT_EQ(myfs_mount(remounted), REPAIR_HAS_BEEN_PERFORMED);
+    myfs_t repaired{cut_config};
+    ASSERT_EQ(myfs_mount(repaired), 0);
+    EXPECT_EQ(myfs_get_files_count(repaired), 2);
+    EXPECT_EQ(myfs_file_get_size(repaired, file_id), paused_file_size);
+}
+
+TEST_F(MyfsTest, AppendRequiresPausedRecord)
+{
+    mountCut();
+    createFiles(1);
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 0);
+    myfs_file_t file;
+    EXPECT_EQ(myfs_file_open(cut, file, file_id, MYFS_APPEND_FLAG), ERROR_FILE_NOT_FOUND);
+
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 1);
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, 64);
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+
+    uint8_t other_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(other_id), 9, "%08d", 2);
+    EXPECT_EQ(myfs_file_open(cut, file, other_id, MYFS_APPEND_FLAG), ERROR_FILE_NOT_FOUND);
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_APPEND_FLAG), 0);
+    ASSERT_EQ(myfs_file_close(cut, file), 0);
+    EXPECT_EQ(myfs_file_get_size(cut, file_id), 64);
+}
+
+// record is stopped, the FS is handed over to BLE and back to audio, the record is started again
+TEST_F(MyfsTest, PausedRecordSurvivesRemount)
+{
+    mountCut();
+    createFiles(2);
+    static constexpr uint32_t first_part_size{1000U};
+    static constexpr uint32_t second_part_size{600U};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 2);
+
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, first_part_size);
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+
+    ASSERT_EQ(myfs_remount(cut), 0);
+    EXPECT_TRUE(cut.is_file_paused);
+    ASSERT_EQ(myfs_remount(cut), 0);
+
+    myfs_file_t appended_file;
+    ASSERT_EQ(myfs_file_open(cut, appended_file, file_id, MYFS_APPEND_FLAG), 0);
+    writePattern(cut, appended_file, first_part_size, second_part_size);
+    ASSERT_EQ(myfs_file_close(cut, appended_file), 0);
+    EXPECT_EQ(myfs_get_files_count(cut), 3);
+
+    myfs_t remounted{cut_config};
+    ASSERT_EQ(myfs_mount(remounted), 0);
+    verifyPattern(remounted, file_id, first_part_size + second_part_size);
+}
+
+TEST_F(MyfsTest, RemountWithoutPausedRecordMountsAnew)
+{
+    mountCut();
+    createFiles(2);
+    // another instance adds a record, the remount has to find it
+    myfs_t other{cut_config};
+    ASSERT_EQ(myfs_mount(other), 0);
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 2);
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(other, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(other, file, 0, 320);
+    ASSERT_EQ(myfs_file_close(other, file), 0);
+
+    ASSERT_EQ(myfs_remount(cut), 0);
+    EXPECT_EQ(myfs_get_files_count(cut), 3);
+    EXPECT_EQ(myfs_file_get_size(cut, file_id), 320);
+}
+
+static constexpr uint32_t fsck_tail_check_limit{64 * 1024};
+
+TEST_F(MyfsTest, FsckCleanFilesystem)
+{
+    mountCut();
+    createFiles(5);
+
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(cut_config, report), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_EQ(report.records_count, 5);
+    EXPECT_FALSE(report.is_last_record_unfinalized);
+    EXPECT_EQ(report.data_end_address, cut.next_file_start_address);
+    EXPECT_EQ(report.tail_bytes_checked, MEMORY_SIMULATION_SIZE - cut.next_file_start_address);
+}
+
+TEST_F(MyfsTest, FsckDetectsCorruption)
+{
+    mountCut();
+    createFiles(4);
+    const uint32_t data_end = cut.next_file_start_address;
+
+    // garbage after the last file
+    memory_simulation[data_end + 3 * page_size + 5] = 0x12;
+    // start of the 3rd file does not follow the 2nd one
+    myfs_file_descriptor d;
+    memcpy(&d, &memory_simulation[3 * single_file_descriptor_size_bytes], sizeof(d));
+    d.start_address += page_size;
+    memcpy(&memory_simulation[3 * single_file_descriptor_size_bytes], &d, sizeof(d));
+    // descriptor beyond the end of the table
+    memcpy(&memory_simulation[10 * single_file_descriptor_size_bytes], &file_magic_value, sizeof(file_magic_value));
+
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(cut_config, report, fsck_tail_check_limit), 0);
+    EXPECT_FALSE(myfs_fsck_is_clean(report));
+    EXPECT_EQ(report.issues[static_cast<uint32_t>(myfs_fsck_issue::TAIL_NOT_ERASED)], 1);
+    // both the shifted file and the one following it do not match
+    EXPECT_EQ(report.issues[static_cast<uint32_t>(myfs_fsck_issue::START_MISMATCH)], 2);
+    EXPECT_EQ(report.issues[static_cast<uint32_t>(myfs_fsck_issue::DESCRIPTOR_AFTER_END)], 1);
+    EXPECT_EQ(report.first_issue_location, 3);
+    EXPECT_EQ(report.tail_bytes_checked, fsck_tail_check_limit);
+
+    memory_simulation[0] = 0;
+    ASSERT_EQ(myfs_fsck(cut_config, report), 0);
+    EXPECT_EQ(report.issues[static_cast<uint32_t>(myfs_fsck_issue::BAD_MARKER)], 1);
+}
+
+TEST_F(MyfsTest, FsckPausedRecord)
+{
+    mountCut();
+    createFiles(2);
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 2);
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(cut, file, 0, 1000);
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+    const uint32_t record_start = cut.next_file_start_address;
+
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(cut_config, report, fsck_tail_check_limit), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_TRUE(report.is_last_record_unfinalized);
+    EXPECT_EQ(report.records_count, 3);
+    EXPECT_EQ(report.data_end_address, record_start + 4 * page_size);
+}
 
-    memcpy(buffer, &memory_simulation[start_address], size);
+TEST_F(MyfsTest, FsckPausedRecordWithErasedWords)
+{
+    mountCut();
+    createFiles(1);
+    static constexpr uint32_t paused_file_size{8 * page_size + 40};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 1);
 
-    return 0;
+    std::vector<uint8_t> data(paused_file_size, 0x5A);
+    for (uint32_t page = 1; page < 8; page += 2)
+    {
+        memset(&data[page * page_size], 0xFF, sizeof(uint32_t));
+    }
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(cut, file, file_id, MYFS_CREATE_FLAG), 0);
+    for (uint32_t pos = 0; pos < paused_file_size; pos += 8)
+    {
+        ASSERT_EQ(myfs_file_write(cut, file, &data[pos], 8), 0);
+    }
+    ASSERT_EQ(myfs_file_pause(cut, file), 0);
+    const uint32_t record_start = cut.next_file_start_address;
+
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(cut_config, report, fsck_tail_check_limit), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_TRUE(report.is_last_record_unfinalized);
+    EXPECT_EQ(report.data_end_address, record_start + 9 * page_size);
 }
 
-int sim_prog(const struct myfs_config* c, myfs_block_t block, myfs_off_t off, const void* buffer, myfs_size_t size) 
+TEST_F(MyfsTest, FsckRespectsReadBudget)
 {
-    if (nullptr == c || nullptr == buffer) {
-        return -1;   
+    mountCut();
+    createFiles(3);
+
+    myfs_fsck_report full_report;
+    ASSERT_EQ(myfs_fsck(cut_config, full_report, fsck_tail_check_limit), 0);
+
+    myfs_fsck_cursor cursor;
+    myfs_fsck_report report;
+    myfs_fsck_begin(cursor, report, fsck_tail_check_limit);
+    uint32_t steps_count{0};
+    int result{1};
+    while (result == 1)
+    {
+        const uint32_t bytes_read_before = report.bytes_read;
+        result = myfs_fsck_step(cut_config, cursor, report, page_size);
+        EXPECT_LE(report.bytes_read - bytes_read_before, page_size);
+        ++steps_count;
     }
-    const auto start_address = block * c->block_size + off;
-    const auto end_address = block * c->block_size + off + size;
+    ASSERT_EQ(result, 0);
+    EXPECT_EQ(report.bytes_read, full_report.bytes_read);
+    EXPECT_GE(steps_count, report.bytes_read / page_size);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_EQ(report.records_count, full_report.records_count);
+}
+
+// Flash of a smaller size, so that the whole data area can be filled many times in a reasonable time
+static constexpr uint32_t SMALL_FLASH_BLOCK_COUNT{256};
 
-    if (end_address > MEMORY_SIMULATION_SIZE)
+static int mountOrFormat(myfs_t& fs)
+{
+    const auto mount_result = myfs_mount(fs);
+    if (mount_result == 0)
+    {
+        return 0;
+    }
+    const auto format_result = myfs_format(fs);
+    if (format_result != 0)
     {
-        return -2;
+        return format_result;
     }
+    return myfs_mount(fs);
+}
 
-    memcpy(&memory_simulation[start_address], buffer, size);
-    return 0;
+// writes a record of (at most) the given size in page-sized chunks, returns the written size
+static uint32_t fillRecord(myfs_t& fs, const uint32_t id, const uint32_t size)
+{
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08u", id);
+    myfs_file_t file;
+    if (myfs_file_open(fs, file, file_id, MYFS_CREATE_FLAG) != 0)
+    {
+        return 0;
+    }
+    uint8_t tmp[page_size];
+    memset(tmp, static_cast<uint8_t>(id), sizeof(tmp));
+    uint32_t written_size{0};
+    while (written_size < size && myfs_file_write(fs, file, tmp, sizeof(tmp)) == 0)
+    {
+        written_size += sizeof(tmp);
+    }
+    myfs_file_close(fs, file);
+    return written_size;
 }
 
-int sim_erase(const struct myfs_config* c, myfs_block_t block) {
-    if (nullptr == c) 
+TEST_F(MyfsTest, FormatStartsNextGenerationAfterWrittenArea)
+{
+    mountCut();
+    EXPECT_EQ(cut.generation, 0);
+    EXPECT_EQ(cut.generation_start_address, first_file_start_location);
+    createFiles(3);
+    const uint32_t data_end = cut.next_file_start_address;
+    const uint32_t erases_before_format = myfs_get_io_stats(cut).ops[static_cast<uint32_t>(myfs_op::FORMAT)].erases;
+
+    ASSERT_EQ(myfs_format(cut), 0);
+    // only the descriptors table and the written sectors are erased
+    const uint32_t expected_next_start =
+        ((data_end + MEMORY_SIMULATION_BLOCK_SIZE - 1) / MEMORY_SIMULATION_BLOCK_SIZE) * MEMORY_SIMULATION_BLOCK_SIZE;
+    const uint32_t format_erases =
+        myfs_get_io_stats(cut).ops[static_cast<uint32_t>(myfs_op::FORMAT)].erases - erases_before_format;
+    EXPECT_EQ(format_erases, expected_next_start / MEMORY_SIMULATION_BLOCK_SIZE);
+
+    ASSERT_EQ(myfs_mount(cut), 0);
+    EXPECT_EQ(cut.generation, 1);
+    EXPECT_EQ(cut.generation_start_address, expected_next_start);
+    EXPECT_EQ(cut.next_file_start_address, expected_next_start);
+    EXPECT_EQ(myfs_get_files_count(cut), 0);
+    for (uint32_t address = first_file_start_location; address < data_end; ++address)
     {
-        return -1;
+        ASSERT_EQ(memory_simulation[address], ERASED_MEMORY_CELL_VALUE);
     }
-    const auto sector_start = block * c->block_size;
-    const auto sector_end = (block + 1) * c->block_size - 1;
 
-    if (sector_end >= MEMORY_SIMULATION_SIZE) 
+    createFiles(2);
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(cut_config, report, fsck_tail_check_limit), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_EQ(report.generation, 1);
+    EXPECT_EQ(report.records_count, 2);
+}
+
+TEST_F(MyfsTest, FormatAfterMountOfFullFilesystem)
+{
+    myfs_config small_config{cut_config};
+    small_config.block_count = SMALL_FLASH_BLOCK_COUNT;
+    const uint32_t flash_size = SMALL_FLASH_BLOCK_COUNT * MEMORY_SIMULATION_BLOCK_SIZE;
+    myfs_t fs{small_config};
+    ASSERT_EQ(mountOrFormat(fs), 0);
+    // record takes the whole data area
+    ASSERT_GT(fillRecord(fs, 0, flash_size), flash_size - first_file_start_location - 1024);
+    myfs_unmount(fs);
+
+    // reboot: the full FS is discovered by the mount
+    myfs_t full{small_config};
+    ASSERT_EQ(myfs_mount(full), NO_SPACE_LEFT);
+    EXPECT_TRUE(full.is_full);
+    ASSERT_EQ(myfs_format(full), 0);
+    for (uint32_t address = first_file_start_location; address < flash_size; ++address)
     {
-        return -2;
+        ASSERT_EQ(memory_simulation[address], ERASED_MEMORY_CELL_VALUE) << "address " << address;
     }
 
-    memset(&memory_simulation[sector_start], ERASED_MEMORY_CELL_VALUE, c->block_size);
-    return 0;
+    ASSERT_EQ(myfs_mount(full), 0);
+    EXPECT_EQ(myfs_get_files_count(full), 0);
+    ASSERT_EQ(fillRecord(full, 0, 64 * 1024), 64 * 1024);
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(small_config, report), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+}
+
+TEST_F(MyfsTest, RecordWrapsAroundEndOfFlash)
+{
+    myfs_config small_config{cut_config};
+    small_config.block_count = SMALL_FLASH_BLOCK_COUNT;
+    const uint32_t flash_size = SMALL_FLASH_BLOCK_COUNT * MEMORY_SIMULATION_BLOCK_SIZE;
+    myfs_t fs{small_config};
+    ASSERT_EQ(mountOrFormat(fs), 0);
+    const uint32_t first_generation_size = flash_size - first_file_start_location - 64 * 1024;
+    ASSERT_GT(fillRecord(fs, 0, first_generation_size), 0);
+    ASSERT_EQ(myfs_format(fs), 0);
+    ASSERT_EQ(myfs_mount(fs), 0);
+    ASSERT_GT(fs.generation_start_address, flash_size - 64 * 1024);
+
+    // 200kB record starts in the end of the flash and continues after the descriptors table
+    static constexpr uint32_t wrapped_record_size{200 * 1024};
+    uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+    snprintf(reinterpret_cast<char*>(file_id), 9, "%08d", 7);
+    myfs_file_t file;
+    ASSERT_EQ(myfs_file_open(fs, file, file_id, MYFS_CREATE_FLAG), 0);
+    writePattern(fs, file, 0, wrapped_record_size);
+    ASSERT_EQ(myfs_file_close(fs, file), 0);
+    EXPECT_LT(fs.next_file_start_address, fs.generation_start_address);
+    EXPECT_NE(memory_simulation[first_file_start_location], ERASED_MEMORY_CELL_VALUE);
+
+    myfs_t remounted{small_config};
+    ASSERT_EQ(myfs_mount(remounted), 0);
+    EXPECT_EQ(remounted.next_file_start_address, fs.next_file_start_address);
+    verifyPattern(remounted, file_id, wrapped_record_size);
+
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(small_config, report), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_EQ(report.data_end_address, fs.next_file_start_address);
+    myfs_unmount(remounted);
 }
 
+// Simulation of many fill/format cycles with varying fill levels, erase count of every sector is reported
+TEST_F(MyfsTest, WearLevelledFormatCycles)
+{
+    static constexpr uint32_t cycles_count{2000};
+    myfs_config small_config{cut_config};
+    small_config.block_count = SMALL_FLASH_BLOCK_COUNT;
+    const uint32_t table_blocks = first_file_start_location / MEMORY_SIMULATION_BLOCK_SIZE;
+    const uint32_t data_area_size = SMALL_FLASH_BLOCK_COUNT * MEMORY_SIMULATION_BLOCK_SIZE - first_file_start_location;
+
+    myfs_t fs{small_config};
+    ASSERT_EQ(mountOrFormat(fs), 0);
+    // erases of the initial format are not a part of the cycles
+    std::vector<uint32_t> initial_erase_counts(SMALL_FLASH_BLOCK_COUNT, 0);
+    for (uint32_t block = 0; block < SMALL_FLASH_BLOCK_COUNT; ++block)
+    {
+        initial_erase_counts[block] = simulated_flash.getEraseCount(block);
+    }
 
-int sim_erase_multiple(const struct myfs_config* c, myfs_block_t block, uint32_t blocks_count) 
+    // deterministic pseudo-random fill levels (5..60% of the data area) and record sizes (4..132kB)
+    uint32_t lcg{12345U};
+    auto next_random = [&lcg]() {
+        lcg = lcg * 1103515245U + 12345U;
+        return (lcg >> 8);
+    };
+    uint32_t record_id{0};
+    for (uint32_t cycle = 0; cycle < cycles_count; ++cycle)
+    {
+        const uint32_t fill_size = data_area_size / 100 * (5 + next_random() % 56);
+        uint32_t filled{0};
+        while (filled < fill_size)
+        {
+            const uint32_t record_size = 4096 + (next_random() % (128 * 1024));
+            const auto written = fillRecord(fs, record_id++, record_size);
+            ASSERT_GT(written, 0);
+            filled += written;
+        }
+        ASSERT_EQ(myfs_format(fs), 0);
+        ASSERT_EQ(myfs_mount(fs), 0);
+    }
+    EXPECT_EQ(fs.generation, cycles_count);
+
+    uint32_t min_erases{0xFFFFFFFFUL};
+    uint32_t max_erases{0};
+    uint64_t total_erases{0};
+    for (uint32_t block = table_blocks; block < SMALL_FLASH_BLOCK_COUNT; ++block)
+    {
+        const uint32_t erases = simulated_flash.getEraseCount(block) - initial_erase_counts[block];
+        min_erases = std::min(min_erases, erases);
+        max_erases = std::max(max_erases, erases);
+        total_erases += erases;
+    }
+    const uint32_t data_blocks = SMALL_FLASH_BLOCK_COUNT - table_blocks;
+    cout << "wear levelling: " << cycles_count << " cycles, data sector erases min/max/avg = " 
+         << min_erases << "/" << max_erases << "/" << (total_erases / data_blocks)
+         << ", table sector erases = " << (simulated_flash.getEraseCount(0) - initial_erase_counts[0])
+         << ", full-chip format would erase every sector " << cycles_count << " times" << endl;
+
+    // written areas of consecutive generations tile the data area
+    EXPECT_LE(max_erases - min_erases, 1);
+    EXPECT_LT(max_erases, cycles_count);
+}
+
+struct FlashGeometry
 {
-    if (nullptr == c) 
+    uint32_t total_size;
+    uint32_t block_size;
+    uint32_t expected_table_size;
+};
+
+class MyfsGeometryTest: public ::testing::TestWithParam<FlashGeometry> {
+protected:
+    virtual void SetUp()
     {
-        return -1;
+        const auto geometry = GetParam();
+        flash.reset(new flash::SimulatedFlash{{MEMORY_SIMULATION_PROG_SIZE, geometry.block_size, geometry.total_size}});
+        myfs_register_flash_device(flash.get(), geometry.block_size, MEMORY_SIMULATION_PROG_SIZE, geometry.total_size);
+        config = cut_config;
+        config.block_size = geometry.block_size;
+        config.block_count = geometry.total_size / geometry.block_size;
     }
 
-    for (auto i = 0; i < blocks_count; ++i) {
-        const auto result = sim_erase(c, block + i);
-        if (result != 0) 
+    std::unique_ptr<flash::SimulatedFlash> flash;
+    myfs_config config;
+};
+
+TEST_P(MyfsGeometryTest, TableScalesWithCapacity)
+{
+    EXPECT_EQ(myfs_get_table_size(config), GetParam().expected_table_size);
+    myfs_t fs{config};
+    ASSERT_EQ(mountOrFormat(fs), 0);
+    EXPECT_EQ(fs.data_area_start, GetParam().expected_table_size);
+    EXPECT_EQ(fs.next_file_start_address, GetParam().expected_table_size);
+    EXPECT_EQ(myfs_get_files_capacity(fs), GetParam().expected_table_size / single_file_descriptor_size_bytes - 2);
+    myfs_unmount(fs);
+}
+
+TEST_P(MyfsGeometryTest, RecordsSurviveRemount)
+{
+    static constexpr uint32_t records_count{5};
+    static constexpr uint32_t record_size{300 * 1024};
+    // some records are placed at the end of the device, beyond the 16MB boundary for the larger ones
+    const uint32_t end_record_size = config.block_count * config.block_size / 2;
+    {
+        myfs_t fs{config};
+        ASSERT_EQ(mountOrFormat(fs), 0);
+        for (uint32_t i = 0; i < records_count; ++i)
         {
-            return result;
+            uint8_t file_id[myfs_file_descriptor::file_id_size + 1] {0};
+            snprintf(reinterpret_cast<char*>(file_id), 9, "%08u", i);
+            myfs_file_t file;
+            ASSERT_EQ(myfs_file_open(fs, file, file_id, MYFS_CREATE_FLAG), 0);
+            writePattern(fs, file, 0, (i == 2) ? end_record_size : record_size);
+            ASSERT_EQ(myfs_file_close(fs, file), 0);
         }
+        myfs_unmount(fs);
     }
-    return 0;
+
+    myfs_t fs{config};
+    ASSERT_EQ(myfs_mount(fs), 0);
+    EXPECT_EQ(myfs_get_files_count(fs), records_count);
+    ASSERT_EQ(myfs_rewind_dir(fs), 0);
+    for (uint32_t i = 0; i < records_count; ++i)
+    {
+        uint8_t expected_id[myfs_file_descriptor::file_id_size + 1] {0};
+        snprintf(reinterpret_cast<char*>(expected_id), 9, "%08u", i);
+        uint8_t file_id[myfs_file_descriptor::file_id_size] {0};
+        ASSERT_EQ(myfs_get_next_id(fs, file_id), 1);
+        EXPECT_EQ(memcmp(file_id, expected_id, myfs_file_descriptor::file_id_size), 0);
+        verifyPattern(fs, expected_id, (i == 2) ? end_record_size : record_size);
+    }
+
+    myfs_fsck_report report;
+    ASSERT_EQ(myfs_fsck(config, report, fsck_tail_check_limit), 0);
+    EXPECT_TRUE(myfs_fsck_is_clean(report));
+    EXPECT_EQ(report.records_count, records_count);
+    myfs_unmount(fs);
 }
 
-int sim_sync(const struct myfs_config* c) {
-    return 0;
+TEST_P(MyfsGeometryTest, FormatRotatesGenerations)
+{
+    myfs_t fs{config};
+    ASSERT_EQ(mountOrFormat(fs), 0);
+    for (uint32_t generation = 1; generation < 4; ++generation)
+    {
+        ASSERT_GT(fillRecord(fs, generation, 64 * 1024), 0);
+        ASSERT_EQ(myfs_format(fs), 0);
+        ASSERT_EQ(myfs_mount(fs), 0);
+        EXPECT_EQ(fs.generation, generation);
+        EXPECT_EQ(fs.generation_start_address % config.block_size, 0);
+        EXPECT_EQ(myfs_get_files_count(fs), 0);
+    }
+    myfs_unmount(fs);
+}
+
+INSTANTIATE_TEST_SUITE_P(NorSizes,
+                         MyfsGeometryTest,
+                         ::testing::Values(FlashGeometry{4 * 1024 * 1024, 4096, 8192},
+                                           FlashGeometry{32 * 1024 * 1024, 4096, 16 * 1024},
+                                           FlashGeometry{64 * 1024 * 1024, 4096, 32 * 1024},
+                                           FlashGeometry{128 * 1024 * 1024, 4096, 64 * 1024},
+                                           FlashGeometry{32 * 1024 * 1024, 64 * 1024, 64 * 1024}));
+
+TEST_F(MyfsTest, UnsupportedGeometryIsRejected)
+{
+    myfs_config config{cut_config};
+    config.prog_size = 512;
+    myfs_t fs{config};
+    EXPECT_EQ(myfs_format(fs), INVALID_PARAMETERS);
+    EXPECT_EQ(myfs_mount(fs), INVALID_PARAMETERS);
 }
 
 void dump_memory(uint8_t * buffer, uint32_t size)
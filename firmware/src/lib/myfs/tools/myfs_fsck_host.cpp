@@ -0,0 +1,99 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+// Host version of the myfs integrity check, runs on a raw dump of the flash memory.
+// Usage: myfs_fsck <dump file> [block size, default 4096] [FS size in bytes]
+// FS size defaults to the dump size without the last sector, that is reserved on the target (see task_memory).
+
+#include "myfs_fsck.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace filesystem;
+
+static std::vector<uint8_t> dump;
+
+static int dump_read(const myfs_config* c, myfs_block_t block, myfs_off_t off, void* buffer, myfs_size_t size)
+{
+    const uint64_t address = static_cast<uint64_t>(block) * c->block_size + off;
+    if (address + size > dump.size())
+    {
+        return INVALID_PARAMETERS;
+    }
+    memcpy(buffer, &dump[address], size);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <dump file> [block size] [FS size]\n", argv[0]);
+        return 2;
+    }
+    const uint32_t block_size = (argc > 2) ? static_cast<uint32_t>(strtoul(argv[2], nullptr, 0)) : 4096U;
+    if (block_size == 0 || block_size % page_size != 0)
+    {
+        fprintf(stderr, "block size should be a multiple of %u\n", page_size);
+        return 2;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input)
+    {
+        fprintf(stderr, "failed to open %s\n", argv[1]);
+        return 2;
+    }
+    dump.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+
+    const uint64_t default_fs_size = (dump.size() > block_size) ? dump.size() - block_size : 0;
+    const uint64_t fs_size = (argc > 3) ? strtoull(argv[3], nullptr, 0) : default_fs_size;
+    if (fs_size == 0 || fs_size % block_size != 0 || fs_size > dump.size())
+    {
+        fprintf(stderr, "FS size should be a non-zero multiple of the block size, within the dump\n");
+        return 2;
+    }
+
+    myfs_config config{};
+    config.read = dump_read;
+    config.read_size = page_size;
+    config.prog_size = page_size;
+    config.block_size = block_size;
+    config.block_count = static_cast<uint32_t>(fs_size / block_size);
+
+    myfs_fsck_report report;
+    const auto result = myfs_fsck(config, report);
+    if (result != 0)
+    {
+        fprintf(stderr, "read of the dump failed (%d)\n", result);
+        return 2;
+    }
+
+    printf("generation:       %u\n", report.generation);
+    printf("records:          %u\n", report.records_count);
+    printf("descriptors:      %u\n", report.descriptors_checked);
+    printf("data end:         0x%08x\n", report.data_end_address);
+    printf("tail checked:     %u bytes\n", report.tail_bytes_checked);
+    printf("last unfinalized: %s\n", report.is_last_record_unfinalized ? "yes" : "no");
+    for (uint32_t i = 0; i < static_cast<uint32_t>(myfs_fsck_issue::COUNT); ++i)
+    {
+        if (report.issues[i] > 0)
+        {
+            printf("issue: %-22s x%u\n", myfs_fsck_issue_name(static_cast<myfs_fsck_issue>(i)), report.issues[i]);
+        }
+    }
+    if (report.first_issue_location != empty_word_value)
+    {
+        printf("first issue at:   0x%08x\n", report.first_issue_location);
+    }
+    const bool is_clean = myfs_fsck_is_clean(report);
+    printf("%s\n", is_clean ? "clean" : "CORRUPT");
+    return is_clean ? 0 : 1;
+}
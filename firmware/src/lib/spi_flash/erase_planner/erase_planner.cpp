@@ -0,0 +1,133 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "erase_planner.h"
+
+namespace flash
+{
+
+static constexpr uint32_t sector_4k_size{0x1000};
+static constexpr uint32_t block_32k_size{0x8000};
+static constexpr uint32_t block_64k_size{0x10000};
+static constexpr uint64_t unsupported_cost{0xFFFFFFFFFFFFULL};
+
+uint32_t get_erase_size(const EraseType type, const uint32_t device_size)
+{
+    switch(type)
+    {
+    case EraseType::SECTOR_4K: return sector_4k_size;
+    case EraseType::BLOCK_32K: return block_32k_size;
+    case EraseType::BLOCK_64K: return block_64k_size;
+    case EraseType::CHIP: return device_size;
+    case EraseType::COUNT: break;
+    }
+    return 0;
+}
+
+static uint64_t get_duration(const EraseTiming& timing, const EraseType type)
+{
+    return (timing.get(type) > 0) ? timing.get(type) : unsupported_cost;
+}
+
+static bool append_command(ErasePlan& plan, const EraseType type, const uint32_t address, const uint32_t size)
+{
+    if(plan.steps_count > 0)
+    {
+        auto& last = plan.steps[plan.steps_count - 1];
+        if(last.type == type && last.address + last.count * size == address)
+        {
+            last.count++;
+            plan.commands_count++;
+            return true;
+        }
+    }
+    if(plan.steps_count == ErasePlan::max_steps)
+    {
+        return false;
+    }
+    plan.steps[plan.steps_count++] = EraseStep{type, address, 1};
+    plan.commands_count++;
+    return true;
+}
+
+bool plan_erase(const uint32_t address,
+                const uint32_t size,
+                const uint32_t device_size,
+                const EraseTiming& timing,
+                ErasePlan& plan)
+{
+    plan = ErasePlan{};
+    if(size == 0 || (address % sector_4k_size) != 0 || (size % sector_4k_size) != 0 || address >= device_size ||
+       size > device_size - address || timing.get(EraseType::SECTOR_4K) == 0)
+    {
+        return false;
+    }
+
+    // Larger blocks are aligned and consist of the smaller ones, so an aligned block is erased
+    // either by its own command or by the fastest way to erase its halves (or 4K parts).
+    const uint64_t cost_4k = get_duration(timing, EraseType::SECTOR_4K);
+    const uint64_t own_cost_32k = get_duration(timing, EraseType::BLOCK_32K);
+    const uint64_t cost_32k = (own_cost_32k < 8 * cost_4k) ? own_cost_32k : 8 * cost_4k;
+    const uint64_t own_cost_64k = get_duration(timing, EraseType::BLOCK_64K);
+    const uint64_t cost_64k = (own_cost_64k < 2 * cost_32k) ? own_cost_64k : 2 * cost_32k;
+    const bool is_64k_used = (own_cost_64k == cost_64k);
+    const bool is_32k_used = (own_cost_32k == cost_32k);
+
+    uint64_t duration{0};
+    uint32_t position{address};
+    const uint32_t end{address + size};
+    while(position < end)
+    {
+        const uint32_t left = end - position;
+        EraseType type{EraseType::SECTOR_4K};
+        uint64_t cost{cost_4k};
+        if(is_64k_used && (position % block_64k_size) == 0 && left >= block_64k_size)
+        {
+            type = EraseType::BLOCK_64K;
+            cost = cost_64k;
+        }
+        else if(is_32k_used && (position % block_32k_size) == 0 && left >= block_32k_size)
+        {
+            type = EraseType::BLOCK_32K;
+            cost = cost_32k;
+        }
+        const uint32_t erase_size = get_erase_size(type, device_size);
+        if(!append_command(plan, type, position, erase_size))
+        {
+            return false;
+        }
+        duration += cost;
+        position += erase_size;
+    }
+
+    const uint64_t chip_cost = get_duration(timing, EraseType::CHIP);
+    if(address == 0 && size == device_size && chip_cost < duration)
+    {
+        plan = ErasePlan{};
+        append_command(plan, EraseType::CHIP, 0, device_size);
+        duration = chip_cost;
+    }
+    plan.estimated_duration_ms = (duration > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : static_cast<uint32_t>(duration);
+    return true;
+}
+
+bool execute_erase_plan(const ErasePlan& plan, const uint32_t device_size, const EraseCommandFunction& erase_command)
+{
+    for(uint32_t i = 0; i < plan.steps_count; ++i)
+    {
+        const auto& step = plan.steps[i];
+        const uint32_t erase_size = get_erase_size(step.type, device_size);
+        for(uint32_t j = 0; j < step.count; ++j)
+        {
+            if(!erase_command(step.type, step.address + j * erase_size))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace flash
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+
+// Erase planner splits an erased range of NOR flash into the sequence of erase commands with
+// the smallest total duration, according to the typical durations of the commands.
+// It doesn't depend on the driver, so plans can be verified on the host.
+namespace flash
+{
+
+enum class EraseType : uint8_t
+{
+    SECTOR_4K,
+    BLOCK_32K,
+    BLOCK_64K,
+    CHIP,
+    COUNT,
+};
+
+/// Typical durations of the erase commands in milliseconds. 0 means that the command is not supported.
+struct EraseTiming
+{
+    uint32_t duration_ms[static_cast<uint32_t>(EraseType::COUNT)];
+
+    uint32_t get(const EraseType type) const
+    {
+        return duration_ms[static_cast<uint32_t>(type)];
+    }
+};
+
+/// Datasheet values of the W25Q128JV (typical)
+static constexpr EraseTiming default_erase_timing{{45, 120, 150, 40000}};
+
+/// `count` commands of the same type, applied to consecutive areas starting at `address`
+struct EraseStep
+{
+    EraseType type;
+    uint32_t address;
+    uint32_t count;
+};
+
+struct ErasePlan
+{
+    // aligned range needs at most 5 steps: 4K, 32K, 64K, 32K and 4K erases
+    static constexpr uint32_t max_steps{8};
+    EraseStep steps[max_steps];
+    uint32_t steps_count{0};
+    uint32_t commands_count{0};
+    uint32_t estimated_duration_ms{0};
+};
+
+/// size of the area erased by a single command of the given type
+uint32_t get_erase_size(EraseType type, uint32_t device_size);
+
+/// @brief build the plan of the fastest erase of the range
+/// @return false if the range is not aligned to 4K, doesn't fit the device or 4K erase is not supported
+bool plan_erase(uint32_t address, uint32_t size, uint32_t device_size, const EraseTiming& timing, ErasePlan& plan);
+
+/// Performs a single erase command and waits for its completion, returns false on failure
+using EraseCommandFunction = std::function<bool(EraseType type, uint32_t address)>;
+
+/// @brief issue the commands of the plan one by one
+/// @return false if one of the commands has failed (following commands are not issued)
+bool execute_erase_plan(const ErasePlan& plan, uint32_t device_size, const EraseCommandFunction& erase_command);
+
+} // namespace flash
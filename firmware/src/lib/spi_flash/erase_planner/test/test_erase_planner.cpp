@@ -0,0 +1,201 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "erase_planner.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace flash;
+
+static constexpr uint32_t device_size{1024 * 1024};
+static constexpr uint32_t sector_size{0x1000};
+
+struct ExecutedCommand
+{
+    EraseType type;
+    uint32_t address;
+};
+
+// Issues the commands of the plan against a timing model of the chip: every command takes its
+// typical time, so the sum has to match the estimation of the planner.
+static bool simulate(const ErasePlan& plan,
+                     const EraseTiming& model,
+                     std::vector<ExecutedCommand>& commands,
+                     uint32_t& duration_ms)
+{
+    duration_ms = 0;
+    return execute_erase_plan(plan, device_size, [&](const EraseType type, const uint32_t address) {
+        commands.push_back({type, address});
+        duration_ms += model.get(type);
+        return true;
+    });
+}
+
+// Commands shall erase exactly the requested range, each one aligned to its own size
+static void expect_exact_coverage(const std::vector<ExecutedCommand>& commands, uint32_t address, uint32_t size)
+{
+    uint32_t position{address};
+    for(const auto& command : commands)
+    {
+        const uint32_t erase_size = get_erase_size(command.type, device_size);
+        EXPECT_EQ(command.address, position);
+        EXPECT_EQ(command.address % erase_size, 0U);
+        position += erase_size;
+    }
+    EXPECT_EQ(position, address + size);
+}
+
+// Reference: fastest erase of [address, address + size) over 4K steps, chip erase excluded
+static uint64_t brute_force_duration(uint32_t address, uint32_t size, const EraseTiming& timing)
+{
+    const uint32_t units = size / sector_size;
+    const uint64_t infinity{0xFFFFFFFFFFFFULL};
+    std::vector<uint64_t> best(units + 1, infinity);
+    best[0] = 0;
+    for(uint32_t i = 0; i < units; ++i)
+    {
+        if(best[i] == infinity)
+        {
+            continue;
+        }
+        for(const auto type : {EraseType::SECTOR_4K, EraseType::BLOCK_32K, EraseType::BLOCK_64K})
+        {
+            const uint32_t erase_size = get_erase_size(type, device_size);
+            const uint32_t position = address + i * sector_size;
+            const uint32_t next = i + erase_size / sector_size;
+            if(timing.get(type) == 0 || (position % erase_size) != 0 || next > units)
+            {
+                continue;
+            }
+            if(best[i] + timing.get(type) < best[next])
+            {
+                best[next] = best[i] + timing.get(type);
+            }
+        }
+    }
+    return best[units];
+}
+
+TEST(ErasePlannerTest, UnalignedRangesAreRejected)
+{
+    ErasePlan plan;
+    EXPECT_FALSE(plan_erase(0x800, sector_size, device_size, default_erase_timing, plan));
+    EXPECT_FALSE(plan_erase(0, 0x800, device_size, default_erase_timing, plan));
+    EXPECT_FALSE(plan_erase(0, 0, device_size, default_erase_timing, plan));
+    EXPECT_FALSE(plan_erase(device_size - sector_size, 2 * sector_size, device_size, default_erase_timing, plan));
+    const EraseTiming no_sector_erase{{0, 120, 150, 40000}};
+    EXPECT_FALSE(plan_erase(0, sector_size, device_size, no_sector_erase, plan));
+}
+
+TEST(ErasePlannerTest, LargestBlocksAreUsedInsideTheRange)
+{
+    // 3 sectors, 1 32K block, 2 64K blocks, 1 32K block, 2 sectors
+    const uint32_t address{0x5000};
+    const uint32_t size{3 * 0x1000 + 0x8000 + 2 * 0x10000 + 0x8000 + 2 * 0x1000};
+    ErasePlan plan;
+    ASSERT_TRUE(plan_erase(address, size, device_size, default_erase_timing, plan));
+
+    ASSERT_EQ(plan.steps_count, 5U);
+    EXPECT_EQ(plan.steps[0].type, EraseType::SECTOR_4K);
+    EXPECT_EQ(plan.steps[0].count, 3U);
+    EXPECT_EQ(plan.steps[1].type, EraseType::BLOCK_32K);
+    EXPECT_EQ(plan.steps[1].address, 0x8000U);
+    EXPECT_EQ(plan.steps[2].type, EraseType::BLOCK_64K);
+    EXPECT_EQ(plan.steps[2].count, 2U);
+    EXPECT_EQ(plan.steps[3].type, EraseType::BLOCK_32K);
+    EXPECT_EQ(plan.steps[4].type, EraseType::SECTOR_4K);
+    EXPECT_EQ(plan.steps[4].count, 2U);
+    EXPECT_EQ(plan.commands_count, 9U);
+    EXPECT_EQ(plan.estimated_duration_ms, 5 * 45U + 2 * 120U + 2 * 150U);
+
+    std::vector<ExecutedCommand> commands;
+    uint32_t duration_ms{0};
+    ASSERT_TRUE(simulate(plan, default_erase_timing, commands, duration_ms));
+    EXPECT_EQ(commands.size(), plan.commands_count);
+    EXPECT_EQ(duration_ms, plan.estimated_duration_ms);
+    expect_exact_coverage(commands, address, size);
+}
+
+TEST(ErasePlannerTest, SlowBlockCommandsAreReplacedBySmallerOnes)
+{
+    // 64K erase is slower than two 32K erases, 32K erase is slower than 8 sector erases
+    const EraseTiming timing{{10, 100, 300, 0}};
+    ErasePlan plan;
+    ASSERT_TRUE(plan_erase(0, 0x20000, device_size, timing, plan));
+    ASSERT_EQ(plan.steps_count, 1U);
+    EXPECT_EQ(plan.steps[0].type, EraseType::SECTOR_4K);
+    EXPECT_EQ(plan.commands_count, 32U);
+    EXPECT_EQ(plan.estimated_duration_ms, 320U);
+
+    const EraseTiming no_32k{{45, 0, 150, 0}};
+    ASSERT_TRUE(plan_erase(0x8000, 0x18000, device_size, no_32k, plan));
+    ASSERT_EQ(plan.steps_count, 2U);
+    EXPECT_EQ(plan.steps[0].type, EraseType::SECTOR_4K);
+    EXPECT_EQ(plan.steps[0].count, 8U);
+    EXPECT_EQ(plan.steps[1].type, EraseType::BLOCK_64K);
+}
+
+TEST(ErasePlannerTest, ChipEraseIsOnlyUsedForTheWholeDeviceIfFaster)
+{
+    ErasePlan plan;
+    const EraseTiming fast_chip_erase{{45, 120, 150, 1000}};
+    ASSERT_TRUE(plan_erase(0, device_size, device_size, fast_chip_erase, plan));
+    ASSERT_EQ(plan.steps_count, 1U);
+    EXPECT_EQ(plan.steps[0].type, EraseType::CHIP);
+    EXPECT_EQ(plan.estimated_duration_ms, 1000U);
+
+    ASSERT_TRUE(plan_erase(0, device_size - sector_size, device_size, fast_chip_erase, plan));
+    EXPECT_NE(plan.steps[0].type, EraseType::CHIP);
+
+    // 16 64K blocks of 1 MB device are erased faster than the chip
+    ASSERT_TRUE(plan_erase(0, device_size, device_size, default_erase_timing, plan));
+    ASSERT_EQ(plan.steps_count, 1U);
+    EXPECT_EQ(plan.steps[0].type, EraseType::BLOCK_64K);
+    EXPECT_EQ(plan.estimated_duration_ms, 16 * 150U);
+}
+
+TEST(ErasePlannerTest, PlanIsOptimalForAnyAlignedRange)
+{
+    const EraseTiming timings[] = {
+        default_erase_timing,
+        {{10, 100, 300, 0}},
+        {{45, 0, 150, 0}},
+        {{30, 200, 250, 0}},
+        {{50, 60, 400, 0}},
+    };
+    for(const auto& timing : timings)
+    {
+        // covers all alignments of the start and the end within 2 64K blocks
+        for(uint32_t address = 0; address < 0x20000; address += sector_size)
+        {
+            for(uint32_t size = sector_size; size <= 0x30000; size += sector_size)
+            {
+                ErasePlan plan;
+                ASSERT_TRUE(plan_erase(address, size, device_size, timing, plan));
+                EXPECT_EQ(plan.estimated_duration_ms, brute_force_duration(address, size, timing));
+
+                std::vector<ExecutedCommand> commands;
+                uint32_t duration_ms{0};
+                ASSERT_TRUE(simulate(plan, timing, commands, duration_ms));
+                EXPECT_EQ(duration_ms, plan.estimated_duration_ms);
+                expect_exact_coverage(commands, address, size);
+            }
+        }
+    }
+}
+
+TEST(ErasePlannerTest, ExecutionStopsOnFailedCommand)
+{
+    ErasePlan plan;
+    ASSERT_TRUE(plan_erase(0, 0x30000, device_size, default_erase_timing, plan));
+    uint32_t issued{0};
+    EXPECT_FALSE(execute_erase_plan(plan, device_size, [&](const EraseType, const uint32_t) {
+        ++issued;
+        return issued < 2;
+    }));
+    EXPECT_EQ(issued, 2U);
+}
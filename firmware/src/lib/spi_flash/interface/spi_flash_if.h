@@ -23,6 +23,19 @@ public:
         ERROR_TIMEOUT,
     };
 
+    /// Layout of the memory array, as it is seen by the users of the interface
+    struct Geometry
+    {
+        /// programming unit of the chip, program() splits the data on its boundaries
+        uint32_t page_size;
+        /// minimal erasable unit
+        uint32_t sector_size;
+        /// addressable size of the memory
+        uint32_t total_size;
+    };
+
+    virtual Geometry getGeometry() const = 0;
+
     /// @brief Perform a synchronous read access to NOR SPI Flash memory
     /// @param address
     /// @param data
@@ -31,9 +44,9 @@ public:
     virtual Result read(uint32_t address, uint8_t* data, uint32_t size) = 0;
 
     /// @brief Perform a synchronous write access to NOR SPI Flash memory
-    /// @param address in the flash memory. Has to be aligned by PAGE_SIZE
+    /// @param address in the flash memory
     /// @param data
-    /// @param size in bytes. Has to be aligned by PAGE_SIZE
+    /// @param size in bytes. Data may span several pages, they are programmed one after another
     /// @return OK, if operation was successfull, error code otherwise
     virtual Result program(uint32_t address, const uint8_t* const data, uint32_t size) = 0;
 
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "page_cache.h"
+
+#include <cstring>
+
+namespace flash
+{
+
+PageCache::Geometry PageCache::getGeometry() const
+{
+    return _flash.getGeometry();
+}
+
+PageCache::Result PageCache::read(const uint32_t address, uint8_t* data, const uint32_t size)
+{
+    if(data == nullptr)
+    {
+        return Result::ERROR_INPUT;
+    }
+    if(size > max_cached_read_size)
+    {
+        _statistics.bypassed++;
+        return _flash.read(address, data, size);
+    }
+
+    uint32_t position{0};
+    while(position < size)
+    {
+        const uint32_t current_address = address + position;
+        const uint32_t page_address = current_address - (current_address % slot_size);
+        const uint32_t page_offset = current_address - page_address;
+        const uint32_t chunk_size =
+            (size - position < slot_size - page_offset) ? size - position : slot_size - page_offset;
+
+        Slot* slot = findSlot(page_address);
+        if(slot != nullptr)
+        {
+            _statistics.hits++;
+        }
+        else
+        {
+            _statistics.misses++;
+            slot = &selectVictim();
+            slot->is_valid = false;
+            const auto result = _flash.read(page_address, slot->data, slot_size);
+            if(result != Result::OK)
+            {
+                return result;
+            }
+            slot->address = page_address;
+            slot->is_valid = true;
+        }
+        slot->last_use = ++_use_counter;
+        memcpy(&data[position], &slot->data[page_offset], chunk_size);
+        position += chunk_size;
+    }
+    return Result::OK;
+}
+
+PageCache::Result PageCache::program(const uint32_t address, const uint8_t* const data, const uint32_t size)
+{
+    // pages are dropped regardless of the result, as the content of a failed program is unknown
+    invalidate(address, size);
+    return _flash.program(address, data, size);
+}
+
+PageCache::Result PageCache::erase(const uint32_t address, const uint32_t size)
+{
+    invalidate(address, size);
+    return _flash.erase(address, size);
+}
+
+void PageCache::invalidate()
+{
+    for(auto& slot : _slots)
+    {
+        slot.is_valid = false;
+    }
+}
+
+PageCache::Slot* PageCache::findSlot(const uint32_t page_address)
+{
+    for(auto& slot : _slots)
+    {
+        if(slot.is_valid && slot.address == page_address)
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+PageCache::Slot& PageCache::selectVictim()
+{
+    Slot* victim = &_slots[0];
+    for(auto& slot : _slots)
+    {
+        if(!slot.is_valid)
+        {
+            return slot;
+        }
+        if(slot.last_use < victim->last_use)
+        {
+            victim = &slot;
+        }
+    }
+    return *victim;
+}
+
+void PageCache::invalidate(const uint32_t address, const uint32_t size)
+{
+    for(auto& slot : _slots)
+    {
+        if(slot.is_valid && slot.address < address + size && address < slot.address + slot_size)
+        {
+            slot.is_valid = false;
+            _statistics.invalidations++;
+        }
+    }
+}
+
+} // namespace flash
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "spi_flash_if.h"
+#include <stdint.h>
+
+namespace flash
+{
+
+/// Write-through LRU cache of a few flash pages, placed between the file system and the flash driver.
+/// Descriptor table and file headers are read by small chunks over and over (list, info, open, stat),
+/// so such reads are served from the cache. Longer reads (file data, fsck) go to the flash directly,
+/// so streaming doesn't evict the metadata. Programs and erases go to the flash immediately and drop
+/// the cached pages they cover.
+class PageCache : public memory::SpiNorFlashIf
+{
+public:
+    static constexpr uint32_t slots_count{4};
+    static constexpr uint32_t slot_size{256};
+    /// reads larger than this bypass the cache
+    static constexpr uint32_t max_cached_read_size{64};
+
+    struct Statistics
+    {
+        /// page accesses served from the cache
+        uint32_t hits{0};
+        /// page accesses that have loaded a page from the flash
+        uint32_t misses{0};
+        /// reads passed to the flash without caching
+        uint32_t bypassed{0};
+        /// cached pages dropped by programs and erases
+        uint32_t invalidations{0};
+    };
+
+    explicit PageCache(memory::SpiNorFlashIf& flash)
+        : _flash{flash}
+    {
+    }
+
+    PageCache() = delete;
+    PageCache(const PageCache&) = delete;
+    PageCache(PageCache&&) = delete;
+    PageCache& operator=(const PageCache&) = delete;
+    PageCache& operator=(PageCache&&) = delete;
+    ~PageCache() = default;
+
+    Geometry getGeometry() const override;
+    Result read(uint32_t address, uint8_t* data, uint32_t size) override;
+    Result program(uint32_t address, const uint8_t* const data, uint32_t size) override;
+    Result erase(uint32_t address, uint32_t size) override;
+
+    /// Drop all cached pages. Has to be called if the flash has been accessed bypassing the cache.
+    void invalidate();
+
+    const Statistics& getStatistics() const
+    {
+        return _statistics;
+    }
+    void resetStatistics()
+    {
+        _statistics = Statistics{};
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t address{0};
+        /// value of the use counter at the last access, the smallest one is evicted
+        uint32_t last_use{0};
+        bool is_valid{false};
+        uint8_t data[slot_size];
+    };
+
+    memory::SpiNorFlashIf& _flash;
+    Slot _slots[slots_count];
+    uint32_t _use_counter{0};
+    Statistics _statistics;
+
+    Slot* findSlot(uint32_t page_address);
+    Slot& selectVictim();
+    void invalidate(uint32_t address, uint32_t size);
+};
+
+} // namespace flash
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "page_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace flash;
+using Result = memory::SpiNorFlashIf::Result;
+
+static constexpr uint32_t memory_size{64 * 1024};
+static constexpr uint32_t sector_size{4096};
+static constexpr uint32_t page_size{PageCache::slot_size};
+
+// NOR flash model, that counts the accesses reaching it
+class FakeFlash : public memory::SpiNorFlashIf
+{
+public:
+    FakeFlash()
+        : memory(memory_size, 0xFF)
+    {
+        for(uint32_t i = 0; i < memory_size; ++i)
+        {
+            memory[i] = static_cast<uint8_t>(i * 7);
+        }
+    }
+
+    Geometry getGeometry() const override
+    {
+        return Geometry{page_size, sector_size, memory_size};
+    }
+
+    Result read(const uint32_t address, uint8_t* data, const uint32_t size) override
+    {
+        reads++;
+        if(is_read_failing || address + size > memory_size)
+        {
+            return Result::ERROR_GENERAL;
+        }
+        std::copy(memory.begin() + address, memory.begin() + address + size, data);
+        return Result::OK;
+    }
+
+    Result program(const uint32_t address, const uint8_t* const data, const uint32_t size) override
+    {
+        for(uint32_t i = 0; i < size; ++i)
+        {
+            memory[address + i] &= data[i];
+        }
+        return Result::OK;
+    }
+
+    Result erase(const uint32_t address, const uint32_t size) override
+    {
+        std::fill(memory.begin() + address, memory.begin() + address + size, 0xFF);
+        return Result::OK;
+    }
+
+    std::vector<uint8_t> memory;
+    uint32_t reads{0};
+    bool is_read_failing{false};
+};
+
+class PageCacheTest : public ::testing::Test
+{
+protected:
+    FakeFlash flash;
+    PageCache cache{flash};
+
+    void expect_read(const uint32_t address, const uint32_t size)
+    {
+        std::vector<uint8_t> data(size, 0);
+        ASSERT_EQ(cache.read(address, data.data(), size), Result::OK);
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), flash.memory.begin() + address));
+    }
+};
+
+TEST_F(PageCacheTest, RepeatedSmallReadsAreServedFromCache)
+{
+    // descriptors of the table, 32 bytes each
+    for(uint32_t round = 0; round < 3; ++round)
+    {
+        for(uint32_t address = 0; address < 2 * page_size; address += 32)
+        {
+            expect_read(address, 32);
+        }
+    }
+    EXPECT_EQ(flash.reads, 2U);
+    EXPECT_EQ(cache.getStatistics().misses, 2U);
+    EXPECT_EQ(cache.getStatistics().hits, 3 * 16U - 2);
+
+    cache.resetStatistics();
+    EXPECT_EQ(cache.getStatistics().hits, 0U);
+}
+
+TEST_F(PageCacheTest, ReadsCrossingPageBoundaryUseBothPages)
+{
+    expect_read(page_size - 16, 32);
+    EXPECT_EQ(cache.getStatistics().misses, 2U);
+    expect_read(page_size - 8, 16);
+    expect_read(page_size + 4, 4);
+    EXPECT_EQ(flash.reads, 2U);
+}
+
+TEST_F(PageCacheTest, LargeReadsBypassTheCache)
+{
+    expect_read(0, 32);
+    expect_read(0, page_size);
+    expect_read(page_size, 4 * page_size);
+    EXPECT_EQ(cache.getStatistics().bypassed, 2U);
+    EXPECT_EQ(flash.reads, 3U);
+    // the cached page is still there
+    expect_read(16, 16);
+    EXPECT_EQ(flash.reads, 3U);
+}
+
+TEST_F(PageCacheTest, LeastRecentlyUsedPageIsEvicted)
+{
+    for(uint32_t i = 0; i < PageCache::slots_count; ++i)
+    {
+        expect_read(i * page_size, 16);
+    }
+    // page 0 becomes the most recently used one, so page 1 is evicted
+    expect_read(0, 16);
+    expect_read(PageCache::slots_count * page_size, 16);
+    EXPECT_EQ(flash.reads, PageCache::slots_count + 1);
+
+    expect_read(0, 16);
+    EXPECT_EQ(flash.reads, PageCache::slots_count + 1);
+    expect_read(page_size, 16);
+    EXPECT_EQ(flash.reads, PageCache::slots_count + 2);
+}
+
+TEST_F(PageCacheTest, ProgramAndEraseDropCoveredPages)
+{
+    expect_read(0, 16);
+    expect_read(page_size, 16);
+    expect_read(sector_size, 16);
+
+    const uint8_t zeros[8]{0};
+    ASSERT_EQ(cache.program(page_size + 8, zeros, sizeof(zeros)), Result::OK);
+    EXPECT_EQ(cache.getStatistics().invalidations, 1U);
+    expect_read(page_size, 16);
+    EXPECT_EQ(flash.reads, 4U);
+
+    ASSERT_EQ(cache.erase(0, sector_size), Result::OK);
+    EXPECT_EQ(cache.getStatistics().invalidations, 3U);
+    expect_read(0, 16);
+    expect_read(page_size, 16);
+    expect_read(sector_size, 16);
+    EXPECT_EQ(flash.reads, 6U);
+}
+
+TEST_F(PageCacheTest, FailedReadIsNotCached)
+{
+    flash.is_read_failing = true;
+    uint8_t data[16];
+    EXPECT_EQ(cache.read(0, data, sizeof(data)), Result::ERROR_GENERAL);
+    flash.is_read_failing = false;
+    expect_read(0, 16);
+    EXPECT_EQ(flash.reads, 2U);
+    EXPECT_EQ(cache.read(0, nullptr, 16), Result::ERROR_INPUT);
+}
+
+TEST_F(PageCacheTest, InvalidateDropsAllPages)
+{
+    expect_read(0, 16);
+    flash.memory[0] = 0x5A;
+    cache.invalidate();
+    expect_read(0, 16);
+    EXPECT_EQ(flash.reads, 2U);
+    EXPECT_EQ(cache.getGeometry().total_size, memory_size);
+}
@@ -0,0 +1,181 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "sfdp.h"
+
+#include <initializer_list>
+
+namespace flash
+{
+namespace sfdp
+{
+
+// DWORDs 1-14 contain everything the driver uses
+static constexpr uint32_t max_used_dwords{14};
+// JESD216 (revision 0) table is 9 DWORDs long, timings have been added in revision A
+static constexpr uint32_t min_dwords_count{9};
+static constexpr uint32_t timing_dwords_count{11};
+// deep power-down has been described since revision B
+static constexpr uint32_t power_down_dwords_count{14};
+
+static uint32_t get_dword(const uint8_t* data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+bool read_basic_parameters(const ReadFunction& read, BasicParameters& parameters)
+{
+    // SFDP header and the first parameter header, that always describes the basic flash parameters table
+    uint8_t headers[16];
+    if(!read(0, headers, sizeof(headers)))
+    {
+        return false;
+    }
+    if(headers[0] != 'S' || headers[1] != 'F' || headers[2] != 'D' || headers[3] != 'P')
+    {
+        return false;
+    }
+    const uint32_t table_dwords = headers[11];
+    const uint32_t table_address = headers[12] | (headers[13] << 8) | (headers[14] << 16);
+    const uint32_t dwords_count = (table_dwords < max_used_dwords) ? table_dwords : max_used_dwords;
+    if(dwords_count < min_dwords_count)
+    {
+        return false;
+    }
+    uint8_t table[max_used_dwords * 4];
+    if(!read(table_address, table, dwords_count * 4))
+    {
+        return false;
+    }
+    uint32_t dwords[max_used_dwords]{0};
+    for(uint32_t i = 0; i < dwords_count; ++i)
+    {
+        dwords[i] = get_dword(&table[i * 4]);
+    }
+    return parse_basic_parameters(dwords, dwords_count, parameters);
+}
+
+bool parse_basic_parameters(const uint32_t* const dwords, const uint32_t dwords_count, BasicParameters& parameters)
+{
+    parameters = BasicParameters{};
+    if(dwords == nullptr || dwords_count < min_dwords_count)
+    {
+        return false;
+    }
+
+    // DWORD 2: density in bits, either N + 1 or 2^N
+    const uint32_t density = dwords[1];
+    uint64_t size_bytes{0};
+    if((density & 0x80000000UL) == 0)
+    {
+        size_bytes = (static_cast<uint64_t>(density) + 1) / 8;
+    }
+    else
+    {
+        const uint32_t power = density & 0x7FFFFFFFUL;
+        size_bytes = (power >= 3 && power < 40) ? (1ULL << (power - 3)) : 0;
+    }
+    if(size_bytes == 0)
+    {
+        return false;
+    }
+    parameters.total_size = (size_bytes > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : static_cast<uint32_t>(size_bytes);
+
+    // DWORD 1, bits 1:0: 4 kB erase is supported; bits 18:17: address bytes
+    parameters.is_4k_erase_supported = (dwords[0] & 0x03) == 0x01;
+    const uint32_t address_bytes = (dwords[0] >> 17) & 0x03;
+    parameters.address_bytes = (address_bytes == 1)   ? AddressBytes::THREE_OR_FOUR
+                               : (address_bytes == 2) ? AddressBytes::FOUR_ONLY
+                                                      : AddressBytes::THREE_ONLY;
+
+    // DWORDs 8-9: erase types 1-4, 16 bits each: size is 2^N bytes in bits 7:0, opcode in bits 15:8
+    for(uint32_t i = 0; i < BasicParameters::max_erase_commands; ++i)
+    {
+        const uint32_t erase_type = (dwords[7 + i / 2] >> (16 * (i % 2))) & 0xFFFF;
+        const uint32_t size_power = erase_type & 0xFF;
+        auto& command = parameters.erase_commands[i];
+        command.size = (size_power > 0 && size_power < 32) ? (1UL << size_power) : 0;
+        command.opcode = static_cast<uint8_t>(erase_type >> 8);
+        command.typical_ms = 0;
+    }
+
+    if(dwords_count < timing_dwords_count)
+    {
+        return true;
+    }
+    // DWORD 10: typical time of each erase type, 7 bits starting from bit 4: count in bits 4:0,
+    // units in bits 6:5. Maximal erase time is 2 * (N + 1) times the typical one, N in bits 3:0.
+    static constexpr uint32_t erase_time_units_ms[]{1, 16, 128, 1000};
+    for(uint32_t i = 0; i < BasicParameters::max_erase_commands; ++i)
+    {
+        auto& command = parameters.erase_commands[i];
+        if(command.size == 0)
+        {
+            continue;
+        }
+        const uint32_t time = (dwords[9] >> (4 + 7 * i)) & 0x7F;
+        command.typical_ms = ((time & 0x1F) + 1) * erase_time_units_ms[(time >> 5) & 0x03];
+    }
+    parameters.erase_max_multiplier = 2 * ((dwords[9] & 0x0F) + 1);
+
+    // DWORD 11, bits 7:4: page size is 2^N bytes
+    parameters.page_size = 1UL << ((dwords[10] >> 4) & 0x0F);
+    // DWORD 11: maximal page program time is 2 * (N + 1) times the typical one, N in bits 3:0.
+    // Typical time: count in bits 12:8, units in bit 13 (8 or 64 us).
+    const uint32_t program_time = (dwords[10] >> 8) & 0x3F;
+    parameters.page_program_typical_us = ((program_time & 0x1F) + 1) * (((program_time >> 5) > 0) ? 64 : 8);
+    parameters.page_program_max_us = parameters.page_program_typical_us * 2 * ((dwords[10] & 0x0F) + 1);
+    // DWORD 11, bits 30:24: typical chip erase time, count in bits 28:24, units in bits 30:29
+    static constexpr uint32_t chip_erase_time_units_ms[]{16, 256, 4000, 64000};
+    const uint32_t chip_time = (dwords[10] >> 24) & 0x7F;
+    parameters.chip_erase_typical_ms = ((chip_time & 0x1F) + 1) * chip_erase_time_units_ms[(chip_time >> 5) & 0x03];
+
+    // DWORD 14, bit 31 is cleared if deep power-down is supported. Enter opcode in bits 30:23, exit opcode
+    // in bits 22:15, delay after the exit: count in bits 12:8, units in bits 14:13 (0.128, 1, 8 or 64 us)
+    if(dwords_count < power_down_dwords_count || (dwords[13] & (1UL << 31)) != 0)
+    {
+        return true;
+    }
+    parameters.power_down_opcode = static_cast<uint8_t>((dwords[13] >> 23) & 0xFF);
+    parameters.release_opcode = static_cast<uint8_t>((dwords[13] >> 15) & 0xFF);
+    static constexpr uint32_t release_time_units_ns[]{128, 1000, 8000, 64000};
+    const uint32_t release_time_ns = (((dwords[13] >> 8) & 0x1F) + 1) * release_time_units_ns[(dwords[13] >> 13) & 0x03];
+    parameters.release_time_us = (release_time_ns + 999) / 1000;
+    return true;
+}
+
+EraseTiming get_erase_timing(const BasicParameters& parameters)
+{
+    EraseTiming timing{{0, 0, 0, 0}};
+    for(const auto type : {EraseType::SECTOR_4K, EraseType::BLOCK_32K, EraseType::BLOCK_64K})
+    {
+        const uint32_t size = get_erase_size(type, parameters.total_size);
+        for(const auto& command : parameters.erase_commands)
+        {
+            if(command.size == size)
+            {
+                timing.duration_ms[static_cast<uint32_t>(type)] = command.typical_ms;
+            }
+        }
+    }
+    timing.duration_ms[static_cast<uint32_t>(EraseType::CHIP)] = parameters.chip_erase_typical_ms;
+    return timing;
+}
+
+uint8_t get_erase_opcode(const BasicParameters& parameters, const uint32_t size)
+{
+    for(const auto& command : parameters.erase_commands)
+    {
+        if(command.size == size && size > 0)
+        {
+            return command.opcode;
+        }
+    }
+    return 0;
+}
+
+} // namespace sfdp
+} // namespace flash
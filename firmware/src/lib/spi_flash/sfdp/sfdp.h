@@ -0,0 +1,73 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "erase_planner.h"
+#include <functional>
+#include <stdint.h>
+
+// Parser of the Serial Flash Discoverable Parameters (JESD216) basic flash parameters table.
+// It lets the driver configure itself for NOR parts of different vendors.
+namespace flash
+{
+namespace sfdp
+{
+
+enum class AddressBytes : uint8_t
+{
+    THREE_ONLY,
+    THREE_OR_FOUR,
+    FOUR_ONLY,
+};
+
+struct EraseCommand
+{
+    /// 0 for unused entries
+    uint32_t size;
+    uint8_t opcode;
+    /// 0 if the table doesn't provide the timing
+    uint32_t typical_ms;
+};
+
+struct BasicParameters
+{
+    uint32_t total_size{0};
+    /// 0 if the table doesn't provide it (JESD216 tables before revision A)
+    uint32_t page_size{0};
+    bool is_4k_erase_supported{false};
+    AddressBytes address_bytes{AddressBytes::THREE_ONLY};
+    static constexpr uint32_t max_erase_commands{4};
+    EraseCommand erase_commands[max_erase_commands]{};
+    /// maximal erase and program durations are these multiples of the typical ones, 0 if not provided
+    uint32_t erase_max_multiplier{0};
+    uint32_t chip_erase_typical_ms{0};
+    uint32_t page_program_typical_us{0};
+    uint32_t page_program_max_us{0};
+    /// deep power-down commands, 0 if the part doesn't support it or the table doesn't describe it (before JESD216B)
+    uint8_t power_down_opcode{0};
+    uint8_t release_opcode{0};
+    /// delay between the release command and the next command
+    uint32_t release_time_us{0};
+};
+
+/// Reads `size` bytes of SFDP space starting at `address`, returns false on failure
+using ReadFunction = std::function<bool(uint32_t address, uint8_t* data, uint32_t size)>;
+
+/// @brief read SFDP header, locate the basic parameters table and parse it
+/// @return false if the part doesn't provide SFDP or the table is malformed
+bool read_basic_parameters(const ReadFunction& read, BasicParameters& parameters);
+
+/// @brief parse the table, given as little-endian DWORDs
+/// @return false if the table is too short or reports an invalid density
+bool parse_basic_parameters(const uint32_t* dwords, uint32_t dwords_count, BasicParameters& parameters);
+
+/// typical durations of the erase commands, that the erase planner uses. 0 for the missing ones.
+EraseTiming get_erase_timing(const BasicParameters& parameters);
+
+/// @return opcode of the erase command of the given size, 0 if the table doesn't list it
+uint8_t get_erase_opcode(const BasicParameters& parameters, uint32_t size);
+
+} // namespace sfdp
+} // namespace flash
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "sfdp.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+using namespace flash;
+using namespace flash::sfdp;
+
+static constexpr uint32_t table_address{0x80};
+static constexpr uint32_t table_dwords{16};
+
+// Basic parameters of a 16 MB part, similar to W25Q128JV: 4K/32K/64K erases,
+// typical times 48/128/160 ms (max x14), 256-byte pages programmed in 448 us (max x8), chip erase in 40 s,
+// deep power-down by 0xB9/0xAB with 3 us release time
+static const uint32_t basic_table_16mb[table_dwords]{
+    0xFFF920E5,
+    0x07FFFFFF,
+    0x6B08EB44,
+    0xBB423B08,
+    0xFFFFFFFE,
+    0xFF00FFFF,
+    0xEB40FFFF,
+    0x520F200C,
+    0xFF00D810,
+    0x00A60226,
+    0x49002683,
+    0xFFFFFFFF,
+    0xFFFFFFFF,
+    0x5CD5A2F4,
+    0xFFFFFFFF,
+    0xFFFFFFFF,
+};
+
+static std::vector<uint8_t> make_sfdp_image(const uint32_t* table, uint32_t dwords_count)
+{
+    std::vector<uint8_t> image(table_address + dwords_count * 4, 0xFF);
+    const uint8_t headers[]{'S', 'F', 'D', 'P', 0x06, 0x01, 0x00, 0xFF,
+                            0x00, 0x06, 0x01, static_cast<uint8_t>(dwords_count), table_address, 0x00, 0x00, 0xFF};
+    std::copy(std::begin(headers), std::end(headers), image.begin());
+    for(uint32_t i = 0; i < dwords_count; ++i)
+    {
+        for(uint32_t j = 0; j < 4; ++j)
+        {
+            image[table_address + i * 4 + j] = static_cast<uint8_t>(table[i] >> (8 * j));
+        }
+    }
+    return image;
+}
+
+static ReadFunction make_reader(const std::vector<uint8_t>& image)
+{
+    return [&image](const uint32_t address, uint8_t* data, const uint32_t size) {
+        if(address + size > image.size())
+        {
+            return false;
+        }
+        std::copy(image.begin() + address, image.begin() + address + size, data);
+        return true;
+    };
+}
+
+TEST(SfdpTest, BasicParametersAreParsed)
+{
+    const auto image = make_sfdp_image(basic_table_16mb, table_dwords);
+    BasicParameters parameters;
+    ASSERT_TRUE(read_basic_parameters(make_reader(image), parameters));
+
+    EXPECT_EQ(parameters.total_size, 16U * 1024 * 1024);
+    EXPECT_EQ(parameters.page_size, 256U);
+    EXPECT_TRUE(parameters.is_4k_erase_supported);
+    EXPECT_EQ(parameters.address_bytes, AddressBytes::THREE_ONLY);
+
+    EXPECT_EQ(parameters.erase_commands[0].size, 0x1000U);
+    EXPECT_EQ(parameters.erase_commands[0].opcode, 0x20);
+    EXPECT_EQ(parameters.erase_commands[0].typical_ms, 48U);
+    EXPECT_EQ(parameters.erase_commands[1].size, 0x8000U);
+    EXPECT_EQ(parameters.erase_commands[1].opcode, 0x52);
+    EXPECT_EQ(parameters.erase_commands[1].typical_ms, 128U);
+    EXPECT_EQ(parameters.erase_commands[2].size, 0x10000U);
+    EXPECT_EQ(parameters.erase_commands[2].opcode, 0xD8);
+    EXPECT_EQ(parameters.erase_commands[2].typical_ms, 160U);
+    EXPECT_EQ(parameters.erase_commands[3].size, 0U);
+    EXPECT_EQ(parameters.erase_max_multiplier, 14U);
+
+    EXPECT_EQ(parameters.page_program_typical_us, 448U);
+    EXPECT_EQ(parameters.page_program_max_us, 448U * 8);
+    EXPECT_EQ(parameters.chip_erase_typical_ms, 40000U);
+
+    EXPECT_EQ(parameters.power_down_opcode, 0xB9);
+    EXPECT_EQ(parameters.release_opcode, 0xAB);
+    EXPECT_EQ(parameters.release_time_us, 3U);
+}
+
+TEST(SfdpTest, EraseTimingFeedsThePlanner)
+{
+    BasicParameters parameters;
+    ASSERT_TRUE(parse_basic_parameters(basic_table_16mb, table_dwords, parameters));
+    const auto timing = get_erase_timing(parameters);
+    EXPECT_EQ(timing.get(EraseType::SECTOR_4K), 48U);
+    EXPECT_EQ(timing.get(EraseType::BLOCK_32K), 128U);
+    EXPECT_EQ(timing.get(EraseType::BLOCK_64K), 160U);
+    EXPECT_EQ(timing.get(EraseType::CHIP), 40000U);
+    EXPECT_EQ(get_erase_opcode(parameters, 0x10000), 0xD8);
+    EXPECT_EQ(get_erase_opcode(parameters, 0x40000), 0);
+
+    ErasePlan plan;
+    ASSERT_TRUE(plan_erase(0x8000, 0x18000, parameters.total_size, timing, plan));
+    ASSERT_EQ(plan.steps_count, 2U);
+    EXPECT_EQ(plan.steps[0].type, EraseType::BLOCK_32K);
+    EXPECT_EQ(plan.steps[1].type, EraseType::BLOCK_64K);
+}
+
+TEST(SfdpTest, LargePartsReportDensityAsPowerOfTwo)
+{
+    uint32_t table[table_dwords];
+    std::copy(std::begin(basic_table_16mb), std::end(basic_table_16mb), table);
+    // 2^31 bits, 4-byte addresses only, no 32K erase
+    table[0] = (table[0] & ~(0x03UL << 17)) | (0x02UL << 17);
+    table[1] = 0x8000001F;
+    table[7] = 0xFF00200C;
+    BasicParameters parameters;
+    ASSERT_TRUE(parse_basic_parameters(table, table_dwords, parameters));
+    EXPECT_EQ(parameters.total_size, 256U * 1024 * 1024);
+    EXPECT_EQ(parameters.address_bytes, AddressBytes::FOUR_ONLY);
+    EXPECT_EQ(get_erase_timing(parameters).get(EraseType::BLOCK_32K), 0U);
+    EXPECT_EQ(get_erase_opcode(parameters, 0x8000), 0);
+}
+
+TEST(SfdpTest, FirstRevisionTableHasNoTiming)
+{
+    const auto image = make_sfdp_image(basic_table_16mb, 9);
+    BasicParameters parameters;
+    ASSERT_TRUE(read_basic_parameters(make_reader(image), parameters));
+    EXPECT_EQ(parameters.total_size, 16U * 1024 * 1024);
+    EXPECT_EQ(parameters.page_size, 0U);
+    EXPECT_EQ(parameters.erase_commands[0].opcode, 0x20);
+    EXPECT_EQ(parameters.erase_commands[0].typical_ms, 0U);
+    EXPECT_EQ(parameters.erase_max_multiplier, 0U);
+    EXPECT_EQ(parameters.page_program_typical_us, 0U);
+    EXPECT_EQ(parameters.power_down_opcode, 0);
+}
+
+TEST(SfdpTest, UnsupportedPowerDownIsNotReported)
+{
+    uint32_t table[table_dwords];
+    std::copy(std::begin(basic_table_16mb), std::end(basic_table_16mb), table);
+    table[13] |= (1UL << 31);
+    BasicParameters parameters;
+    ASSERT_TRUE(parse_basic_parameters(table, table_dwords, parameters));
+    EXPECT_EQ(parameters.power_down_opcode, 0);
+    EXPECT_EQ(parameters.release_opcode, 0);
+    EXPECT_EQ(parameters.release_time_us, 0U);
+
+    // 64 us units
+    table[13] = 0x5CD5E4F4;
+    ASSERT_TRUE(parse_basic_parameters(table, table_dwords, parameters));
+    EXPECT_EQ(parameters.release_time_us, 5U * 64);
+}
+
+TEST(SfdpTest, InvalidTablesAreRejected)
+{
+    BasicParameters parameters;
+    auto image = make_sfdp_image(basic_table_16mb, table_dwords);
+    image[3] = 'X';
+    EXPECT_FALSE(read_basic_parameters(make_reader(image), parameters));
+
+    const auto short_image = make_sfdp_image(basic_table_16mb, 8);
+    EXPECT_FALSE(read_basic_parameters(make_reader(short_image), parameters));
+
+    uint32_t table[table_dwords];
+    std::copy(std::begin(basic_table_16mb), std::end(basic_table_16mb), table);
+    table[1] = 0x80000001;
+    EXPECT_FALSE(parse_basic_parameters(table, table_dwords, parameters));
+
+    const ReadFunction failing_read = [](uint32_t, uint8_t*, uint32_t) { return false; };
+    EXPECT_FALSE(read_basic_parameters(failing_read, parameters));
+}
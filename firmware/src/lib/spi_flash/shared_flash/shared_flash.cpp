@@ -0,0 +1,165 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "shared_flash.h"
+
+namespace flash
+{
+
+SharedFlash::SharedFlash(memory::SpiNorFlashIf& flash, LockFunction lock, LockFunction unlock, DelayFunction delay)
+    : _flash{flash}
+    , _lock{lock}
+    , _unlock{unlock}
+    , _delay{delay}
+{
+}
+
+void SharedFlash::resetStatistics()
+{
+    for(auto& statistics : _statistics)
+    {
+        statistics = Statistics{};
+    }
+}
+
+void SharedFlash::acquire(const Priority priority)
+{
+    if(priority == Priority::HIGH)
+    {
+        // announced before waiting for the mutex, so low priority clients stop taking it
+        _pending_high_priority_accesses++;
+    }
+    else
+    {
+        while(_pending_high_priority_accesses > 0)
+        {
+            _statistics[static_cast<uint32_t>(priority)].yields++;
+            _delay(yield_delay_ticks);
+        }
+    }
+    _lock();
+    _statistics[static_cast<uint32_t>(priority)].accesses++;
+    if(priority == Priority::HIGH)
+    {
+        _pending_high_priority_accesses--;
+    }
+}
+
+void SharedFlash::release()
+{
+    _unlock();
+}
+
+SharedFlash::Guard::Guard(SharedFlash& shared_flash, const Priority priority)
+    : _shared_flash{shared_flash}
+{
+    _shared_flash.acquire(priority);
+}
+
+SharedFlash::Guard::~Guard()
+{
+    _shared_flash.release();
+}
+
+SharedFlash::Client::Client(SharedFlash& shared_flash,
+                            const Priority priority,
+                            const uint32_t base_address,
+                            const uint32_t size)
+    : _shared_flash{shared_flash}
+    , _priority{priority}
+    , _base_address{base_address}
+    , _size{size}
+{
+}
+
+SharedFlash::Client::Geometry SharedFlash::Client::getGeometry() const
+{
+    return _shared_flash._flash.getGeometry();
+}
+
+void SharedFlash::Client::setWindow(const uint32_t base_address, const uint32_t size)
+{
+    _base_address = base_address;
+    _size = size;
+}
+
+bool SharedFlash::Client::isInWindow(const uint32_t address, const uint32_t size) const
+{
+    return address >= _base_address && size <= _size && address - _base_address <= _size - size;
+}
+
+SharedFlash::Client::Result
+SharedFlash::Client::runChunked(const uint32_t size, const uint32_t chunk_size, const ChunkFunction& chunk_function)
+{
+    uint32_t offset{0};
+    do
+    {
+        const uint32_t current_size = (_priority == Priority::HIGH || size - offset < chunk_size)
+                                          ? size - offset
+                                          : chunk_size;
+        Guard guard{_shared_flash, _priority};
+        const auto result = chunk_function(offset, current_size);
+        if(result != Result::OK)
+        {
+            return result;
+        }
+        offset += current_size;
+    } while(offset < size);
+    return Result::OK;
+}
+
+SharedFlash::Client::Result SharedFlash::Client::read(const uint32_t address, uint8_t* data, const uint32_t size)
+{
+    if(data == nullptr || !isInWindow(address, size))
+    {
+        return Result::ERROR_INPUT;
+    }
+    return runChunked(size, low_priority_chunk_size, [&](const uint32_t offset, const uint32_t chunk_size) {
+        return _shared_flash._flash.read(address + offset, &data[offset], chunk_size);
+    });
+}
+
+SharedFlash::Client::Result
+SharedFlash::Client::program(const uint32_t address, const uint8_t* const data, const uint32_t size)
+{
+    if(data == nullptr || !isInWindow(address, size))
+    {
+        return Result::ERROR_INPUT;
+    }
+    return runChunked(size, low_priority_chunk_size, [&](const uint32_t offset, const uint32_t chunk_size) {
+        return _shared_flash._flash.program(address + offset, &data[offset], chunk_size);
+    });
+}
+
+SharedFlash::Client::Result SharedFlash::Client::erase(const uint32_t address, const uint32_t size)
+{
+    if(!isInWindow(address, size))
+    {
+        return Result::ERROR_INPUT;
+    }
+    if(_priority == Priority::HIGH)
+    {
+        Guard guard{_shared_flash, _priority};
+        return _shared_flash._flash.erase(address, size);
+    }
+    // chunks end on 64K boundaries, the first one may be shorter
+    uint32_t position{address};
+    const uint32_t end{address + size};
+    do
+    {
+        const uint32_t boundary = position - (position % low_priority_erase_chunk_size) + low_priority_erase_chunk_size;
+        const uint32_t chunk_end = (boundary < end) ? boundary : end;
+        Guard guard{_shared_flash, _priority};
+        const auto result = _shared_flash._flash.erase(position, chunk_end - position);
+        if(result != Result::OK)
+        {
+            return result;
+        }
+        position = chunk_end;
+    } while(position < end);
+    return Result::OK;
+}
+
+} // namespace flash
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "spi_flash_if.h"
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+
+namespace flash
+{
+
+/// Lets several tasks use the same flash chip without routing their requests through the memory task.
+/// Each user gets a Client, that is restricted to its own address window, so the users (file system,
+/// logs, staged firmware) can't damage the data of each other.
+///
+/// Accesses are serialized by a mutex, that is provided by the OS. High priority clients (audio record)
+/// always win: low priority clients split their accesses into short chunks and don't take the mutex
+/// for the next chunk while a high priority access is pending, so a record waits for one chunk at most.
+class SharedFlash
+{
+public:
+    using LockFunction = std::function<void()>;
+    using DelayFunction = std::function<void(uint32_t)>;
+
+    enum class Priority : uint8_t
+    {
+        HIGH,
+        LOW,
+    };
+
+    /// Reads and programs of low priority clients are split into chunks of this size
+    static constexpr uint32_t low_priority_chunk_size{4096};
+    /// Erases of low priority clients are split on 64K block boundaries, so the planner still uses block erases
+    static constexpr uint32_t low_priority_erase_chunk_size{0x10000};
+
+    struct Statistics
+    {
+        /// mutex acquisitions of the clients of the given priority
+        uint32_t accesses{0};
+        /// times a low priority client has waited for a pending high priority access
+        uint32_t yields{0};
+    };
+
+    /// Window of the flash, that belongs to a single user. Addresses are absolute.
+    class Client : public memory::SpiNorFlashIf
+    {
+    public:
+        Client(SharedFlash& shared_flash, Priority priority, uint32_t base_address, uint32_t size);
+
+        Client() = delete;
+        Client(const Client&) = delete;
+        Client(Client&&) = delete;
+        Client& operator=(const Client&) = delete;
+        Client& operator=(Client&&) = delete;
+        ~Client() = default;
+
+        Geometry getGeometry() const override;
+        /// @return ERROR_INPUT if the range is out of the window of the client
+        Result read(uint32_t address, uint8_t* data, uint32_t size) override;
+        Result program(uint32_t address, const uint8_t* const data, uint32_t size) override;
+        Result erase(uint32_t address, uint32_t size) override;
+
+        Priority getPriority() const
+        {
+            return _priority;
+        }
+
+        /// Move the window, f.e. once the geometry of the chip is known. Not to be called during an access.
+        void setWindow(uint32_t base_address, uint32_t size);
+
+    private:
+        SharedFlash& _shared_flash;
+        const Priority _priority;
+        uint32_t _base_address;
+        uint32_t _size;
+
+        bool isInWindow(uint32_t address, uint32_t size) const;
+        using ChunkFunction = std::function<Result(uint32_t offset, uint32_t size)>;
+        Result runChunked(uint32_t size, uint32_t chunk_size, const ChunkFunction& chunk_function);
+    };
+
+    /// Keeps the flash locked for a sequence of accesses, that are not covered by SpiNorFlashIf
+    /// (f.e. chip-specific commands of the driver)
+    class Guard
+    {
+    public:
+        Guard(SharedFlash& shared_flash, Priority priority);
+        ~Guard();
+
+        Guard() = delete;
+        Guard(const Guard&) = delete;
+        Guard(Guard&&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+
+    private:
+        SharedFlash& _shared_flash;
+    };
+
+    SharedFlash(memory::SpiNorFlashIf& flash, LockFunction lock, LockFunction unlock, DelayFunction delay);
+
+    SharedFlash() = delete;
+    SharedFlash(const SharedFlash&) = delete;
+    SharedFlash(SharedFlash&&) = delete;
+    SharedFlash& operator=(const SharedFlash&) = delete;
+    SharedFlash& operator=(SharedFlash&&) = delete;
+    ~SharedFlash() = default;
+
+    const Statistics& getStatistics(Priority priority) const
+    {
+        return _statistics[static_cast<uint32_t>(priority)];
+    }
+    void resetStatistics();
+
+private:
+    memory::SpiNorFlashIf& _flash;
+    LockFunction _lock;
+    LockFunction _unlock;
+    DelayFunction _delay;
+    std::atomic<uint32_t> _pending_high_priority_accesses{0};
+    Statistics _statistics[2];
+
+    static constexpr uint32_t yield_delay_ticks{1};
+
+    void acquire(Priority priority);
+    void release();
+};
+
+} // namespace flash
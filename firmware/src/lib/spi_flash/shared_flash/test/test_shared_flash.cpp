@@ -0,0 +1,195 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "shared_flash.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace flash;
+using Result = memory::SpiNorFlashIf::Result;
+using Priority = SharedFlash::Priority;
+
+static constexpr uint32_t memory_size{1024 * 1024};
+
+struct Access
+{
+    std::string operation;
+    uint32_t address;
+    uint32_t size;
+};
+
+// Records the accesses and checks that they are performed under the lock
+class FakeFlash : public memory::SpiNorFlashIf
+{
+public:
+    Geometry getGeometry() const override
+    {
+        return Geometry{256, 4096, memory_size};
+    }
+
+    Result read(const uint32_t address, uint8_t*, const uint32_t size) override
+    {
+        return record("read", address, size);
+    }
+
+    Result program(const uint32_t address, const uint8_t* const, const uint32_t size) override
+    {
+        return record("program", address, size);
+    }
+
+    Result erase(const uint32_t address, const uint32_t size) override
+    {
+        return record("erase", address, size);
+    }
+
+    Result record(const char* operation, const uint32_t address, const uint32_t size)
+    {
+        std::lock_guard<std::mutex> guard(accesses_mutex);
+        EXPECT_TRUE(is_locked);
+        accesses.push_back({operation, address, size});
+        return (accesses.size() == failing_access) ? Result::ERROR_GENERAL : Result::OK;
+    }
+
+    std::mutex accesses_mutex;
+    std::vector<Access> accesses;
+    bool is_locked{false};
+    // 1-based index of the access, that fails, 0 if all of them succeed
+    uint32_t failing_access{0};
+};
+
+class SharedFlashTest : public ::testing::Test
+{
+protected:
+    FakeFlash fake_flash;
+    std::mutex flash_mutex;
+    uint32_t unlocks_count{0};
+    std::function<void()> on_unlock;
+    SharedFlash shared_flash{
+        fake_flash,
+        [this]() {
+            flash_mutex.lock();
+            fake_flash.is_locked = true;
+        },
+        [this]() {
+            fake_flash.is_locked = false;
+            unlocks_count++;
+            flash_mutex.unlock();
+            if(on_unlock)
+            {
+                auto callback = on_unlock;
+                on_unlock = nullptr;
+                callback();
+            }
+        },
+        [](uint32_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }};
+    uint8_t buffer[16384]{0};
+};
+
+TEST_F(SharedFlashTest, AccessesOutOfTheWindowAreRejected)
+{
+    SharedFlash::Client client{shared_flash, Priority::LOW, 0xF0000, 0x10000};
+    EXPECT_EQ(client.read(0xEFFFF, buffer, 16), Result::ERROR_INPUT);
+    EXPECT_EQ(client.read(0xFFFF8, buffer, 16), Result::ERROR_INPUT);
+    EXPECT_EQ(client.program(0xF0000, buffer, 0x10001), Result::ERROR_INPUT);
+    EXPECT_EQ(client.erase(0xE0000, 0x10000), Result::ERROR_INPUT);
+    EXPECT_EQ(client.read(0xF0000, nullptr, 16), Result::ERROR_INPUT);
+    EXPECT_TRUE(fake_flash.accesses.empty());
+
+    EXPECT_EQ(client.read(0xFFFF0, buffer, 16), Result::OK);
+    EXPECT_EQ(client.erase(0xF0000, 0x10000), Result::OK);
+    EXPECT_EQ(fake_flash.accesses.size(), 2U);
+    EXPECT_EQ(client.getGeometry().total_size, memory_size);
+
+    client.setWindow(0, 0x1000);
+    EXPECT_EQ(client.read(0xFFFF0, buffer, 16), Result::ERROR_INPUT);
+    EXPECT_EQ(client.read(0xFF0, buffer, 16), Result::OK);
+}
+
+TEST_F(SharedFlashTest, HighPriorityAccessesAreNotSplit)
+{
+    SharedFlash::Client client{shared_flash, Priority::HIGH, 0, memory_size};
+    EXPECT_EQ(client.read(0x100, buffer, sizeof(buffer)), Result::OK);
+    EXPECT_EQ(client.erase(0x8000, 0x28000), Result::OK);
+    ASSERT_EQ(fake_flash.accesses.size(), 2U);
+    EXPECT_EQ(fake_flash.accesses[0].size, sizeof(buffer));
+    EXPECT_EQ(fake_flash.accesses[1].size, 0x28000U);
+    EXPECT_EQ(unlocks_count, 2U);
+    EXPECT_EQ(shared_flash.getStatistics(Priority::HIGH).accesses, 2U);
+}
+
+TEST_F(SharedFlashTest, LowPriorityAccessesAreSplitIntoChunks)
+{
+    SharedFlash::Client client{shared_flash, Priority::LOW, 0, memory_size};
+    EXPECT_EQ(client.program(0x100, buffer, 10000), Result::OK);
+    ASSERT_EQ(fake_flash.accesses.size(), 3U);
+    EXPECT_EQ(fake_flash.accesses[0].address, 0x100U);
+    EXPECT_EQ(fake_flash.accesses[1].address, 0x100U + SharedFlash::low_priority_chunk_size);
+    EXPECT_EQ(fake_flash.accesses[2].size, 10000U - 2 * SharedFlash::low_priority_chunk_size);
+
+    fake_flash.accesses.clear();
+    EXPECT_EQ(client.erase(0x8000, 0x28000), Result::OK);
+    ASSERT_EQ(fake_flash.accesses.size(), 3U);
+    EXPECT_EQ(fake_flash.accesses[0].address, 0x8000U);
+    EXPECT_EQ(fake_flash.accesses[0].size, 0x8000U);
+    EXPECT_EQ(fake_flash.accesses[1].address, 0x10000U);
+    EXPECT_EQ(fake_flash.accesses[1].size, 0x10000U);
+    EXPECT_EQ(fake_flash.accesses[2].address, 0x20000U);
+    EXPECT_EQ(fake_flash.accesses[2].size, 0x10000U);
+    EXPECT_EQ(unlocks_count, 6U);
+}
+
+TEST_F(SharedFlashTest, FailedChunkStopsTheAccess)
+{
+    SharedFlash::Client client{shared_flash, Priority::LOW, 0, memory_size};
+    fake_flash.failing_access = 2;
+    EXPECT_EQ(client.read(0, buffer, sizeof(buffer)), Result::ERROR_GENERAL);
+    EXPECT_EQ(fake_flash.accesses.size(), 2U);
+    EXPECT_FALSE(fake_flash.is_locked);
+}
+
+TEST_F(SharedFlashTest, HighPriorityAccessRunsBetweenLowPriorityChunks)
+{
+    SharedFlash::Client record_client{shared_flash, Priority::HIGH, 0, 0x80000};
+    SharedFlash::Client log_client{shared_flash, Priority::LOW, 0x80000, 0x80000};
+    on_unlock = [&]() { EXPECT_EQ(record_client.program(0x1000, buffer, 256), Result::OK); };
+    EXPECT_EQ(log_client.read(0x80000, buffer, 2 * SharedFlash::low_priority_chunk_size), Result::OK);
+
+    ASSERT_EQ(fake_flash.accesses.size(), 3U);
+    EXPECT_EQ(fake_flash.accesses[0].operation, "read");
+    EXPECT_EQ(fake_flash.accesses[1].operation, "program");
+    EXPECT_EQ(fake_flash.accesses[2].operation, "read");
+}
+
+TEST_F(SharedFlashTest, LowPriorityClientWaitsForPendingHighPriorityAccess)
+{
+    SharedFlash::Client record_client{shared_flash, Priority::HIGH, 0, 0x80000};
+    SharedFlash::Client log_client{shared_flash, Priority::LOW, 0x80000, 0x80000};
+    std::thread record_thread;
+    std::thread log_thread;
+    {
+        // another chip-specific sequence keeps the flash busy, while both clients arrive
+        SharedFlash::Guard guard{shared_flash, Priority::HIGH};
+        record_thread = std::thread([&]() { EXPECT_EQ(record_client.program(0, buffer, 256), Result::OK); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        log_thread = std::thread([&]() { EXPECT_EQ(log_client.read(0x80000, buffer, 256), Result::OK); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    record_thread.join();
+    log_thread.join();
+
+    ASSERT_EQ(fake_flash.accesses.size(), 2U);
+    EXPECT_EQ(fake_flash.accesses[0].operation, "program");
+    EXPECT_EQ(fake_flash.accesses[1].operation, "read");
+    EXPECT_GT(shared_flash.getStatistics(Priority::LOW).yields, 0U);
+
+    shared_flash.resetStatistics();
+    EXPECT_EQ(shared_flash.getStatistics(Priority::LOW).yields, 0U);
+}
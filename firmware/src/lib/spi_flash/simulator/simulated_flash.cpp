@@ -0,0 +1,180 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "simulated_flash.h"
+
+#include <algorithm>
+
+namespace flash
+{
+
+static constexpr uint8_t erased_value{0xFF};
+// 4K sectors are the erase granularity of the planner
+static constexpr uint32_t erase_sector_size{0x1000};
+
+constexpr SimulatedFlash::Timing SimulatedFlash::default_timing;
+
+SimulatedFlash::SimulatedFlash(const Geometry& geometry, const Timing& timing)
+    : _geometry{geometry}
+    , _timing{timing}
+    , _memory(geometry.total_size, erased_value)
+    , _erase_counts(geometry.total_size / erase_sector_size, 0)
+{
+}
+
+SimulatedFlash::Geometry SimulatedFlash::getGeometry() const
+{
+    return _geometry;
+}
+
+bool SimulatedFlash::isInRange(const uint32_t address, const uint32_t size) const
+{
+    return address < _geometry.total_size && size <= _geometry.total_size - address;
+}
+
+bool SimulatedFlash::isFaultTriggered(const Operation operation)
+{
+    if(!_is_fault_active || _fault.operation != operation)
+    {
+        return false;
+    }
+    if(_fault.countdown > 0)
+    {
+        _fault.countdown--;
+        return false;
+    }
+    _is_fault_active = false;
+    return true;
+}
+
+void SimulatedFlash::spendTransfer(const uint32_t bytes)
+{
+    _time_ns += _timing.command_overhead_ns;
+    _time_ns += (static_cast<uint64_t>(bytes) * 8 * 1000000000ULL) / _timing.spi_frequency_hz;
+}
+
+SimulatedFlash::Result SimulatedFlash::read(const uint32_t address, uint8_t* data, const uint32_t size)
+{
+    if(data == nullptr || !isInRange(address, size))
+    {
+        return Result::ERROR_INPUT;
+    }
+    if(isFaultTriggered(Operation::READ))
+    {
+        return _fault.result;
+    }
+    spendTransfer(size);
+    std::copy(_memory.begin() + address, _memory.begin() + address + size, data);
+    _statistics.reads++;
+    _statistics.bytes_read += size;
+    return Result::OK;
+}
+
+SimulatedFlash::Result SimulatedFlash::programPage(const uint32_t address, const uint8_t* data, const uint32_t size)
+{
+    if(data == nullptr || size > _geometry.page_size || !isInRange(address, 1))
+    {
+        return Result::ERROR_INPUT;
+    }
+    uint32_t programmed_size{size};
+    Result result{Result::OK};
+    if(isFaultTriggered(Operation::PROGRAM))
+    {
+        programmed_size = std::min(size, _fault.programmed_bytes);
+        result = _fault.result;
+    }
+    spendTransfer(size);
+    _time_ns += static_cast<uint64_t>(_timing.page_program_us) * 1000;
+    const uint32_t page_start = address - (address % _geometry.page_size);
+    const uint32_t page_offset = address - page_start;
+    for(uint32_t i = 0; i < programmed_size; ++i)
+    {
+        _memory[page_start + (page_offset + i) % _geometry.page_size] &= data[i];
+    }
+    _statistics.page_programs++;
+    _statistics.bytes_programmed += programmed_size;
+    return result;
+}
+
+SimulatedFlash::Result SimulatedFlash::program(const uint32_t address, const uint8_t* const data, const uint32_t size)
+{
+    if(data == nullptr || !isInRange(address, size))
+    {
+        return Result::ERROR_INPUT;
+    }
+    uint32_t position{0};
+    while(position < size)
+    {
+        const uint32_t current_address = address + position;
+        const uint32_t page_left = _geometry.page_size - (current_address % _geometry.page_size);
+        const uint32_t chunk_size = std::min(size - position, page_left);
+        const auto result = programPage(current_address, &data[position], chunk_size);
+        if(result != Result::OK)
+        {
+            return result;
+        }
+        position += chunk_size;
+    }
+    return Result::OK;
+}
+
+SimulatedFlash::Result SimulatedFlash::erase(const uint32_t address, const uint32_t size)
+{
+    if((address % erase_sector_size) != 0 || (size % erase_sector_size) != 0)
+    {
+        return Result::ERROR_ALIGNMENT;
+    }
+    if(size == 0)
+    {
+        return Result::OK;
+    }
+    ErasePlan plan;
+    if(!plan_erase(address, size, _geometry.total_size, _timing.erase, plan))
+    {
+        return Result::ERROR_INPUT;
+    }
+    if(isFaultTriggered(Operation::ERASE))
+    {
+        return _fault.result;
+    }
+    execute_erase_plan(plan, _geometry.total_size, [this](const EraseType type, const uint32_t command_address) {
+        const uint32_t erase_size = get_erase_size(type, _geometry.total_size);
+        std::fill(_memory.begin() + command_address, _memory.begin() + command_address + erase_size, erased_value);
+        for(uint32_t sector = command_address / erase_sector_size;
+            sector < (command_address + erase_size) / erase_sector_size;
+            ++sector)
+        {
+            _erase_counts[sector]++;
+        }
+        _time_ns += _timing.command_overhead_ns + static_cast<uint64_t>(_timing.erase.get(type)) * 1000000;
+        _statistics.erase_commands++;
+        return true;
+    });
+    return Result::OK;
+}
+
+void SimulatedFlash::injectFault(const Fault& fault)
+{
+    _fault = fault;
+    _is_fault_active = true;
+}
+
+void SimulatedFlash::clearFault()
+{
+    _is_fault_active = false;
+}
+
+uint32_t SimulatedFlash::getEraseCount(const uint32_t sector) const
+{
+    return (sector < _erase_counts.size()) ? _erase_counts[sector] : 0;
+}
+
+void SimulatedFlash::reset()
+{
+    std::fill(_memory.begin(), _memory.end(), erased_value);
+    std::fill(_erase_counts.begin(), _erase_counts.end(), 0);
+}
+
+} // namespace flash
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "erase_planner.h"
+#include "spi_flash_if.h"
+#include <stdint.h>
+#include <vector>
+
+namespace flash
+{
+
+/// Host model of a NOR flash chip, that follows the same contract as the driver: programs only clear bits
+/// and are split on page boundaries, erases set the sectors to 0xFF and are planned from 4K/32K/64K/chip
+/// commands. Each operation advances a virtual clock by its modelled duration, so the users of the interface
+/// (file system, caches) can be benchmarked on the host. Faults can be injected to check the error paths.
+class SimulatedFlash : public memory::SpiNorFlashIf
+{
+public:
+    struct Timing
+    {
+        /// defines the duration of the data transfers
+        uint32_t spi_frequency_hz;
+        /// chip select, opcode and address of each command
+        uint32_t command_overhead_ns;
+        uint32_t page_program_us;
+        EraseTiming erase;
+    };
+    /// W25Q128JV behind the 8 MHz SPI
+    static constexpr Timing default_timing{8000000, 2000, 400, default_erase_timing};
+
+    enum class Operation : uint8_t
+    {
+        READ,
+        PROGRAM,
+        ERASE,
+    };
+
+    /// Operation fails after `countdown` successful operations of the same type (page programs for PROGRAM)
+    struct Fault
+    {
+        Operation operation;
+        uint32_t countdown;
+        Result result;
+        /// bytes of the failing page program, that still reach the array (f.e. power loss in the middle)
+        uint32_t programmed_bytes;
+    };
+
+    struct Statistics
+    {
+        uint32_t reads{0};
+        uint32_t page_programs{0};
+        uint32_t erase_commands{0};
+        uint32_t bytes_read{0};
+        uint32_t bytes_programmed{0};
+    };
+
+    explicit SimulatedFlash(const Geometry& geometry, const Timing& timing = default_timing);
+
+    SimulatedFlash() = delete;
+    SimulatedFlash(const SimulatedFlash&) = delete;
+    SimulatedFlash(SimulatedFlash&&) = delete;
+    SimulatedFlash& operator=(const SimulatedFlash&) = delete;
+    SimulatedFlash& operator=(SimulatedFlash&&) = delete;
+    ~SimulatedFlash() = default;
+
+    Geometry getGeometry() const override;
+    Result read(uint32_t address, uint8_t* data, uint32_t size) override;
+    Result program(uint32_t address, const uint8_t* const data, uint32_t size) override;
+    Result erase(uint32_t address, uint32_t size) override;
+
+    /// Single page program command: data beyond the end of the page wraps to its start, as in the chip
+    Result programPage(uint32_t address, const uint8_t* data, uint32_t size);
+
+    /// Virtual time, that the operations would have taken on the target
+    uint64_t getTimeUs() const
+    {
+        return _time_ns / 1000;
+    }
+    void advanceTime(uint64_t us)
+    {
+        _time_ns += us * 1000;
+    }
+
+    void injectFault(const Fault& fault);
+    void clearFault();
+
+    /// Direct access to the array, f.e. for corruption of the stored data in tests
+    uint8_t* getMemory()
+    {
+        return _memory.data();
+    }
+    /// @return amount of times the sector has been erased, by any command
+    uint32_t getEraseCount(uint32_t sector) const;
+    /// Erase the whole array and forget the wear
+    void reset();
+
+    const Statistics& getStatistics() const
+    {
+        return _statistics;
+    }
+    void resetStatistics()
+    {
+        _statistics = Statistics{};
+    }
+
+private:
+    const Geometry _geometry;
+    const Timing _timing;
+    std::vector<uint8_t> _memory;
+    std::vector<uint32_t> _erase_counts;
+    uint64_t _time_ns{0};
+    Statistics _statistics;
+    Fault _fault{Operation::READ, 0, Result::OK, 0};
+    bool _is_fault_active{false};
+
+    bool isInRange(uint32_t address, uint32_t size) const;
+    /// @return true if the current operation shall fail
+    bool isFaultTriggered(Operation operation);
+    void spendTransfer(uint32_t bytes);
+};
+
+} // namespace flash
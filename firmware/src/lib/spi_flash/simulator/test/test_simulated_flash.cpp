@@ -0,0 +1,138 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "simulated_flash.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace flash;
+using Result = memory::SpiNorFlashIf::Result;
+
+static constexpr memory::SpiNorFlashIf::Geometry geometry{256, 4096, 1024 * 1024};
+
+class SimulatedFlashTest : public ::testing::Test
+{
+protected:
+    SimulatedFlash flash{geometry};
+    std::vector<uint8_t> data = std::vector<uint8_t>(1024, 0);
+
+    std::vector<uint8_t> read(const uint32_t address, const uint32_t size)
+    {
+        std::vector<uint8_t> result(size, 0);
+        EXPECT_EQ(flash.read(address, result.data(), size), Result::OK);
+        return result;
+    }
+};
+
+TEST_F(SimulatedFlashTest, ProgramOnlyClearsBits)
+{
+    EXPECT_EQ(read(0x1000, 4), std::vector<uint8_t>(4, 0xFF));
+    const uint8_t first[]{0xF0, 0x0F, 0xAA, 0xFF};
+    const uint8_t second[]{0x3C, 0x3C, 0xFF, 0x00};
+    ASSERT_EQ(flash.program(0x1000, first, sizeof(first)), Result::OK);
+    ASSERT_EQ(flash.program(0x1000, second, sizeof(second)), Result::OK);
+    EXPECT_EQ(read(0x1000, 4), (std::vector<uint8_t>{0x30, 0x0C, 0xAA, 0x00}));
+
+    ASSERT_EQ(flash.erase(0x1000, 0x1000), Result::OK);
+    EXPECT_EQ(read(0x1000, 4), std::vector<uint8_t>(4, 0xFF));
+    EXPECT_EQ(flash.getEraseCount(1), 1U);
+    EXPECT_EQ(flash.getEraseCount(0), 0U);
+}
+
+TEST_F(SimulatedFlashTest, ProgramIsSplitOnPageBoundaries)
+{
+    for(uint32_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+    ASSERT_EQ(flash.program(0x80, data.data(), 512), Result::OK);
+    EXPECT_EQ(flash.getStatistics().page_programs, 3U);
+    EXPECT_EQ(read(0x80, 512), std::vector<uint8_t>(data.begin(), data.begin() + 512));
+}
+
+TEST_F(SimulatedFlashTest, SinglePageProgramWrapsAtPageEnd)
+{
+    for(uint32_t i = 0; i < 32; ++i)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+    ASSERT_EQ(flash.programPage(0x1F0, data.data(), 32), Result::OK);
+    const auto page = read(0x100, 256);
+    EXPECT_EQ(page[0xF0], 0);
+    EXPECT_EQ(page[0xFF], 15);
+    EXPECT_EQ(page[0x00], 16);
+    EXPECT_EQ(page[0x0F], 31);
+    EXPECT_EQ(read(0x200, 1)[0], 0xFF);
+    EXPECT_EQ(flash.programPage(0x100, data.data(), 257), Result::ERROR_INPUT);
+}
+
+TEST_F(SimulatedFlashTest, InvalidAccessesAreRejected)
+{
+    EXPECT_EQ(flash.read(geometry.total_size - 4, data.data(), 8), Result::ERROR_INPUT);
+    EXPECT_EQ(flash.read(0, nullptr, 8), Result::ERROR_INPUT);
+    EXPECT_EQ(flash.program(geometry.total_size, data.data(), 1), Result::ERROR_INPUT);
+    EXPECT_EQ(flash.erase(0x800, 0x1000), Result::ERROR_ALIGNMENT);
+    EXPECT_EQ(flash.erase(0, 0x800), Result::ERROR_ALIGNMENT);
+    EXPECT_EQ(flash.erase(geometry.total_size, 0x1000), Result::ERROR_INPUT);
+}
+
+TEST_F(SimulatedFlashTest, VirtualClockFollowsTheTimingModel)
+{
+    // 256 bytes at 8 MHz take 256 us, plus the command overhead
+    ASSERT_EQ(flash.read(0, data.data(), 256), Result::OK);
+    EXPECT_EQ(flash.getTimeUs(), 258U);
+
+    ASSERT_EQ(flash.program(0, data.data(), 512), Result::OK);
+    EXPECT_EQ(flash.getTimeUs(), 258U + 2 * (258 + 400));
+
+    // 64K block and a sector are erased by 2 commands, as the planner chooses
+    const uint64_t before_erase = flash.getTimeUs();
+    ASSERT_EQ(flash.erase(0x10000, 0x11000), Result::OK);
+    EXPECT_EQ(flash.getStatistics().erase_commands, 2U);
+    EXPECT_EQ(flash.getTimeUs() - before_erase, 150000U + 45000U + 4U);
+    EXPECT_EQ(flash.getEraseCount(0x10), 1U);
+    EXPECT_EQ(flash.getEraseCount(0x20), 1U);
+
+    flash.advanceTime(1000);
+    EXPECT_EQ(flash.getTimeUs() - before_erase, 196004U);
+}
+
+TEST_F(SimulatedFlashTest, InjectedFaultsFailTheSelectedOperation)
+{
+    flash.injectFault({SimulatedFlash::Operation::READ, 1, Result::ERROR_TIMEOUT, 0});
+    EXPECT_EQ(flash.read(0, data.data(), 16), Result::OK);
+    EXPECT_EQ(flash.read(0, data.data(), 16), Result::ERROR_TIMEOUT);
+    EXPECT_EQ(flash.read(0, data.data(), 16), Result::OK);
+
+    flash.injectFault({SimulatedFlash::Operation::ERASE, 0, Result::ERROR_GENERAL, 0});
+    std::fill(data.begin(), data.end(), 0x00);
+    EXPECT_EQ(flash.program(0, data.data(), 16), Result::OK);
+    EXPECT_EQ(flash.erase(0, 0x1000), Result::ERROR_GENERAL);
+    EXPECT_EQ(read(0, 1)[0], 0);
+
+    flash.injectFault({SimulatedFlash::Operation::READ, 0, Result::ERROR_GENERAL, 0});
+    flash.clearFault();
+    EXPECT_EQ(flash.read(0, data.data(), 16), Result::OK);
+}
+
+TEST_F(SimulatedFlashTest, PowerLossLeavesTornPage)
+{
+    std::fill(data.begin(), data.end(), 0x00);
+    // second page of the program is interrupted after 100 bytes
+    flash.injectFault({SimulatedFlash::Operation::PROGRAM, 1, Result::ERROR_TIMEOUT, 100});
+    EXPECT_EQ(flash.program(0, data.data(), 768), Result::ERROR_TIMEOUT);
+    const auto content = read(0, 768);
+    EXPECT_EQ(content[255], 0x00);
+    EXPECT_EQ(content[256 + 99], 0x00);
+    EXPECT_EQ(content[256 + 100], 0xFF);
+    EXPECT_EQ(content[512], 0xFF);
+
+    flash.reset();
+    EXPECT_EQ(read(0, 1)[0], 0xFF);
+    EXPECT_EQ(flash.getEraseCount(0), 0U);
+}
@@ -5,7 +5,7 @@
 
 #include "spi.h"
 
-#include "nrf_drv_spi.h"
+#include "app_error.h"
 #include "nrf_gpio.h"
 
 namespace spi
@@ -29,35 +29,36 @@ Spi::Spi(const uint8_t instanceIdx, const uint16_t csId)
     }
     if(0U == instanceIdx)
     {
-        _nrfSpiInstance = NRF_DRV_SPI_INSTANCE(0);
+        _nrfSpiInstance = NRFX_SPIM_INSTANCE(0);
     }
     else if(1U == _instanceIdx)
     {
-        //_nrfSpiInstance = NRF_DRV_SPI_INSTANCE(1);
+        //_nrfSpiInstance = NRFX_SPIM_INSTANCE(1);
     }
     else if(2U == _instanceIdx)
     {
-        //_nrfSpiInstance = NRF_DRV_SPI_INSTANCE(2);
+        //_nrfSpiInstance = NRFX_SPIM_INSTANCE(2);
     }
 }
 
-void spi_event_handler(nrf_drv_spi_evt_t const* p_event, void* p_context)
+void spi_event_handler(nrfx_spim_evt_t const* p_event, void* p_context)
 {
     Spi::getInstance().isr();
 }
 
 void Spi::init(const Configuration& configuration)
 {
-    nrf_drv_spi_config_t const spi_config = {.sck_pin = configuration.sckPin,
-                                             .mosi_pin = configuration.mosiPin,
-                                             .miso_pin = configuration.misoPin,
-                                             .ss_pin = NRF_DRV_SPI_PIN_NOT_USED,
-                                             .irq_priority = 3,
-                                             .orc = 0x00,
-                                             .frequency = configuration.baudrate,
-                                             .mode = configuration.mode,
-                                             .bit_order = configuration.bitOrder};
-    APP_ERROR_CHECK(nrf_drv_spi_init(&_nrfSpiInstance, &spi_config, spi_event_handler, NULL));
+    nrfx_spim_config_t spi_config = NRFX_SPIM_DEFAULT_CONFIG;
+    spi_config.sck_pin = configuration.sckPin;
+    spi_config.mosi_pin = configuration.mosiPin;
+    spi_config.miso_pin = configuration.misoPin;
+    spi_config.ss_pin = NRFX_SPIM_PIN_NOT_USED;
+    spi_config.irq_priority = 3;
+    spi_config.orc = 0x00;
+    spi_config.frequency = configuration.baudrate;
+    spi_config.mode = configuration.mode;
+    spi_config.bit_order = configuration.bitOrder;
+    APP_ERROR_CHECK(nrfx_spim_init(&_nrfSpiInstance, &spi_config, spi_event_handler, NULL));
     cleanContext();
     nrf_gpio_cfg_output(_csId);
 }
@@ -75,51 +76,96 @@ Spi::Result Spi::xfer(uint8_t* txData, uint8_t* rxData, size_t size, CompletionC
     // pull CS low. It's pulled back up in the interrupt.
     nrf_gpio_pin_clear(_csId);
 
-    if(size <= MAX_SINGLE_TRANSACTION_LENGTH)
+    const size_t chunk_size = (size > MAX_SINGLE_TRANSACTION_LENGTH) ? MAX_SINGLE_TRANSACTION_LENGTH : size;
+    _context.isBusy = true;
+    _context.txBuffer = txData;
+    _context.rxBuffer = rxData;
+    _context.bytesLeftToSend = size - chunk_size;
+    _context.position = 0;
+    _context.callback = callback;
+    _statistics.transfers++;
+    _statistics.bytes += size;
+    if(startTransaction(txData, chunk_size, rxData, getRxSize(chunk_size)))
     {
-        _context.isBusy = true;
-        // ugly workaround for spi_transfer, which sends an extra byte if size == 1
-        const auto result =
-            nrf_drv_spi_transfer(&_nrfSpiInstance, txData, size, rxData, (size > 1) ? size : 0);
-        if(result == NRF_SUCCESS)
-        {
-            _context.txBuffer = txData;
-            _context.rxBuffer = rxData;
-            _context.bytesLeftToSend = 0;
-            _context.position = 0;
-            _context.callback = callback;
-            return Spi::Result::OK;
-        }
+        return Spi::Result::OK;
     }
-    else
+    cleanContext();
+    nrf_gpio_pin_set(_csId);
+    return Spi::Result::ERROR;
+}
+
+Spi::Result Spi::xferRead(
+    uint8_t* header, const size_t headerSize, uint8_t* rxData, const size_t rxSize, CompletionCallback callback)
+{
+    if(_context.isBusy)
+    {
+        return Spi::Result::ERROR;
+    }
+    if(header == nullptr || headerSize == 0 || headerSize > MAX_SINGLE_TRANSACTION_LENGTH ||
+       (rxData == nullptr && rxSize > 0))
     {
-        _context.isBusy = true;
-        const auto result = nrf_drv_spi_transfer(&_nrfSpiInstance,
-                                                 txData,
-                                                 MAX_SINGLE_TRANSACTION_LENGTH,
-                                                 rxData,
-                                                 MAX_SINGLE_TRANSACTION_LENGTH);
-        if(result == NRF_SUCCESS)
-        {
-            _context.txBuffer = txData;
-            _context.rxBuffer = rxData;
-            _context.bytesLeftToSend = size - MAX_SINGLE_TRANSACTION_LENGTH;
-            return Spi::Result::OK;
-        }
+        return Spi::Result::ERROR;
     }
+    // pull CS low. It's pulled back up in the interrupt, after the last chunk of data.
+    nrf_gpio_pin_clear(_csId);
+
+    _context.isBusy = true;
+    _context.txBuffer = header;
+    _context.rxBuffer = nullptr;
+    _context.bytesLeftToSend = 0;
+    _context.position = 0;
+    _context.callback = callback;
+    _context.streamBuffer = rxData;
+    _context.streamBytesLeft = rxSize;
+    _context.streamPosition = 0;
+    _statistics.transfers++;
+    _statistics.bytes += headerSize + rxSize;
+    if(startTransaction(header, headerSize, nullptr, 0))
+    {
+        return Spi::Result::OK;
+    }
+    cleanContext();
     nrf_gpio_pin_set(_csId);
     return Spi::Result::ERROR;
 }
 
+bool Spi::startTransaction(uint8_t* txData, const size_t txSize, uint8_t* rxData, const size_t rxSize)
+{
+    const nrfx_spim_xfer_desc_t transaction = NRFX_SPIM_XFER_TRX(txData, txSize, rxData, rxSize);
+    return nrfx_spim_xfer(&_nrfSpiInstance, &transaction, 0) == NRFX_SUCCESS;
+}
+
+void Spi::startStreamChunk()
+{
+    size_t chunk_size = (_context.streamBytesLeft > MAX_SINGLE_TRANSACTION_LENGTH) ? MAX_SINGLE_TRANSACTION_LENGTH
+                                                                                  : _context.streamBytesLeft;
+    // a single byte chunk would clock an extra byte (see getRxSize), so the last chunk is kept longer.
+    // Extra byte of a single byte read is harmless: the chip continues the read, and it isn't stored.
+    if(_context.streamBytesLeft - chunk_size == 1)
+    {
+        --chunk_size;
+    }
+    uint8_t* chunk = &_context.streamBuffer[_context.streamPosition];
+    _context.streamBytesLeft -= chunk_size;
+    _context.streamPosition += chunk_size;
+    // nothing is transmitted, ORC byte is clocked out instead
+    startTransaction(nullptr, 0, chunk, chunk_size);
+}
+
 void Spi::isr()
 {
+    _statistics.interrupts++;
     if(!_context.isBusy)
     {
         // looks like an error
         return;
     }
     // TODO: add error checking
-    if(_context.bytesLeftToSend == 0)
+    if(_context.bytesLeftToSend == 0 && _context.streamBytesLeft > 0)
+    {
+        startStreamChunk();
+    }
+    else if(_context.bytesLeftToSend == 0)
     {
         nrf_gpio_pin_set(_csId);
         _context.callback(Spi::Result::OK);
@@ -127,27 +173,16 @@ void Spi::isr()
     }
     else
     {
-        if(_context.bytesLeftToSend > MAX_SINGLE_TRANSACTION_LENGTH)
-        {
-            _context.bytesLeftToSend -= MAX_SINGLE_TRANSACTION_LENGTH;
-            _context.position += MAX_SINGLE_TRANSACTION_LENGTH;
-            nrf_drv_spi_transfer(&_nrfSpiInstance,
-                                 &_context.txBuffer[_context.position],
-                                 MAX_SINGLE_TRANSACTION_LENGTH,
-                                 &_context.rxBuffer[_context.position],
-                                 MAX_SINGLE_TRANSACTION_LENGTH);
-        }
-        else
-        {
-            //_context.bytesLeftToSend -= MAX_SINGLE_TRANSACTION_LENGTH;
-            _context.position += MAX_SINGLE_TRANSACTION_LENGTH;
-            nrf_drv_spi_transfer(&_nrfSpiInstance,
-                                 &_context.txBuffer[_context.position],
-                                 _context.bytesLeftToSend,
-                                 &_context.rxBuffer[_context.position],
-                                 _context.bytesLeftToSend);
-            _context.bytesLeftToSend = 0U;
-        }
+        // only transfers longer than the DMA transaction limit get here
+        const size_t chunk_size = (_context.bytesLeftToSend > MAX_SINGLE_TRANSACTION_LENGTH)
+                                      ? MAX_SINGLE_TRANSACTION_LENGTH
+                                      : _context.bytesLeftToSend;
+        _context.position += MAX_SINGLE_TRANSACTION_LENGTH;
+        _context.bytesLeftToSend -= chunk_size;
+        startTransaction(&_context.txBuffer[_context.position],
+                         chunk_size,
+                         &_context.rxBuffer[_context.position],
+                         getRxSize(chunk_size));
     }
 }
 
@@ -158,6 +193,9 @@ void Spi::cleanContext()
     _context.rxBuffer = nullptr;
     _context.bytesLeftToSend = 0;
     _context.position = 0;
+    _context.streamBuffer = nullptr;
+    _context.streamBytesLeft = 0;
+    _context.streamPosition = 0;
 }
 
 } // namespace spi
\ No newline at end of file
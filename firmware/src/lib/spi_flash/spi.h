@@ -5,7 +5,7 @@
 
 #pragma once
 
-#include "nrf_drv_spi.h"
+#include "nrfx_spim.h"
 #include <cstddef>
 #include <stdint.h>
 
@@ -13,9 +13,9 @@ namespace spi
 {
 
 /**
- * This is a wrapper around Nordic SPI functions.
- * Its' purpose is to overcome limitations of the normal SPI driver 
- * (in particular, max transfer size of 128 bytes).
+ * This is a wrapper around Nordic SPIM driver.
+ * Its' purpose is to handle transfers of any size: every DMA transaction takes the largest
+ * chunk supported by the hardware (64K on nRF52840), so a transfer ends with a single interrupt.
  */
 class Spi
 {
@@ -24,9 +24,9 @@ public:
 
     struct Configuration
     {
-        nrf_drv_spi_frequency_t baudrate;
-        nrf_drv_spi_mode_t mode;
-        nrf_drv_spi_bit_order_t bitOrder;
+        nrf_spim_frequency_t baudrate;
+        nrf_spim_mode_t mode;
+        nrf_spim_bit_order_t bitOrder;
         uint8_t sckPin;
         uint8_t mosiPin;
         uint8_t misoPin;
@@ -41,6 +41,25 @@ public:
     using CompletionCallback = void (*)(Result);
     Result xfer(uint8_t* txData, uint8_t* rxData, size_t size);
     Result xfer(uint8_t* txData, uint8_t* rxData, size_t size, CompletionCallback callback);
+    /// @brief Send the header, then receive rxSize bytes directly into rxData. CS stays asserted
+    ///        for the whole operation, data is received by chunks of the max DMA transaction size.
+    Result xferRead(uint8_t* header, size_t headerSize, uint8_t* rxData, size_t rxSize, CompletionCallback callback);
+
+    struct Statistics
+    {
+        uint32_t transfers{0};
+        uint32_t bytes{0};
+        /// DMA transactions, each of them ends with an interrupt
+        uint32_t interrupts{0};
+    };
+    const Statistics& getStatistics() const
+    {
+        return _statistics;
+    }
+    void resetStatistics()
+    {
+        _statistics = Statistics{};
+    }
 
     static inline Spi& getInstance()
     {
@@ -48,7 +67,7 @@ public:
     }
 
     void isr();
-    nrf_drv_spi_t _nrfSpiInstance;
+    nrfx_spim_t _nrfSpiInstance;
 
 private:
     // TODO: extend to several instances, if needed
@@ -65,14 +84,30 @@ private:
         size_t bytesLeftToSend;
         size_t position;
         CompletionCallback callback;
+        // data phase of xferRead, started when the header has been sent
+        uint8_t* streamBuffer;
+        size_t streamBytesLeft;
+        size_t streamPosition;
     };
 
     volatile Context _context;
+    Statistics _statistics;
 
     void cleanContext();
+    void startStreamChunk();
+    /// @return false if the driver has rejected the transaction
+    bool startTransaction(uint8_t* txData, size_t txSize, uint8_t* rxData, size_t rxSize);
 
-    static const size_t MAX_SINGLE_TRANSACTION_LENGTH = 128U;
+    // EasyDMA MAXCNT width of the SPIM instance (16 bits on nRF52840, 8 bits on nRF52832)
+    static constexpr size_t MAX_SINGLE_TRANSACTION_LENGTH{(1UL << SPIM0_EASYDMA_MAXCNT_SIZE) - 1};
     static void emptyCallback(const Result) { }
+    // nRF52832 anomaly 58: SPIM clocks an extra byte, when RXD.MAXCNT is 1 and TXD.MAXCNT is not above 1.
+    // Single-byte commands (f.e. WREN, power-down) are executed only if CS rises right after the 8th bit,
+    // so nothing is received for them.
+    static constexpr size_t getRxSize(const size_t chunk_size)
+    {
+        return (chunk_size > 1) ? chunk_size : 0;
+    }
 };
 
 } // namespace spi
\ No newline at end of file
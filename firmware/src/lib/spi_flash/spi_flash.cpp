@@ -5,6 +5,7 @@
 
 #include "spi_flash.h"
 #include "boards.h"
+#include "nrf_delay.h"
 #include "nrf_gpio.h"
 #include "nrf_log.h"
 #include <cstring>
@@ -17,6 +18,38 @@ static const uint32_t MAX_SPI_WAIT_TIMEOUT = 100000;
 volatile bool SpiFlash::_isSpiOperationPending;
 SpiFlash* SpiFlash::_instance{nullptr};
 
+// Erase suspended for an access is resumed on any exit from the access, including the error ones.
+// Otherwise it would stay suspended for good, as accesses don't preempt a suspended erase.
+class ErasePreemption
+{
+public:
+    ErasePreemption(SpiFlash& flash, const bool is_preempted)
+        : _flash{flash}
+        , _is_preempted{is_preempted}
+    {
+    }
+    ErasePreemption(const ErasePreemption&) = delete;
+    ErasePreemption(ErasePreemption&&) = delete;
+    ErasePreemption& operator=(const ErasePreemption&) = delete;
+    ErasePreemption& operator=(ErasePreemption&&) = delete;
+    ~ErasePreemption()
+    {
+        if(_is_preempted && _flash.resumeErase() != SpiFlash::Result::OK)
+        {
+            NRF_LOG_ERROR("flash: suspended erase has not been resumed");
+        }
+    }
+
+    bool isPreempted() const
+    {
+        return _is_preempted;
+    }
+
+private:
+    SpiFlash& _flash;
+    const bool _is_preempted;
+};
+
 SpiFlash::SpiFlash(spi::Spi& flashSpi, DelayFunction delay_function, TickFunction tick_function)
     : _spi(flashSpi)
     , _delay(delay_function)
@@ -38,6 +71,25 @@ SpiFlash::SpiFlash(spi::Spi& flashSpi, DelayFunction delay_function, TickFunctio
     }
 }
 
+void SpiFlash::setCompletionSignalling(WaitCompletionFunction wait_function,
+                                       SignalCompletionFunction signal_function)
+{
+    _is_completion_signalling_enabled = false;
+    _wait_completion = wait_function;
+    _signal_completion = signal_function;
+    _is_completion_signalling_enabled = (_wait_completion && _signal_completion != nullptr);
+}
+
+void SpiFlash::enableCompletionSignalling(const bool is_enabled)
+{
+    _is_completion_signalling_enabled = is_enabled && _wait_completion && _signal_completion != nullptr;
+}
+
+bool SpiFlash::isCompletionSignallingEnabled() const
+{
+    return _is_completion_signalling_enabled;
+}
+
 void SpiFlash::init()
 {
     nrf_gpio_cfg_output(SPI_FLASH_RST_PIN);
@@ -45,6 +97,7 @@ void SpiFlash::init()
 
     nrf_gpio_pin_set(SPI_FLASH_RST_PIN);
     nrf_gpio_pin_set(SPI_FLASH_WP_PIN);
+    _busy_start_tick = _get_ticks();
 }
 
 SpiFlash::Result SpiFlash::read(uint32_t address, uint8_t* data, uint32_t size)
@@ -53,106 +106,153 @@ SpiFlash::Result SpiFlash::read(uint32_t address, uint8_t* data, uint32_t size)
     {
         return Result::ERROR_INPUT;
     }
-
-    if(size > MAX_TRANSACTION_SIZE)
+    if(size == 0)
     {
-        return Result::ERROR_INPUT;
+        return Result::OK;
     }
 
-    // TODO: consider reducing this delay to minimum (using more detailed ticks' source)
-    if(_get_ticks() - _last_transaction_tick == 0)
+    auto& stats = statistics(Command::READ);
+    ensureAwake();
+    // chip doesn't serve reads while it's programming or erasing. After another read it's never busy.
+    const ErasePreemption preemption{*this, preemptErase(address, size)};
+    if(!waitWhileBusy(stats))
     {
-        _delay(1);
+        return Result::ERROR_TIMEOUT;
     }
 
     // 1. fill in transaction header
-    _txBuffer[0] = 0x3U;
-    _txBuffer[1] = (address >> 16) & 0xFF;
-    _txBuffer[2] = (address >> 8) & 0xFF;
-    _txBuffer[3] = (address)&0xFF;
-
-    // 2. start the transaction
-    _spi.xfer(_txBuffer, _rxBuffer, size + 4, spiOperationCallback);
-    _isSpiOperationPending = true;
+    const uint32_t header_size = setCommandHeader(_txBuffer, 0x03, 0x13, address);
 
+    // 2. data is clocked directly into the caller's buffer, in one command regardless of the size
     _context.operation = Operation::READ;
     _context.data = data;
     _context.address = address;
     _context.size = size;
-
-    uint32_t timeout{max_read_transaction_time_ms};
-    while(_isSpiOperationPending && timeout > 0)
+    _isSpiOperationPending = true;
+    const auto xfer_result = _spi.xferRead(_txBuffer, header_size, data, size, spiOperationCallback);
+    if(spi::Spi::Result::OK != xfer_result)
     {
-        _delay(short_delay_duration_ms);
-        --timeout;
+        _isSpiOperationPending = false;
+        _context.operation = Operation::IDLE;
+        return Result::ERROR_GENERAL;
     }
-    if(0 == timeout)
+    stats.count++;
+    stats.bytes += size;
+
+    const uint32_t max_duration_ms{max_read_transaction_time_ms + size / min_read_bytes_per_ms};
+    if(!waitForTransactionEnd(max_duration_ms, stats))
     {
         // TODO: define appropriate actions for this case
         // Apparently it's a critical error. Context is unknown at this point...
         NRF_LOG_ERROR("read: timeout error");
+        abandonTransaction();
         return Result::ERROR_TIMEOUT;
     }
-
-    _last_transaction_tick = _get_ticks();
     return Result::OK;
 }
 
-// TODO: might have to implement programming of several pages
 SpiFlash::Result SpiFlash::program(uint32_t address, const uint8_t* const data, uint32_t size)
 {
-
     if(data == nullptr)
     {
         return Result::ERROR_INPUT;
     }
-    if(size > PAGE_SIZE)
-    {
-        return Result::ERROR_ALIGNMENT;
-    }
-    uint32_t timeout{max_wait_time_ms};
-    while(isBusy() && timeout > 0)
-    {
-        _delay(short_delay_duration_ms);
-        --timeout;
-    }
-    if(timeout == 0)
+    auto& stats = statistics(Command::PROGRAM);
+    ensureAwake();
+    const ErasePreemption preemption{*this, preemptErase(address, size)};
+
+    // Pages are programmed back to back from 2 buffers: the next page is staged while the chip
+    // is still programming the previous one.
+    uint8_t* const buffers[]{_txBuffer, _stagingBuffer};
+    uint32_t buffer_index{0};
+    uint32_t position{0};
+    const uint32_t header_size = getCommandHeaderSize();
+    uint32_t chunk_size = stagePage(buffers[buffer_index], address, data, size);
+    while(position < size)
     {
-        return Result::ERROR_TIMEOUT;
+        if(!waitWhileBusy(stats))
+        {
+            return Result::ERROR_TIMEOUT;
+        }
+        if(!writeEnable(true))
+        {
+            return Result::ERROR_GENERAL;
+        }
+
+        _isSpiOperationPending = true;
+        _is_write_in_progress = true;
+        expectBusy(_busy_timing.page_program_typical_us, _busy_timing.page_program_max_us);
+        const auto xfer_result =
+            _spi.xfer(buffers[buffer_index], _rxBuffer, chunk_size + header_size, spiOperationCallback);
+        if(spi::Spi::Result::OK != xfer_result)
+        {
+            // the command hasn't been sent, so the chip doesn't program
+            _isSpiOperationPending = false;
+            _is_write_in_progress = false;
+            return Result::ERROR_GENERAL;
+        }
+        _context.operation = Operation::WRITE;
+        _context.data = const_cast<uint8_t*>(&data[position]);
+        _context.address = address + position;
+        _context.size = chunk_size;
+        stats.count++;
+        stats.bytes += chunk_size;
+
+        if(!waitForTransactionEnd(max_program_transaction_time_ms, stats))
+        {
+            // the page might be partially programmed, caller has to handle it (see VerifyingFlash)
+            NRF_LOG_ERROR("program: timeout error");
+            abandonTransaction();
+            return Result::ERROR_TIMEOUT;
+        }
+
+        position += chunk_size;
+        if(position < size)
+        {
+            buffer_index ^= 1;
+            chunk_size = stagePage(buffers[buffer_index], address + position, &data[position], size - position);
+        }
     }
 
-    if(_get_ticks() - _last_transaction_tick == 0)
+    // erase can only be resumed when the last page has been programmed
+    if(preemption.isPreempted() && !waitWhileBusy(stats))
     {
-        _delay(1);
+        return Result::ERROR_TIMEOUT;
     }
+    return Result::OK;
+}
 
-    writeEnable(true);
-    _txBuffer[0] = 0x2;
-    _txBuffer[1] = (address >> 16) & 0xFF;
-    _txBuffer[2] = (address >> 8) & 0xFF;
-    _txBuffer[3] = (address)&0xFF;
-    memcpy(&_txBuffer[4], data, size);
+uint32_t SpiFlash::stagePage(uint8_t* buffer, const uint32_t address, const uint8_t* data, const uint32_t size)
+{
+    // programmed part shall not cross the page boundary
+    const uint32_t page_size{_geometry.page_size};
+    const uint32_t page_left{page_size - (address % page_size)};
+    const uint32_t chunk_size{(size < page_left) ? size : page_left};
 
-    _isSpiOperationPending = true;
-    _spi.xfer(_txBuffer, _rxBuffer, size + 4, spiOperationCallback);
-    _context.operation = Operation::WRITE;
-    _context.data = (uint8_t*)data;
-    _context.address = address;
-    _context.size = size;
+    const uint32_t header_size = setCommandHeader(buffer, 0x02, 0x12, address);
+    memcpy(&buffer[header_size], data, chunk_size);
+    return chunk_size;
+}
 
-    timeout = max_program_transaction_time_ms;
-    while(_isSpiOperationPending && timeout > 0)
+uint32_t SpiFlash::setCommandHeader(uint8_t* buffer,
+                                    const uint8_t opcode,
+                                    const uint8_t opcode_4_byte,
+                                    const uint32_t address) const
+{
+    uint32_t position{0};
+    if(_is_4_byte_addressing)
     {
-        _delay(short_delay_duration_ms);
-        --timeout;
+        buffer[position++] = opcode_4_byte;
+        buffer[position++] = static_cast<uint8_t>((address >> 24) & 0xFF);
     }
-    if(0 == timeout)
+    else
     {
-        // TODO: define appropriate actions for this case
+        buffer[position++] = opcode;
     }
-
-    _last_transaction_tick = _get_ticks();
-    return Result::OK;
+    buffer[position++] = static_cast<uint8_t>((address >> 16) & 0xFF);
+    buffer[position++] = static_cast<uint8_t>((address >> 8) & 0xFF);
+    buffer[position++] = static_cast<uint8_t>((address)&0xFF);
+    return position;
 }
 
 SpiFlash::Result SpiFlash::eraseSector(const uint32_t address)
@@ -161,147 +261,293 @@ SpiFlash::Result SpiFlash::eraseSector(const uint32_t address)
     {
         return Result::ERROR_ALIGNMENT;
     }
+    const uint8_t opcode = _erase_opcodes[static_cast<uint32_t>(EraseType::SECTOR_4K)];
+    return startErase(opcode, 0x21, EraseType::SECTOR_4K, address, statistics(Command::ERASE_SECTOR));
+}
 
-    uint32_t timeout{max_wait_time_ms};
-    while(isBusy() && timeout > 0)
+SpiFlash::Result SpiFlash::erase32KBlock(const uint32_t address)
+{
+    if(address % B32K_SIZE != 0)
     {
-        _delay(short_delay_duration_ms);
-        --timeout;
+        return Result::ERROR_ALIGNMENT;
     }
-    if(timeout == 0)
+    // not every part with 4-byte addressing has 0x5C, so 32K erase is not planned for them (see detectGeometry)
+    const uint8_t opcode = _erase_opcodes[static_cast<uint32_t>(EraseType::BLOCK_32K)];
+    return startErase(opcode, 0x5C, EraseType::BLOCK_32K, address, statistics(Command::ERASE_32K_BLOCK));
+}
+
+SpiFlash::Result SpiFlash::erase64KBlock(const uint32_t address)
+{
+    if (address % B64K_SIZE != 0)
+    {
+        return Result::ERROR_ALIGNMENT;
+    }
+    const uint8_t opcode = _erase_opcodes[static_cast<uint32_t>(EraseType::BLOCK_64K)];
+    return startErase(opcode, 0xDC, EraseType::BLOCK_64K, address, statistics(Command::ERASE_64K_BLOCK));
+}
+
+SpiFlash::Result SpiFlash::startErase(const uint8_t opcode,
+                                      const uint8_t opcode_4_byte,
+                                      const EraseType type,
+                                      const uint32_t address,
+                                      CommandStatistics& stats)
+{
+    ensureAwake();
+    const uint32_t size = get_erase_size(type, _geometry.total_size);
+    // the chip doesn't accept another erase while one is suspended
+    if(_is_erase_suspended)
+    {
+        return Result::ERROR_BUSY;
+    }
+    if(!waitWhileBusy(stats))
     {
         return Result::ERROR_TIMEOUT;
     }
 
-    if(_get_ticks() - _last_transaction_tick == 0)
+    if(!writeEnable(true))
     {
-        _delay(1);
+        return Result::ERROR_GENERAL;
     }
 
-    writeEnable(true);
+    const uint32_t typical_us = _erase_timing.get(type) * 1000;
+    _erase_max_us = typical_us * _busy_timing.erase_max_multiplier;
     _isSpiOperationPending = true;
-    _txBuffer[0] = 0x20;
-    _txBuffer[1] = static_cast<uint8_t>((address >> 16) & 0xFF);
-    _txBuffer[2] = static_cast<uint8_t>((address >> 8) & 0xFF);
-    _txBuffer[3] = static_cast<uint8_t>((address)&0xFF);
+    _is_write_in_progress = true;
+    expectBusy(typical_us, _erase_max_us);
+    _is_erase_in_progress = true;
+    _erase_address = address;
+    _erase_size = size;
+    const uint32_t header_size = setCommandHeader(_txBuffer, opcode, opcode_4_byte, address);
 
-    _spi.xfer(_txBuffer, _rxBuffer, 4, spiOperationCallback);
+    const auto xfer_result = _spi.xfer(_txBuffer, _rxBuffer, header_size, spiOperationCallback);
+    if(spi::Spi::Result::OK != xfer_result)
+    {
+        _isSpiOperationPending = false;
+        _is_write_in_progress = false;
+        _is_erase_in_progress = false;
+        return Result::ERROR_GENERAL;
+    }
     _context.operation = Operation::ERASE;
-    _last_transaction_tick = _get_ticks();
+    stats.count++;
+    stats.bytes += size;
     return Result::OK;
 }
 
-SpiFlash::Result SpiFlash::erase64KBlock(const uint32_t address)
+SpiFlash::Result SpiFlash::erase(const uint32_t address, const uint32_t size)
 {
-    if (address % B64K_SIZE != 0)
+    if((address % SECTOR_SIZE != 0) || (size % SECTOR_SIZE != 0))
     {
         return Result::ERROR_ALIGNMENT;
     }
-    uint32_t timeout{max_wait_time_ms};
-    while(isBusy() && timeout > 0)
+    if(size == 0)
     {
-        _delay(short_delay_duration_ms);
-        --timeout;
+        return Result::OK;
     }
-    if(timeout == 0)
+    ErasePlan plan;
+    if(!plan_erase(address, size, _geometry.total_size, _erase_timing, plan))
     {
-        return Result::ERROR_TIMEOUT;
+        return Result::ERROR_INPUT;
     }
 
-    if(_get_ticks() - _last_transaction_tick == 0)
+    const auto start_tick = _get_ticks();
+    Result result{Result::OK};
+    execute_erase_plan(plan, _geometry.total_size, [this, &result](const EraseType type, const uint32_t position) {
+        result = runEraseCommand(type, position);
+        return result == Result::OK;
+    });
+    _context.operation = Operation::IDLE;
+
+    _last_erase_report = EraseReport{size, plan.commands_count, plan.estimated_duration_ms, _get_ticks() - start_tick};
+    NRF_LOG_INFO("flash: erase %d@%x: %d cmds, est %d ms, took %d ticks",
+                 size,
+                 address,
+                 plan.commands_count,
+                 plan.estimated_duration_ms,
+                 _last_erase_report.duration_ticks);
+    return result;
+}
+
+SpiFlash::Result SpiFlash::runEraseCommand(const EraseType type, const uint32_t address)
+{
+    Result result{Result::ERROR_INPUT};
+    Command command{Command::ERASE_SECTOR};
+    switch(type)
+    {
+    case EraseType::SECTOR_4K:
+        result = eraseSector(address);
+        break;
+    case EraseType::BLOCK_32K:
+        result = erase32KBlock(address);
+        command = Command::ERASE_32K_BLOCK;
+        break;
+    case EraseType::BLOCK_64K:
+        result = erase64KBlock(address);
+        command = Command::ERASE_64K_BLOCK;
+        break;
+    case EraseType::CHIP:
+        result = eraseChip();
+        command = Command::ERASE_CHIP;
+        break;
+    case EraseType::COUNT: break;
+    }
+    if(result != Result::OK)
+    {
+        return result;
+    }
+    if(!waitWhileBusy(statistics(command)))
     {
-        _delay(1);
+        return Result::ERROR_TIMEOUT;
     }
+    return Result::OK;
+}
 
-    writeEnable(true);
-    _isSpiOperationPending = true;
-    _txBuffer[0] = 0xD8;
-    _txBuffer[1] = static_cast<uint8_t>((address >> 16) & 0xFF);
-    _txBuffer[2] = static_cast<uint8_t>((address >> 8) & 0xFF);
-    _txBuffer[3] = static_cast<uint8_t>((address)&0xFF);
+void SpiFlash::setEraseTiming(const EraseTiming& timing)
+{
+    _erase_timing = timing;
+}
 
-    _spi.xfer(_txBuffer, _rxBuffer, 4, spiOperationCallback);
-    _context.operation = Operation::ERASE;
-    _last_transaction_tick = _get_ticks();
-    return Result::OK;
+const EraseTiming& SpiFlash::getEraseTiming() const
+{
+    return _erase_timing;
 }
 
-SpiFlash::Result SpiFlash::erase(const uint32_t address, const uint32_t size)
+const SpiFlash::EraseReport& SpiFlash::getLastEraseReport() const
 {
+    return _last_erase_report;
+}
 
-    if((address % SECTOR_SIZE != 0) || (size % SECTOR_SIZE != 0))
+void SpiFlash::setBusyTiming(const BusyTiming& timing)
+{
+    _busy_timing = timing;
+}
+
+const SpiFlash::BusyTiming& SpiFlash::getBusyTiming() const
+{
+    return _busy_timing;
+}
+
+bool SpiFlash::isBusy()
+{
+    if(_isSpiOperationPending)
     {
-        return Result::ERROR_ALIGNMENT;
+        return true;
     }
-
-    uint32_t timeout{max_wait_time_ms};
-    while(isBusy() && timeout > 0)
+    if(!_is_write_in_progress)
     {
-        _delay(short_delay_duration_ms);
-        --timeout;
+        return false;
     }
-    if(timeout == 0)
+    const auto sr1 = getSR1();
+    _is_write_in_progress = (sr1 & SR1_BUSY) > 0U;
+    if(!_is_write_in_progress && !_is_erase_suspended)
     {
-        return Result::ERROR_TIMEOUT;
+        _is_erase_in_progress = false;
     }
+    return _is_write_in_progress;
+}
 
-    if((address % SECTOR_SIZE != 0) || (size % SECTOR_SIZE != 0))
+void SpiFlash::enableEraseSuspend(const bool is_enabled)
+{
+    _is_erase_suspend_enabled = is_enabled;
+}
+
+bool SpiFlash::isEraseSuspendEnabled() const
+{
+    return _is_erase_suspend_enabled;
+}
+
+bool SpiFlash::isEraseInProgress() const
+{
+    return _is_erase_in_progress;
+}
+
+bool SpiFlash::isEraseInArea(const uint32_t address, const uint32_t size) const
+{
+    return _is_erase_in_progress && (address < _erase_address + _erase_size) && (_erase_address < address + size);
+}
+
+SpiFlash::Result SpiFlash::suspendErase()
+{
+    if(_is_erase_suspended || !isBusy() || !_is_erase_in_progress)
     {
-        return Result::ERROR_ALIGNMENT;
+        return Result::ERROR_INPUT;
     }
-    volatile int32_t position = static_cast<int32_t>(address);
-    volatile int32_t leftover = static_cast<int32_t>(size);
-    while (leftover > 0)
+    if(_get_ticks() == _last_resume_tick)
     {
-        Result res{Result::ERROR_GENERAL};
-        int32_t current_erase_size{0};
-        if (leftover >= static_cast<int32_t>(B64K_SIZE) && ((position % B64K_SIZE) == 0))
-        {
-            res = erase64KBlock(position);
-            current_erase_size = B64K_SIZE;
-        }
-        else 
-        {
-            res = eraseSector(position);
-            current_erase_size = SECTOR_SIZE;
-        }
-        NRF_LOG_INFO("erasing %d@%x, %d left", current_erase_size, position, leftover);
-        if (res != Result::OK)
-        {
-            _context.operation = Operation::IDLE;
-            return res;
-        }
-        timeout = max_erase_duration_time_ms;
-        while(isBusy() && timeout > 0)
+        _delay(short_delay_duration_ms);
+        if(!isBusy())
         {
-            _delay(short_delay_duration_ms);
-            --timeout;
+            return Result::ERROR_INPUT;
         }
-        if(timeout == 0)
+    }
+
+    sendCommand(0x75);
+    uint32_t polls_count{0};
+    while((getSR1() & SR1_BUSY) > 0U)
+    {
+        if(++polls_count == max_suspend_status_polls)
         {
+            NRF_LOG_WARNING("flash: erase suspend has not been accepted");
             return Result::ERROR_TIMEOUT;
         }
-        leftover = leftover - current_erase_size;
-        position += current_erase_size;
     }
+    _is_erase_suspended = true;
+    _is_write_in_progress = false;
+    statistics(Command::ERASE_SUSPEND).count++;
+    return Result::OK;
+}
 
-    _context.operation = Operation::IDLE;
+SpiFlash::Result SpiFlash::resumeErase()
+{
+    if(!_is_erase_suspended)
+    {
+        return Result::ERROR_INPUT;
+    }
+    // program issued during the suspend has to be completed first
+    if(!waitWhileBusy(statistics(Command::ERASE_SUSPEND)))
+    {
+        return Result::ERROR_TIMEOUT;
+    }
+    sendCommand(0x7A);
+    _is_erase_suspended = false;
+    _is_write_in_progress = true;
+    // the remaining part of the erase is not known, it's only limited by the maximal duration
+    expectBusy(0, _erase_max_us);
+    _last_resume_tick = _get_ticks();
     return Result::OK;
 }
 
-bool SpiFlash::isBusy()
+bool SpiFlash::preemptErase(const uint32_t address, const uint32_t size)
 {
-    if(_isSpiOperationPending)
+    if(!_is_erase_suspend_enabled || !_is_erase_in_progress || _is_erase_suspended)
     {
-        return true;
+        return false;
     }
-    auto sr1 = getSR1();
-    auto result = (sr1 & 0x01) > 0U;
-    return result;
+    if(isEraseInArea(address, size))
+    {
+        // accessed area is being erased: the access has to wait for the end of the erase
+        return false;
+    }
+    return suspendErase() == Result::OK;
+}
+
+void SpiFlash::sendCommand(const uint8_t opcode)
+{
+    uint8_t tx_data[] = {opcode};
+    uint8_t rx_data[] = {0x00};
+    _isSpiOperationPending = true;
+    _spi.xfer(tx_data, rx_data, 1, spiOperationCallback);
+    volatile uint32_t timeout = MAX_SPI_WAIT_TIMEOUT;
+    while(_isSpiOperationPending && ((timeout--) > 0))
+        ;
 }
 
 void SpiFlash::reset()
 {
+    // chip ignores the reset in deep power-down, it might have been left there before an MCU reset
+    sendCommand(_release_opcode);
+    nrf_delay_us(_release_time_us);
+    _power_state = PowerState::STANDBY;
+
     _isSpiOperationPending = true;
     uint8_t tx_data[] = {0x99};
     uint8_t rx_data[] = {0x00};
@@ -314,6 +560,7 @@ void SpiFlash::reset()
 
 uint8_t SpiFlash::getSR1()
 {
+    ensureAwake();
     volatile uint32_t timeout = MAX_SPI_WAIT_TIMEOUT;
     while(_isSpiOperationPending && ((timeout--) > 0))
         ;
@@ -332,6 +579,7 @@ uint8_t SpiFlash::getSR1()
 
 void SpiFlash::readJedecId(uint8_t* id)
 {
+    ensureAwake();
     uint32_t timeout{max_wait_time_ms};
     while(isBusy() && timeout > 0)
     {
@@ -356,9 +604,14 @@ void SpiFlash::readJedecId(uint8_t* id)
     memcpy(id, &rx_data[1], 4);
 }
 
-// TODO: add return type
-void SpiFlash::writeEnable(bool shouldEnable)
+bool SpiFlash::readSfdp(const uint32_t address, uint8_t* data, const uint32_t size)
 {
+    static constexpr uint32_t header_size{5};
+    if(data == nullptr || size + header_size > MAX_TRANSACTION_SIZE)
+    {
+        return false;
+    }
+    ensureAwake();
     uint32_t timeout{max_wait_time_ms};
     while(isBusy() && timeout > 0)
     {
@@ -367,7 +620,161 @@ void SpiFlash::writeEnable(bool shouldEnable)
     }
     if(timeout == 0)
     {
-        return;
+        return false;
+    }
+
+    // 0x5A, 24-bit address, 8 dummy clocks
+    _txBuffer[0] = 0x5A;
+    _txBuffer[1] = (address >> 16) & 0xFF;
+    _txBuffer[2] = (address >> 8) & 0xFF;
+    _txBuffer[3] = (address)&0xFF;
+    _txBuffer[4] = 0x00;
+    _isSpiOperationPending = true;
+    _spi.xfer(_txBuffer, _rxBuffer, size + header_size, spiOperationCallback);
+
+    timeout = MAX_SPI_WAIT_TIMEOUT;
+    while(_isSpiOperationPending && ((timeout--) > 0))
+        ;
+    if(_isSpiOperationPending)
+    {
+        return false;
+    }
+    memcpy(data, &_rxBuffer[header_size], size);
+    return true;
+}
+
+bool SpiFlash::detectGeometryFromSfdp(Geometry& geometry, bool& is_4_byte_address_supported)
+{
+    sfdp::BasicParameters parameters;
+    const auto read = [this](const uint32_t address, uint8_t* data, const uint32_t size) {
+        return readSfdp(address, data, size);
+    };
+    if(!sfdp::read_basic_parameters(read, parameters))
+    {
+        return false;
+    }
+    geometry.total_size = parameters.total_size;
+    // Larger pages are still programmed by PAGE_SIZE parts, as it's the limit of the transaction buffer.
+    if(parameters.page_size >= 64 && parameters.page_size <= PAGE_SIZE)
+    {
+        geometry.page_size = parameters.page_size;
+    }
+    is_4_byte_address_supported = parameters.address_bytes != sfdp::AddressBytes::THREE_ONLY;
+    if(!parameters.is_4k_erase_supported)
+    {
+        NRF_LOG_WARNING("flash: 4kB erase is not reported by SFDP");
+    }
+
+    // the table lists 3-byte address opcodes only, 4-byte address ones are kept fixed
+    const EraseType erase_types[]{EraseType::SECTOR_4K, EraseType::BLOCK_32K, EraseType::BLOCK_64K};
+    for(const auto type : erase_types)
+    {
+        const uint8_t opcode = sfdp::get_erase_opcode(parameters, get_erase_size(type, geometry.total_size));
+        if(opcode != 0)
+        {
+            _erase_opcodes[static_cast<uint32_t>(type)] = opcode;
+        }
+    }
+
+    if(parameters.page_program_typical_us > 0)
+    {
+        _busy_timing.page_program_typical_us = parameters.page_program_typical_us;
+        _busy_timing.page_program_max_us = parameters.page_program_max_us;
+        NRF_LOG_INFO("flash: page program %d us, max %d us",
+                     parameters.page_program_typical_us,
+                     parameters.page_program_max_us);
+    }
+    if(parameters.power_down_opcode != 0)
+    {
+        _power_down_opcode = parameters.power_down_opcode;
+        _release_opcode = parameters.release_opcode;
+        _release_time_us = parameters.release_time_us;
+        NRF_LOG_INFO("flash: deep power-down release %d us", _release_time_us);
+    }
+    const auto timing = sfdp::get_erase_timing(parameters);
+    if(timing.get(EraseType::SECTOR_4K) == 0)
+    {
+        NRF_LOG_WARNING("flash: SFDP doesn't provide 4kB erase timing, default timing is used");
+        return true;
+    }
+    _erase_timing = timing;
+    _busy_timing.erase_max_multiplier = parameters.erase_max_multiplier;
+    NRF_LOG_INFO("flash: erase 4K %d ms, 32K %d ms, 64K %d ms, chip %d ms",
+                 timing.get(EraseType::SECTOR_4K),
+                 timing.get(EraseType::BLOCK_32K),
+                 timing.get(EraseType::BLOCK_64K),
+                 timing.get(EraseType::CHIP));
+    return true;
+}
+
+SpiFlash::Geometry SpiFlash::detectGeometry()
+{
+    Geometry geometry{PAGE_SIZE, SECTOR_SIZE, DEFAULT_TOTAL_SIZE};
+    // JEDEC ID doesn't tell it, but parts larger than 16 MB can't do without 4-byte addresses
+    bool is_4_byte_address_supported{true};
+    if(detectGeometryFromSfdp(geometry, is_4_byte_address_supported))
+    {
+        NRF_LOG_INFO("flash: SFDP: %d bytes, page %d", geometry.total_size, geometry.page_size);
+    }
+    else
+    {
+        uint8_t id[6]{0};
+        readJedecId(id);
+        // capacity byte is log2 of the size for the most of vendors, 512Mbit and larger parts continue from 0x20
+        const uint8_t capacity = id[2];
+        if(capacity >= 0x10 && capacity <= 0x1F)
+        {
+            geometry.total_size = 1UL << capacity;
+        }
+        else if(capacity >= 0x20 && capacity <= 0x22)
+        {
+            geometry.total_size = 1UL << (capacity - 6);
+        }
+        NRF_LOG_INFO("flash: JEDEC capacity %x: %d bytes", capacity, geometry.total_size);
+    }
+    // Dedicated 4-byte address opcodes are used instead of entering the 4-byte mode (EN4B),
+    // so the driver doesn't depend on the mode state, that is lost on a reset of the chip.
+    _is_4_byte_addressing = false;
+    if(geometry.total_size > MAX_3_BYTE_ADDRESSABLE_SIZE)
+    {
+        if(is_4_byte_address_supported)
+        {
+            _is_4_byte_addressing = true;
+            _erase_timing.duration_ms[static_cast<uint32_t>(EraseType::BLOCK_32K)] = 0;
+            NRF_LOG_INFO("flash: 4-byte addressing");
+        }
+        else
+        {
+            NRF_LOG_WARNING("flash: only %d bytes are addressable", MAX_3_BYTE_ADDRESSABLE_SIZE);
+            geometry.total_size = MAX_3_BYTE_ADDRESSABLE_SIZE;
+        }
+    }
+    _geometry = geometry;
+    return _geometry;
+}
+
+SpiFlash::Geometry SpiFlash::getGeometry() const
+{
+    return _geometry;
+}
+
+bool SpiFlash::is4ByteAddressing() const
+{
+    return _is_4_byte_addressing;
+}
+
+bool SpiFlash::writeEnable(bool shouldEnable)
+{
+    ensureAwake();
+    uint32_t timeout{max_wait_time_ms};
+    while(isBusy() && timeout > 0)
+    {
+        _delay(short_delay_duration_ms);
+        --timeout;
+    }
+    if(timeout == 0)
+    {
+        return false;
     }
 
     _isSpiOperationPending = true;
@@ -383,39 +790,237 @@ void SpiFlash::writeEnable(bool shouldEnable)
     timeout = MAX_SPI_WAIT_TIMEOUT;
     while(_isSpiOperationPending && ((timeout--) > 0))
         ;
+    // WEL is the only confirmation that the chip has accepted the command (f.e. it's not write-protected)
+    const bool is_write_enabled = (getSR1() & SR1_WEL) > 0U;
+    return is_write_enabled == shouldEnable;
 }
 
-// TODO: add return type
-void SpiFlash::eraseChip()
+SpiFlash::Result SpiFlash::eraseChip()
 {
-    writeEnable(true);
-
-    uint32_t timeout{long_delay_duration_ms};
-    while(isBusy() && timeout > 0)
+    // the chip doesn't accept another erase while one is suspended
+    if(_is_erase_suspended)
     {
-        _delay(short_delay_duration_ms);
-        --timeout;
+        return Result::ERROR_BUSY;
     }
-    if(timeout == 0)
+    auto& stats = statistics(Command::ERASE_CHIP);
+    ensureAwake();
+    if(!waitWhileBusy(stats))
     {
-        return;
+        return Result::ERROR_TIMEOUT;
+    }
+    if(!writeEnable(true))
+    {
+        NRF_LOG_ERROR("flash: write enable has failed");
+        return Result::ERROR_GENERAL;
     }
 
+    // chip erase takes up to minutes, so the durations are limited to fit into 32 bits
+    const uint64_t typical_us = static_cast<uint64_t>(_erase_timing.get(EraseType::CHIP)) * 1000;
+    const uint64_t max_us = typical_us * _busy_timing.erase_max_multiplier;
     _isSpiOperationPending = true;
+    _is_write_in_progress = true;
+    expectBusy(static_cast<uint32_t>((typical_us < 0xFFFFFFFFULL) ? typical_us : 0xFFFFFFFFULL),
+               static_cast<uint32_t>((max_us < 0xFFFFFFFFULL) ? max_us : 0xFFFFFFFFULL));
 
     uint8_t tx_data[] = {0xC7};
     uint8_t rx_data[] = {0x0};
 
     _spi.xfer(tx_data, rx_data, 1, spiOperationCallback);
-    timeout = MAX_SPI_WAIT_TIMEOUT;
+    volatile uint32_t timeout = MAX_SPI_WAIT_TIMEOUT;
     while(_isSpiOperationPending && ((timeout--) > 0))
         ;
+    stats.count++;
+    stats.bytes += _geometry.total_size;
+    return Result::OK;
+}
+
+const SpiFlash::CommandStatistics& SpiFlash::getStatistics(const Command command) const
+{
+    return _statistics[static_cast<uint32_t>(command)];
 }
 
-void SpiFlash::spiOperationCallback(spi::Spi::Result result)
+void SpiFlash::resetStatistics()
 {
-    getInstance().completionCallback();
+    for(auto& stats : _statistics)
+    {
+        stats = CommandStatistics{};
+    }
+}
+
+bool SpiFlash::powerDownIfIdle(const uint32_t idle_ticks)
+{
+    if(_power_state == PowerState::POWER_DOWN)
+    {
+        return true;
+    }
+    if(_is_erase_in_progress || (_get_ticks() - _last_access_tick) < idle_ticks)
+    {
+        return false;
+    }
+    // the command is ignored while the chip is programming or erasing
+    if(isBusy())
+    {
+        return false;
+    }
+    sendCommand(_power_down_opcode);
+    _power_state = PowerState::POWER_DOWN;
+    _power_state_tick = _get_ticks();
+    _power_statistics.power_downs++;
+    return true;
+}
+
+void SpiFlash::wakeUp()
+{
+    if(_power_state != PowerState::POWER_DOWN)
+    {
+        return;
+    }
+    sendRelease();
+    _power_statistics.early_wake_ups++;
+}
+
+bool SpiFlash::isPoweredDown() const
+{
+    return _power_state == PowerState::POWER_DOWN;
+}
+
+SpiFlash::PowerStatistics SpiFlash::getPowerStatistics() const
+{
+    PowerStatistics result{_power_statistics};
+    const uint32_t now = _get_ticks();
+    if(_power_state == PowerState::POWER_DOWN)
+    {
+        result.power_down_ticks += now - _power_state_tick;
+    }
+    result.observed_ticks = now - _power_statistics_start_tick;
+    return result;
+}
+
+void SpiFlash::resetPowerStatistics()
+{
+    _power_statistics = PowerStatistics{};
+    _power_statistics_start_tick = _get_ticks();
+    if(_power_state == PowerState::POWER_DOWN)
+    {
+        _power_state_tick = _power_statistics_start_tick;
+    }
+}
+
+void SpiFlash::sendRelease()
+{
+    sendCommand(_release_opcode);
+    const uint32_t now = _get_ticks();
+    _power_statistics.power_down_ticks += now - _power_state_tick;
+    _power_state = PowerState::RELEASING;
+    _power_state_tick = now;
+}
+
+void SpiFlash::ensureAwake()
+{
+    _last_access_tick = _get_ticks();
+    if(_power_state == PowerState::STANDBY)
+    {
+        return;
+    }
+    if(_power_state == PowerState::POWER_DOWN)
+    {
+        sendRelease();
+    }
+    else if((_last_access_tick - _power_state_tick) > (_release_time_us / 1000) + 1)
+    {
+        // released ahead of the access, at least the release time has passed
+        _power_state = PowerState::STANDBY;
+        return;
+    }
+    // sub-tick delay, the release time is a few microseconds on most parts
+    nrf_delay_us(_release_time_us);
+    _power_statistics.late_wake_ups++;
+    _power_statistics.wake_wait_us += _release_time_us;
+    _power_state = PowerState::STANDBY;
+}
+
+void SpiFlash::expectBusy(const uint32_t typical_us, const uint32_t max_us)
+{
+    _busy_typical_us = typical_us;
+    _busy_max_us = max_us;
+    _busy_start_tick = _get_ticks();
+}
+
+bool SpiFlash::waitWhileBusy(CommandStatistics& stats)
+{
+    if(!isBusy())
+    {
+        return true;
+    }
+    const auto start_tick = _get_ticks();
+    // there is no point to ask the chip before the typical duration has passed, so the task sleeps
+    const uint32_t typical_ms = _busy_typical_us / 1000;
+    const uint32_t elapsed_ms = start_tick - _busy_start_tick;
+    if(elapsed_ms < typical_ms)
+    {
+        _delay(typical_ms - elapsed_ms);
+    }
+    // the end is expected shortly, so it's detected without waiting for the next tick.
+    // Page programs are shorter than a tick and mostly end here.
+    for(uint32_t i = 0; i < max_fine_status_polls && isBusy(); ++i)
+        ;
+    // the chip is late: it's asked once per tick till the maximal duration
+    const uint32_t max_ms = _busy_max_us / 1000 + 1;
+    const uint32_t waited_ms = _get_ticks() - _busy_start_tick;
+    uint32_t timeout{(waited_ms < max_ms) ? max_ms - waited_ms : 0};
+    while(isBusy() && timeout > 0)
+    {
+        _delay(short_delay_duration_ms);
+        --timeout;
+        stats.retries++;
+    }
+    stats.busy_wait_ticks += _get_ticks() - start_tick;
+    return !isBusy();
+}
+
+bool SpiFlash::waitForTransactionEnd(const uint32_t max_duration_ms, CommandStatistics& stats)
+{
+    const auto start_tick = _get_ticks();
+    if(_is_completion_signalling_enabled)
+    {
+        // signal might be left from a transaction that has been waited for by polling, so the state is re-checked
+        while(_isSpiOperationPending)
+        {
+            const uint32_t elapsed = _get_ticks() - start_tick;
+            if(elapsed >= max_duration_ms || !_wait_completion(max_duration_ms - elapsed))
+            {
+                break;
+            }
+        }
+        stats.busy_wait_ticks += _get_ticks() - start_tick;
+        return !_isSpiOperationPending;
+    }
+    uint32_t timeout{max_duration_ms};
+    while(_isSpiOperationPending && timeout > 0)
+    {
+        _delay(short_delay_duration_ms);
+        --timeout;
+    }
+    stats.busy_wait_ticks += _get_ticks() - start_tick;
+    return timeout > 0;
+}
+
+void SpiFlash::abandonTransaction()
+{
+    // the chip state is polled again by the next command, a late completion changes nothing
+    _isSpiOperationPending = false;
+    _context.operation = Operation::IDLE;
+}
+
+void SpiFlash::spiOperationCallback(spi::Spi::Result)
+{
+    auto& instance = getInstance();
+    instance.completionCallback();
     _isSpiOperationPending = false;
+    if(instance._is_completion_signalling_enabled)
+    {
+        instance._signal_completion();
+    }
 }
 
 void SpiFlash::completionCallback()
@@ -423,7 +1028,7 @@ void SpiFlash::completionCallback()
     switch(_context.operation)
     {
     case Operation::READ: {
-        memcpy(_context.data, &_rxBuffer[4], _context.size);
+        // data has been received directly into the destination buffer
         _context.operation = Operation::IDLE;
         break;
     }
@@ -4,6 +4,8 @@
  */
 #pragma once
 
+#include "erase_planner.h"
+#include "sfdp.h"
 #include "spi.h"
 #include "spi_flash_if.h"
 #include <functional>
@@ -17,7 +19,69 @@ class SpiFlash : public memory::SpiNorFlashIf
 public:
     using DelayFunction = std::function<void(uint32_t)>;
     using TickFunction = std::function<uint32_t(void)>;
+    /// Blocks until the completion is signalled or the timeout (in ticks) expires, returns false on timeout
+    using WaitCompletionFunction = std::function<bool(uint32_t)>;
+    /// Called from the SPI interrupt at the end of every transaction
+    using SignalCompletionFunction = void (*)();
     using Result = memory::SpiNorFlashIf::Result;
+
+    /// Flash commands, for which access statistics are collected
+    enum class Command
+    {
+        READ,
+        PROGRAM,
+        ERASE_SECTOR,
+        ERASE_64K_BLOCK,
+        ERASE_CHIP,
+        ERASE_SUSPEND,
+        ERASE_32K_BLOCK,
+        COUNT,
+    };
+
+    struct CommandStatistics
+    {
+        uint32_t count{0};
+        uint32_t bytes{0};
+        /// RTOS ticks spent waiting for the chip or for the SPI transaction to complete
+        uint32_t busy_wait_ticks{0};
+        /// Tick-long delays, while the chip has stayed busy with a program or erase past its typical duration
+        uint32_t retries{0};
+    };
+
+    /// Durations of the commands that keep the chip busy, from the datasheet or SFDP
+    struct BusyTiming
+    {
+        uint32_t page_program_typical_us;
+        uint32_t page_program_max_us;
+        /// maximal erase duration is this multiple of the typical one (see EraseTiming)
+        uint32_t erase_max_multiplier;
+    };
+    /// Datasheet values of the W25Q128JV
+    static constexpr BusyTiming default_busy_timing{400, 3000, 14};
+
+    struct PowerStatistics
+    {
+        uint32_t power_downs{0};
+        /// releases requested ahead of the use (see wakeUp())
+        uint32_t early_wake_ups{0};
+        /// accesses that had to wait for the chip to wake up: unpredicted ones or predicted too late
+        uint32_t late_wake_ups{0};
+        uint32_t wake_wait_us{0};
+        /// ticks spent in deep power-down, the rest of the observed time the chip has been in standby
+        uint32_t power_down_ticks{0};
+        /// ticks since the statistics reset
+        uint32_t observed_ticks{0};
+    };
+
+    /// Outcome of the last erase() call: duration estimated by the erase planner and the measured one
+    struct EraseReport
+    {
+        uint32_t size{0};
+        uint32_t commands_count{0};
+        uint32_t estimated_duration_ms{0};
+        uint32_t duration_ticks{0};
+    };
+
     explicit SpiFlash(spi::Spi& flashSpi, DelayFunction delay_function, TickFunction tick_function);
 
     SpiFlash() = delete;
@@ -30,26 +94,81 @@ public:
 
     void init();
 
+    /// @brief Let the transaction ends wake the caller up (f.e. through a semaphore) instead of polling
+    ///        the transaction state every tick. Polling is used until these functions are provided.
+    void setCompletionSignalling(WaitCompletionFunction wait_function, SignalCompletionFunction signal_function);
+    /// Switch between signalled and polled completion (signalling functions have to be set for the former)
+    void enableCompletionSignalling(bool is_enabled);
+    bool isCompletionSignallingEnabled() const;
+
     // Synchronous subset
     // ID has to be 8 bytes long
     void readJedecId(uint8_t* id);
     void reset();
 
+    /// @brief Discover the memory layout from SFDP basic parameters table, if the chip provides it,
+    ///        or from the capacity byte of JEDEC ID otherwise. Defaults are kept if both fail.
+    ///        Parts larger than 16 MB are accessed with 4-byte address commands, if they support them.
+    ///        Command durations (erase and page program timing) and the erase opcodes are taken from SFDP as well,
+    ///        if it provides them.
+    Geometry detectGeometry();
+    Geometry getGeometry() const override;
+    bool is4ByteAddressing() const;
+
     // Interface implementation
     SpiNorFlashIf::Result read(uint32_t address, uint8_t* data, uint32_t size) override;
+    /// Any amount of data can be programmed, it's split on the page boundaries
     SpiNorFlashIf::Result
     program(uint32_t address, const uint8_t* const data, uint32_t size) override;
+    /// Range is erased by the fastest mix of 4K, 32K, 64K and chip erases (see erase_planner.h)
     SpiNorFlashIf::Result erase(uint32_t address, uint32_t size) override;
 
-    // These 2 calls are asynchronous
+    // These calls are asynchronous
     Result eraseSector(uint32_t address);
-    void eraseChip();
+    Result eraseChip();
+    Result erase32KBlock(uint32_t address);
     SpiFlash::Result erase64KBlock(const uint32_t address);
 
+    /// Typical durations of the erase commands, used for planning of erase() calls
+    void setEraseTiming(const EraseTiming& timing);
+    const EraseTiming& getEraseTiming() const;
+    const EraseReport& getLastEraseReport() const;
+    /// Durations used for the waiting for the end of programs and erases
+    void setBusyTiming(const BusyTiming& timing);
+    const BusyTiming& getBusyTiming() const;
+
+    /// Chip is only asked for its status if a program or erase might still be in progress
     bool isBusy();
 
+    /// @brief Enter deep power-down, if no command has been sent to the chip for idle_ticks.
+    ///        It's skipped while a program or erase is in progress or suspended.
+    /// @return true if the chip is in deep power-down
+    bool powerDownIfIdle(uint32_t idle_ticks);
+    /// @brief Release the chip from deep power-down ahead of a predicted access, without waiting for the release.
+    ///        Otherwise the first access releases the chip and waits for it.
+    void wakeUp();
+    bool isPoweredDown() const;
+    PowerStatistics getPowerStatistics() const;
+    void resetPowerStatistics();
+
+    /// @brief Let reads and programs preempt an in-progress sector, 32K or 64K block erase: the erase is suspended
+    ///        for the time of the access and resumed afterwards. Areas that are being erased are not preempted.
+    void enableEraseSuspend(bool is_enabled);
+    bool isEraseSuspendEnabled() const;
+    /// true from the start of a sector/32K/64K block erase till its end, including the time it's suspended
+    bool isEraseInProgress() const;
+    bool isEraseInArea(uint32_t address, uint32_t size) const;
+    /// @return OK if the erase has been suspended, ERROR_INPUT if there is no erase to suspend,
+    ///         ERROR_TIMEOUT if the chip hasn't stopped (f.e. it doesn't support suspend)
+    Result suspendErase();
+    /// @return ERROR_INPUT if there is no suspended erase
+    Result resumeErase();
+
     uint8_t getSR1();
 
+    const CommandStatistics& getStatistics(Command command) const;
+    void resetStatistics();
+
     static inline SpiFlash& getInstance()
     {
         return *_instance;
@@ -59,14 +178,28 @@ private:
     spi::Spi& _spi;
     DelayFunction _delay;
     TickFunction _get_ticks;
+    WaitCompletionFunction _wait_completion;
+    SignalCompletionFunction _signal_completion{nullptr};
+    volatile bool _is_completion_signalling_enabled{false};
     static SpiFlash* _instance;
     static const size_t MAX_TRANSACTION_SIZE = 265;
     uint8_t _txBuffer[MAX_TRANSACTION_SIZE];
     uint8_t _rxBuffer[MAX_TRANSACTION_SIZE];
+    // second buffer for the page programming
+    uint8_t _stagingBuffer[MAX_TRANSACTION_SIZE];
     static const uint32_t SECTOR_SIZE = 0x1000;
+    static const uint32_t B32K_SIZE = 0x8000;
     static const uint32_t B64K_SIZE = 0x10000;
     static const uint32_t PAGE_SIZE = 0x100;
-    uint32_t _last_transaction_tick{0};
+    // limit of 3-byte addresses, larger parts need 4-byte address commands
+    static const uint32_t MAX_3_BYTE_ADDRESSABLE_SIZE = 0x1000000;
+    static const uint32_t DEFAULT_TOTAL_SIZE = 0x1000000;
+    Geometry _geometry{PAGE_SIZE, SECTOR_SIZE, DEFAULT_TOTAL_SIZE};
+    bool _is_4_byte_addressing{false};
+
+    bool readSfdp(uint32_t address, uint8_t* data, uint32_t size);
+    /// @param is_4_byte_address_supported is set if the part accepts 4-byte addresses
+    bool detectGeometryFromSfdp(Geometry& geometry, bool& is_4_byte_address_supported);
 
     static void spiOperationCallback(spi::Spi::Result result);
     static volatile bool _isSpiOperationPending;
@@ -88,14 +221,100 @@ private:
     };
 
     static constexpr uint32_t short_delay_duration_ms{1};
-    static constexpr uint32_t long_delay_duration_ms{200};
     static constexpr uint32_t max_wait_time_ms{5};
     static constexpr uint32_t max_read_transaction_time_ms{5};
+    // transaction timeout is extended by 1 ms per this amount of read bytes (~4x margin at 8 MHz)
+    static constexpr uint32_t min_read_bytes_per_ms{256};
     static constexpr uint32_t max_program_transaction_time_ms{10};
-    static constexpr uint32_t max_erase_duration_time_ms{2000};
+    // ~1 ms of back to back SR1 polls, done when a program or erase is expected to end
+    static constexpr uint32_t max_fine_status_polls{300};
+    // suspend latency is up to a few tens of microseconds
+    static constexpr uint32_t max_suspend_status_polls{100};
 
     Context _context;
-    void writeEnable(bool shouldEnable);
+
+    // SR1 bits
+    static constexpr uint8_t SR1_BUSY{0x01};
+    static constexpr uint8_t SR1_WEL{0x02};
+    // Set when a program/erase is issued, cleared when SR1 shows that it has been completed.
+    // Reads don't change the chip state, so commands that follow them don't have to poll SR1.
+    // Initially set, as an erase started before an MCU reset might still be running.
+    bool _is_write_in_progress{true};
+    bool _is_erase_suspend_enabled{false};
+    bool _is_erase_in_progress{false};
+    bool _is_erase_suspended{false};
+    uint32_t _erase_address{0};
+    uint32_t _erase_size{0};
+    // erase shall make progress between a resume and the next suspend
+    uint32_t _last_resume_tick{0};
+    EraseTiming _erase_timing{default_erase_timing};
+    // 3-byte address opcodes of 4K, 32K and 64K erases (indexed by EraseType), SFDP may override them
+    uint8_t _erase_opcodes[3]{0x20, 0x52, 0xD8};
+    // deep power-down commands and tRES1 of the W25Q128JV, SFDP may override them
+    uint8_t _power_down_opcode{0xB9};
+    uint8_t _release_opcode{0xAB};
+    uint32_t _release_time_us{3};
+    enum class PowerState
+    {
+        STANDBY,
+        POWER_DOWN,
+        // release command has been sent, the chip might not accept commands yet
+        RELEASING,
+    };
+    PowerState _power_state{PowerState::STANDBY};
+    uint32_t _power_state_tick{0};
+    // tick of the last command sent to the chip, for the idle timeout
+    uint32_t _last_access_tick{0};
+    uint32_t _power_statistics_start_tick{0};
+    PowerStatistics _power_statistics;
+    EraseReport _last_erase_report;
+    BusyTiming _busy_timing{default_busy_timing};
+    // Expected duration of the last program/erase that has been issued (or resumed), counted from _busy_start_tick.
+    // Initially only a short wait is allowed for an operation started before an MCU reset.
+    uint32_t _busy_typical_us{0};
+    uint32_t _busy_max_us{max_wait_time_ms * 1000};
+    uint32_t _busy_start_tick{0};
+    uint32_t _erase_max_us{0};
+
+    /// @return true if WEL has been set (or cleared, if it's disabled)
+    bool writeEnable(bool shouldEnable);
+
+    CommandStatistics _statistics[static_cast<uint32_t>(Command::COUNT)];
+    CommandStatistics& statistics(Command command)
+    {
+        return _statistics[static_cast<uint32_t>(command)];
+    }
+    /// Record the start of a program/erase and its expected duration
+    void expectBusy(uint32_t typical_us, uint32_t max_us);
+    /// @brief Sleep through the typical duration of the current program/erase, then poll SR1 back to back
+    ///        for a short time, then once per tick till the maximal duration.
+    /// @return false if the chip hasn't become ready within the maximal duration
+    bool waitWhileBusy(CommandStatistics& stats);
+    /// @return false if the transaction hasn't ended within the given time
+    bool waitForTransactionEnd(uint32_t max_duration_ms, CommandStatistics& stats);
+    /// @brief Stop waiting for a transaction that hasn't ended in time, so the following commands
+    ///        (f.e. the resume of a suspended erase) are not blocked by it
+    void abandonTransaction();
+    /// @return true if an erase has been suspended for the access to the given area
+    bool preemptErase(uint32_t address, uint32_t size);
+    Result
+    startErase(uint8_t opcode, uint8_t opcode_4_byte, EraseType type, uint32_t address, CommandStatistics& stats);
+    /// @brief issue a single erase command of the plan and wait for its completion
+    Result runEraseCommand(EraseType type, uint32_t address);
+    void sendCommand(uint8_t opcode);
+    /// @brief Called before each command: release the chip from deep power-down or wait for the end of the release
+    void ensureAwake();
+    void sendRelease();
+    /// @brief Fill in the opcode and the address of a command, the opcode depends on the address length
+    /// @return size of the command header
+    uint32_t setCommandHeader(uint8_t* buffer, uint8_t opcode, uint8_t opcode_4_byte, uint32_t address) const;
+    uint32_t getCommandHeaderSize() const
+    {
+        return _is_4_byte_addressing ? 5 : 4;
+    }
+    /// @brief Prepare page program command for the part of data that fits into the page at address
+    /// @return size of the staged part (command header is not included)
+    uint32_t stagePage(uint8_t* buffer, uint32_t address, const uint8_t* data, uint32_t size);
 };
 
 } // namespace flash
\ No newline at end of file
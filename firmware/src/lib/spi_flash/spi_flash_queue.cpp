@@ -0,0 +1,185 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "spi_flash_queue.h"
+
+namespace flash
+{
+
+SpiFlashQueue::SpiFlashQueue(SpiFlash& flash)
+    : _flash(flash)
+{ }
+
+SpiFlashQueue::Result SpiFlashQueue::submit(const Request& request)
+{
+    if(request.type != Request::Type::ERASE && (request.data == nullptr || request.size == 0))
+    {
+        return Result::ERROR_INPUT;
+    }
+    if(request.type == Request::Type::ERASE &&
+       ((request.address % sector_size) != 0 || (request.size % sector_size) != 0 || request.size == 0))
+    {
+        return Result::ERROR_ALIGNMENT;
+    }
+    if(_count == max_requests)
+    {
+        return Result::ERROR_BUSY;
+    }
+    _requests[(_head + _count) % max_requests] = request;
+    ++_count;
+    return Result::OK;
+}
+
+bool SpiFlashQueue::process()
+{
+    // requests that don't leave the chip busy are completed in the same call, so the bound is the queue size
+    for(size_t i = 0; i < max_requests && _count > 0; ++i)
+    {
+        Request& request = _requests[_head];
+        if(_state == State::IDLE)
+        {
+            const auto start_result = start(request);
+            if(start_result != Result::OK)
+            {
+                complete(start_result);
+                continue;
+            }
+            if(_state == State::IDLE)
+            {
+                complete(Result::OK);
+                continue;
+            }
+        }
+
+        // program or erase command is being executed by the chip
+        if(_flash.isBusy())
+        {
+            if(request.type == Request::Type::ERASE && runPreempting(request))
+            {
+                continue;
+            }
+            return true;
+        }
+        if(request.type == Request::Type::ERASE && _erase_position < request.address + request.size)
+        {
+            const auto erase_result = eraseNextBlock(request);
+            if(erase_result != Result::OK)
+            {
+                complete(erase_result);
+                continue;
+            }
+            return true;
+        }
+        complete(Result::OK);
+    }
+    return _count > 0;
+}
+
+SpiFlashQueue::Result SpiFlashQueue::start(Request& request)
+{
+    switch(request.type)
+    {
+    case Request::Type::READ: {
+        return _flash.read(request.address, request.data, request.size);
+    }
+    case Request::Type::PROGRAM: {
+        // returns when the last page has been sent, the chip is still programming it
+        const auto program_result = _flash.program(request.address, request.data, request.size);
+        if(program_result == Result::OK)
+        {
+            _state = State::WAITING_FOR_CHIP;
+        }
+        return program_result;
+    }
+    case Request::Type::ERASE: {
+        _erase_position = request.address;
+        return eraseNextBlock(request);
+    }
+    }
+    return Result::ERROR_INPUT;
+}
+
+SpiFlashQueue::Result SpiFlashQueue::eraseNextBlock(const Request& request)
+{
+    // the next command is the first one of the fastest plan for the rest of the range.
+    // Chip erase is not planned, as it can't be suspended for the following requests.
+    EraseTiming timing{_flash.getEraseTiming()};
+    timing.duration_ms[static_cast<uint32_t>(EraseType::CHIP)] = 0;
+    const uint32_t device_size = _flash.getGeometry().total_size;
+    ErasePlan plan;
+    if(!plan_erase(_erase_position, request.address + request.size - _erase_position, device_size, timing, plan))
+    {
+        return Result::ERROR_INPUT;
+    }
+    const EraseType type = plan.steps[0].type;
+    Result erase_result{Result::ERROR_GENERAL};
+    switch(type)
+    {
+    case EraseType::BLOCK_64K: {
+        erase_result = _flash.erase64KBlock(_erase_position);
+        break;
+    }
+    case EraseType::BLOCK_32K: {
+        erase_result = _flash.erase32KBlock(_erase_position);
+        break;
+    }
+    default: {
+        erase_result = _flash.eraseSector(_erase_position);
+        break;
+    }
+    }
+    if(erase_result == Result::OK)
+    {
+        _erase_position += get_erase_size(type, device_size);
+        _state = State::WAITING_FOR_CHIP;
+    }
+    return erase_result;
+}
+
+bool SpiFlashQueue::runPreempting(const Request& erase)
+{
+    if(!_flash.isEraseSuspendEnabled() || _count < 2)
+    {
+        return false;
+    }
+    // only the request that directly follows the erase is taken, so the order of the rest is kept
+    const Request request = _requests[(_head + 1) % max_requests];
+    const bool is_overlapping =
+        (request.address < erase.address + erase.size) && (erase.address < request.address + request.size);
+    if(request.type == Request::Type::ERASE || is_overlapping)
+    {
+        return false;
+    }
+    for(size_t i = 1; i + 1 < _count; ++i)
+    {
+        _requests[(_head + i) % max_requests] = _requests[(_head + i + 1) % max_requests];
+    }
+    --_count;
+
+    // flash suspends the erase for the time of the access and resumes it afterwards
+    const Result result = (request.type == Request::Type::READ)
+                              ? _flash.read(request.address, request.data, request.size)
+                              : _flash.program(request.address, request.data, request.size);
+    if(request.callback != nullptr)
+    {
+        request.callback(result, request.context);
+    }
+    return true;
+}
+
+void SpiFlashQueue::complete(const Result result)
+{
+    // request is removed before the callback, so the callback can submit the next one
+    const Request request = _requests[_head];
+    _head = (_head + 1) % max_requests;
+    --_count;
+    _state = State::IDLE;
+    if(request.callback != nullptr)
+    {
+        request.callback(result, request.context);
+    }
+}
+
+} // namespace flash
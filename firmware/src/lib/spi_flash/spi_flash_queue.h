@@ -0,0 +1,91 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "spi_flash.h"
+#include <cstddef>
+#include <stdint.h>
+
+namespace flash
+{
+
+/// Queue of flash operations, executed by a state machine that never waits for the chip.
+/// Reads are executed at bus speed right away, while programs and erases are only issued:
+/// their completion is detected by the following process() calls, so the owner can do other
+/// work in between (f.e. prepare the next data block). Callbacks are called from process().
+/// If erase suspend is enabled in the flash, a read or program that follows an erase request is executed
+/// while the erase is in progress (unless it accesses the erased area), so it's not delayed by the erase.
+/// submit() and process() shall be called from the same task.
+class SpiFlashQueue
+{
+public:
+    using Result = SpiFlash::Result;
+    using CompletionCallback = void (*)(Result result, void* context);
+
+    struct Request
+    {
+        enum class Type
+        {
+            READ,
+            PROGRAM,
+            ERASE,
+        };
+        Type type;
+        uint32_t address;
+        /// destination of a read or source of a program, has to stay valid until the completion
+        uint8_t* data;
+        uint32_t size;
+        CompletionCallback callback;
+        void* context;
+    };
+
+    explicit SpiFlashQueue(SpiFlash& flash);
+
+    SpiFlashQueue() = delete;
+    SpiFlashQueue(const SpiFlashQueue&) = delete;
+    SpiFlashQueue(SpiFlashQueue&&) = delete;
+    SpiFlashQueue& operator=(const SpiFlashQueue&) = delete;
+    SpiFlashQueue& operator=(SpiFlashQueue&&) = delete;
+    ~SpiFlashQueue() = default;
+
+    /// @return ERROR_BUSY if the queue is full, ERROR_INPUT/ERROR_ALIGNMENT for an invalid request
+    Result submit(const Request& request);
+
+    /// @brief advance the execution of the queued requests
+    /// @return true while there are unfinished requests
+    bool process();
+
+    size_t getPendingCount() const
+    {
+        return _count;
+    }
+
+    static constexpr size_t max_requests{8};
+
+private:
+    enum class State
+    {
+        IDLE,
+        WAITING_FOR_CHIP,
+    };
+
+    SpiFlash& _flash;
+    Request _requests[max_requests];
+    size_t _head{0};
+    size_t _count{0};
+    State _state{State::IDLE};
+    // next address to be erased by the current erase request
+    uint32_t _erase_position{0};
+
+    Result start(Request& request);
+    Result eraseNextBlock(const Request& request);
+    /// @return true if the request that follows the erase has been executed
+    bool runPreempting(const Request& erase);
+    void complete(Result result);
+
+    static constexpr uint32_t sector_size{0x1000};
+};
+
+} // namespace flash
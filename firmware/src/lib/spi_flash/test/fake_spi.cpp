@@ -0,0 +1,196 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "fake_spi.h"
+#include "spi.h"
+
+#include <algorithm>
+
+namespace flash
+{
+namespace test
+{
+
+FakeChip fake_chip;
+
+constexpr uint32_t FakeChip::size;
+constexpr uint32_t FakeChip::program_busy_polls;
+constexpr uint32_t FakeChip::erase_busy_polls;
+
+static constexpr uint8_t SR1_BUSY{0x01};
+static constexpr uint8_t SR1_WEL{0x02};
+static constexpr uint32_t sector_size{0x1000};
+
+void FakeChip::reset()
+{
+    *this = FakeChip{};
+}
+
+void FakeChip::injectFault(const uint8_t opcode, const Fault new_fault)
+{
+    fault_opcode = opcode;
+    fault = new_fault;
+}
+
+bool FakeChip::isFaultTriggered(const uint8_t opcode, const Fault expected_fault)
+{
+    if(fault != expected_fault || fault_opcode != opcode)
+    {
+        return false;
+    }
+    fault = Fault::NONE;
+    return true;
+}
+
+uint32_t FakeChip::getAddress(const uint8_t* header)
+{
+    return ((header[1] << 16) | (header[2] << 8) | header[3]) % size;
+}
+
+bool FakeChip::execute(const uint8_t* tx, uint8_t* rx, const uint32_t tx_size)
+{
+    const uint8_t opcode = tx[0];
+    if(isFaultTriggered(opcode, Fault::NO_COMPLETION))
+    {
+        return false;
+    }
+    switch(opcode)
+    {
+    case 0x05: {
+        rx[1] = ((busy_polls_left > 0) ? SR1_BUSY : 0) | (is_write_enabled ? SR1_WEL : 0);
+        if(busy_polls_left > 0 && --busy_polls_left == 0)
+        {
+            is_erasing = false;
+        }
+        break;
+    }
+    case 0x06: is_write_enabled = true; break;
+    case 0x04: is_write_enabled = false; break;
+    case 0x02: {
+        if(!is_write_enabled || busy_polls_left > 0)
+        {
+            break;
+        }
+        const uint32_t address = getAddress(tx);
+        for(uint32_t i = 4; i < tx_size; ++i)
+        {
+            memory[address + i - 4] &= tx[i];
+        }
+        is_write_enabled = false;
+        busy_polls_left = program_busy_polls;
+        break;
+    }
+    case 0x20:
+    case 0x52:
+    case 0xD8: {
+        if(!is_write_enabled || busy_polls_left > 0 || is_erase_suspended)
+        {
+            break;
+        }
+        const uint32_t erase_size = (opcode == 0x20) ? sector_size : (opcode == 0x52) ? 0x8000 : 0x10000;
+        const uint32_t address = getAddress(tx) - (getAddress(tx) % erase_size);
+        std::fill(memory.begin() + address, memory.begin() + address + erase_size, 0xFF);
+        erase_commands.push_back(opcode);
+        is_write_enabled = false;
+        is_erasing = true;
+        busy_polls_left = erase_busy_polls;
+        break;
+    }
+    case 0x75: {
+        if(is_erasing && !is_erase_suspended)
+        {
+            is_erase_suspended = true;
+            suspended_busy_polls = busy_polls_left;
+            busy_polls_left = 0;
+            suspends_count++;
+        }
+        break;
+    }
+    case 0x7A: {
+        if(is_erase_suspended && busy_polls_left == 0)
+        {
+            is_erase_suspended = false;
+            busy_polls_left = suspended_busy_polls;
+            resumes_count++;
+        }
+        break;
+    }
+    default: break;
+    }
+    return true;
+}
+
+bool FakeChip::executeRead(const uint8_t* header, uint8_t* rx, const uint32_t rx_size)
+{
+    if(isFaultTriggered(header[0], Fault::NO_COMPLETION))
+    {
+        return false;
+    }
+    const uint32_t address = getAddress(header);
+    std::copy(memory.begin() + address, memory.begin() + address + rx_size, rx);
+    return true;
+}
+
+} // namespace test
+} // namespace flash
+
+// spi::Spi is replaced by the fake chip, transfers end immediately (in the caller's context)
+namespace spi
+{
+
+Spi* Spi::_instance{nullptr};
+
+Spi::Spi(const uint8_t instanceIdx, const uint16_t csId)
+    : _nrfSpiInstance{instanceIdx}
+    , _instanceIdx{instanceIdx}
+    , _csId{csId}
+{
+    _instance = this;
+}
+
+void Spi::init(const Configuration&) { }
+
+Spi::Result Spi::xfer(uint8_t* txData, uint8_t* rxData, const size_t size)
+{
+    return xfer(txData, rxData, size, emptyCallback);
+}
+
+Spi::Result Spi::xfer(uint8_t* txData, uint8_t* rxData, const size_t size, CompletionCallback callback)
+{
+    auto& chip = flash::test::fake_chip;
+    if(chip.fault == flash::test::FakeChip::Fault::XFER_ERROR && chip.fault_opcode == txData[0])
+    {
+        chip.fault = flash::test::FakeChip::Fault::NONE;
+        return Result::ERROR;
+    }
+    _statistics.transfers++;
+    if(chip.execute(txData, rxData, size))
+    {
+        callback(Result::OK);
+    }
+    return Result::OK;
+}
+
+Spi::Result
+Spi::xferRead(uint8_t* header, const size_t headerSize, uint8_t* rxData, const size_t rxSize, CompletionCallback callback)
+{
+    auto& chip = flash::test::fake_chip;
+    if(chip.fault == flash::test::FakeChip::Fault::XFER_ERROR && chip.fault_opcode == header[0])
+    {
+        chip.fault = flash::test::FakeChip::Fault::NONE;
+        return Result::ERROR;
+    }
+    (void)headerSize;
+    _statistics.transfers++;
+    if(chip.executeRead(header, rxData, rxSize))
+    {
+        callback(Result::OK);
+    }
+    return Result::OK;
+}
+
+void Spi::isr() { }
+
+} // namespace spi
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace flash
+{
+namespace test
+{
+
+/// NOR flash chip behind the SPI, as seen by the driver: status register, write enable (reset by each accepted
+/// program or erase), page program, 4K/32K/64K erases with suspend/resume and reads. Program and erase keep
+/// the chip busy for a number of status polls. Transfers of a selected command can be failed or left without the completion.
+struct FakeChip
+{
+    enum class Fault : uint8_t
+    {
+        NONE,
+        /// xfer is rejected by the SPI driver
+        XFER_ERROR,
+        /// transfer never ends (the completion callback is not called)
+        NO_COMPLETION,
+    };
+
+    static constexpr uint32_t size{1024 * 1024};
+    static constexpr uint32_t program_busy_polls{2};
+    static constexpr uint32_t erase_busy_polls{50};
+
+    std::vector<uint8_t> memory = std::vector<uint8_t>(size, 0xFF);
+    bool is_write_enabled{false};
+    uint32_t busy_polls_left{0};
+    bool is_erasing{false};
+    bool is_erase_suspended{false};
+    uint32_t suspended_busy_polls{0};
+    uint32_t suspends_count{0};
+    uint32_t resumes_count{0};
+    /// opcodes of the accepted erase commands
+    std::vector<uint8_t> erase_commands;
+
+    uint8_t fault_opcode{0};
+    Fault fault{Fault::NONE};
+
+    void reset();
+    void injectFault(uint8_t opcode, Fault fault);
+
+    /// @return false if the transfer has to be left without completion
+    bool execute(const uint8_t* tx, uint8_t* rx, uint32_t size);
+    bool executeRead(const uint8_t* header, uint8_t* rx, uint32_t size);
+
+private:
+    /// @return true if the fault is triggered by the command (once)
+    bool isFaultTriggered(uint8_t opcode, Fault fault);
+    static uint32_t getAddress(const uint8_t* header);
+};
+
+extern FakeChip fake_chip;
+
+} // namespace test
+} // namespace flash
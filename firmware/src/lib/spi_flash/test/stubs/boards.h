@@ -0,0 +1,8 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#define SPI_FLASH_RST_PIN 0
+#define SPI_FLASH_WP_PIN 1
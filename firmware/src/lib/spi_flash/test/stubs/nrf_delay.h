@@ -0,0 +1,9 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include <stdint.h>
+
+static inline void nrf_delay_us(uint32_t) { }
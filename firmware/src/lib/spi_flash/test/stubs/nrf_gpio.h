@@ -0,0 +1,10 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include <stdint.h>
+
+static inline void nrf_gpio_cfg_output(uint32_t) { }
+static inline void nrf_gpio_pin_set(uint32_t) { }
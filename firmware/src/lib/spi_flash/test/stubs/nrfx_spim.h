@@ -0,0 +1,31 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+// Host stand-in of the SPIM driver types, spi::Spi is implemented by the test (see fake_spi.cpp)
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPIM0_EASYDMA_MAXCNT_SIZE 16
+
+typedef struct
+{
+    uint8_t drv_inst_idx;
+} nrfx_spim_t;
+
+typedef enum
+{
+    NRF_SPIM_FREQ_8M,
+} nrf_spim_frequency_t;
+
+typedef enum
+{
+    NRF_SPIM_MODE_0,
+} nrf_spim_mode_t;
+
+typedef enum
+{
+    NRF_SPIM_BIT_ORDER_MSB_FIRST,
+} nrf_spim_bit_order_t;
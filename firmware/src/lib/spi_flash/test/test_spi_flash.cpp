@@ -0,0 +1,271 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "fake_spi.h"
+#include "spi_flash.h"
+#include "spi_flash_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace flash
+{
+namespace test
+{
+
+using Result = SpiFlash::Result;
+
+static uint32_t ticks{0};
+static spi::Spi flash_spi{0, 0};
+// driver is a singleton, so all the tests share the instance
+static SpiFlash spi_flash{
+    flash_spi, [](const uint32_t duration) { ticks += duration + 1; }, []() { return ticks; }};
+
+static constexpr uint32_t erased_sector{0x10000};
+static constexpr uint32_t accessed_address{0x20000};
+
+class SpiFlashTest : public ::testing::Test
+{
+protected:
+    std::vector<uint8_t> data = std::vector<uint8_t>(512, 0);
+
+    virtual void SetUp()
+    {
+        fake_chip.reset();
+        spi_flash.init();
+        spi_flash.enableEraseSuspend(true);
+        // leftovers of the previous test are cleared by the status poll of the idle chip
+        ASSERT_FALSE(spi_flash.isBusy());
+        for(uint32_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<uint8_t>(i * 7);
+            fake_chip.memory[accessed_address + i] = data[i];
+        }
+    }
+
+    void startErase()
+    {
+        ASSERT_EQ(Result::OK, spi_flash.eraseSector(erased_sector));
+        ASSERT_TRUE(fake_chip.is_erasing);
+    }
+
+    void expectEraseResumed()
+    {
+        EXPECT_EQ(1U, fake_chip.suspends_count);
+        EXPECT_EQ(1U, fake_chip.resumes_count);
+        EXPECT_FALSE(fake_chip.is_erase_suspended);
+        // the next erase is accepted as soon as the resumed one ends
+        EXPECT_EQ(Result::OK, spi_flash.eraseSector(erased_sector + 0x1000));
+    }
+};
+
+TEST_F(SpiFlashTest, ReadSuspendsAndResumesErase)
+{
+    startErase();
+    std::vector<uint8_t> read_data(data.size(), 0);
+    EXPECT_EQ(Result::OK, spi_flash.read(accessed_address, read_data.data(), read_data.size()));
+    EXPECT_EQ(data, read_data);
+    expectEraseResumed();
+}
+
+TEST_F(SpiFlashTest, ReadTransactionTimeoutResumesErase)
+{
+    startErase();
+    fake_chip.injectFault(0x03, FakeChip::Fault::NO_COMPLETION);
+    std::vector<uint8_t> read_data(data.size(), 0);
+    EXPECT_EQ(Result::ERROR_TIMEOUT, spi_flash.read(accessed_address, read_data.data(), read_data.size()));
+    expectEraseResumed();
+}
+
+TEST_F(SpiFlashTest, ReadXferErrorResumesErase)
+{
+    startErase();
+    fake_chip.injectFault(0x03, FakeChip::Fault::XFER_ERROR);
+    std::vector<uint8_t> read_data(data.size(), 0);
+    EXPECT_EQ(Result::ERROR_GENERAL, spi_flash.read(accessed_address, read_data.data(), read_data.size()));
+    expectEraseResumed();
+}
+
+TEST_F(SpiFlashTest, ProgramTransactionTimeoutResumesErase)
+{
+    startErase();
+    fake_chip.injectFault(0x02, FakeChip::Fault::NO_COMPLETION);
+    EXPECT_EQ(Result::ERROR_TIMEOUT, spi_flash.program(accessed_address + 0x1000, data.data(), data.size()));
+    expectEraseResumed();
+}
+
+TEST_F(SpiFlashTest, ProgramXferErrorResumesErase)
+{
+    startErase();
+    fake_chip.injectFault(0x02, FakeChip::Fault::XFER_ERROR);
+    EXPECT_EQ(Result::ERROR_GENERAL, spi_flash.program(accessed_address + 0x1000, data.data(), data.size()));
+    expectEraseResumed();
+}
+
+TEST_F(SpiFlashTest, EraseXferErrorIsReported)
+{
+    fake_chip.injectFault(0x20, FakeChip::Fault::XFER_ERROR);
+    EXPECT_EQ(Result::ERROR_GENERAL, spi_flash.eraseSector(erased_sector));
+    EXPECT_FALSE(fake_chip.is_erasing);
+    EXPECT_FALSE(spi_flash.isEraseInProgress());
+    startErase();
+}
+
+TEST_F(SpiFlashTest, WriteEnableErrorResumesErase)
+{
+    startErase();
+    fake_chip.injectFault(0x06, FakeChip::Fault::NO_COMPLETION);
+    EXPECT_EQ(Result::ERROR_GENERAL, spi_flash.program(accessed_address + 0x1000, data.data(), data.size()));
+    expectEraseResumed();
+}
+
+class SpiFlashQueueTest : public SpiFlashTest
+{
+protected:
+    using Request = SpiFlashQueue::Request;
+
+    SpiFlashQueue queue{spi_flash};
+    std::vector<uint8_t> read_data = std::vector<uint8_t>(512, 0);
+
+    // order of the completions, each request is named by its context
+    static std::vector<std::string> completions;
+    static void onCompletion(const Result result, void* context)
+    {
+        completions.push_back(std::string{static_cast<const char*>(context)} +
+                              ((result == Result::OK) ? "" : " failed"));
+    }
+
+    virtual void SetUp()
+    {
+        SpiFlashTest::SetUp();
+        completions.clear();
+    }
+
+    Request makeRequest(const Request::Type type, const uint32_t address, uint8_t* data, const uint32_t size,
+                        const char* name)
+    {
+        return Request{type, address, data, size, onCompletion, const_cast<char*>(name)};
+    }
+
+    void runToCompletion()
+    {
+        for(uint32_t i = 0; i < 10000 && queue.process(); ++i)
+            ;
+        ASSERT_EQ(0U, queue.getPendingCount());
+    }
+};
+
+std::vector<std::string> SpiFlashQueueTest::completions;
+
+TEST_F(SpiFlashQueueTest, EraseIsSplitIntoCommands)
+{
+    // 64K block followed by a sector
+    std::fill(fake_chip.memory.begin() + 0x10000, fake_chip.memory.begin() + 0x21001, 0x00);
+    ASSERT_EQ(Result::OK, queue.submit(makeRequest(Request::Type::ERASE, 0x10000, nullptr, 0x11000, "erase")));
+    runToCompletion();
+    EXPECT_EQ((std::vector<uint8_t>{0xD8, 0x20}), fake_chip.erase_commands);
+    EXPECT_EQ(std::vector<std::string>{"erase"}, completions);
+    for(uint32_t address = 0x10000; address < 0x21000; ++address)
+    {
+        ASSERT_EQ(0xFF, fake_chip.memory[address]);
+    }
+    EXPECT_EQ(0x00, fake_chip.memory[0x21000]);
+}
+
+TEST_F(SpiFlashQueueTest, ReadPreemptsErase)
+{
+    ASSERT_EQ(Result::OK, queue.submit(makeRequest(Request::Type::ERASE, erased_sector, nullptr, 0x1000, "erase")));
+    ASSERT_EQ(Result::OK,
+              queue.submit(makeRequest(
+                  Request::Type::READ, accessed_address, read_data.data(), read_data.size(), "read")));
+    EXPECT_TRUE(queue.process());
+    // read is served while the erase is suspended
+    EXPECT_EQ(std::vector<std::string>{"read"}, completions);
+    EXPECT_EQ(data, read_data);
+    EXPECT_EQ(1U, fake_chip.suspends_count);
+    EXPECT_EQ(1U, fake_chip.resumes_count);
+    runToCompletion();
+    EXPECT_EQ((std::vector<std::string>{"read", "erase"}), completions);
+}
+
+TEST_F(SpiFlashQueueTest, ProgramPreemptsErase)
+{
+    ASSERT_EQ(Result::OK, queue.submit(makeRequest(Request::Type::ERASE, erased_sector, nullptr, 0x1000, "erase")));
+    ASSERT_EQ(Result::OK,
+              queue.submit(makeRequest(
+                  Request::Type::PROGRAM, accessed_address + 0x1000, data.data(), data.size(), "program")));
+    EXPECT_TRUE(queue.process());
+    EXPECT_EQ(std::vector<std::string>{"program"}, completions);
+    EXPECT_EQ(1U, fake_chip.suspends_count);
+    runToCompletion();
+    EXPECT_EQ((std::vector<std::string>{"program", "erase"}), completions);
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), fake_chip.memory.begin() + accessed_address + 0x1000));
+}
+
+TEST_F(SpiFlashQueueTest, OverlappingReadWaitsForErase)
+{
+    std::fill(fake_chip.memory.begin() + erased_sector, fake_chip.memory.begin() + erased_sector + 0x1000, 0x00);
+    ASSERT_EQ(Result::OK, queue.submit(makeRequest(Request::Type::ERASE, erased_sector, nullptr, 0x1000, "erase")));
+    ASSERT_EQ(Result::OK,
+              queue.submit(makeRequest(
+                  Request::Type::READ, erased_sector + 0x100, read_data.data(), read_data.size(), "read")));
+    EXPECT_TRUE(queue.process());
+    EXPECT_TRUE(completions.empty());
+    runToCompletion();
+    EXPECT_EQ(0U, fake_chip.suspends_count);
+    EXPECT_EQ((std::vector<std::string>{"erase", "read"}), completions);
+    EXPECT_EQ(std::vector<uint8_t>(read_data.size(), 0xFF), read_data);
+}
+
+TEST_F(SpiFlashQueueTest, FullQueueIsBusy)
+{
+    for(size_t i = 0; i < SpiFlashQueue::max_requests; ++i)
+    {
+        ASSERT_EQ(Result::OK,
+                  queue.submit(makeRequest(
+                      Request::Type::READ, accessed_address, read_data.data(), read_data.size(), "read")));
+    }
+    EXPECT_EQ(Result::ERROR_BUSY,
+              queue.submit(makeRequest(
+                  Request::Type::READ, accessed_address, read_data.data(), read_data.size(), "read")));
+    EXPECT_EQ(Result::ERROR_ALIGNMENT,
+              queue.submit(makeRequest(Request::Type::ERASE, erased_sector + 0x100, nullptr, 0x1000, "erase")));
+    // reads don't leave the chip busy, they are all completed by a single call
+    EXPECT_FALSE(queue.process());
+    EXPECT_EQ(static_cast<size_t>(SpiFlashQueue::max_requests), completions.size());
+}
+
+TEST_F(SpiFlashQueueTest, CallbackSubmitsNextRequest)
+{
+    struct Chain
+    {
+        SpiFlashQueue* queue;
+        uint8_t* data;
+        uint32_t size;
+    };
+    static Chain chain;
+    chain = Chain{&queue, read_data.data(), static_cast<uint32_t>(read_data.size())};
+    auto submit_read = [](const Result result, void*) {
+        completions.push_back((result == Result::OK) ? "program" : "program failed");
+        chain.queue->submit(Request{Request::Type::READ,
+                                    accessed_address + 0x1000,
+                                    chain.data,
+                                    chain.size,
+                                    onCompletion,
+                                    const_cast<char*>("read")});
+    };
+    ASSERT_EQ(Result::OK,
+              queue.submit(Request{
+                  Request::Type::PROGRAM, accessed_address + 0x1000, data.data(), static_cast<uint32_t>(data.size()),
+                  submit_read, nullptr}));
+    runToCompletion();
+    EXPECT_EQ((std::vector<std::string>{"program", "read"}), completions);
+    EXPECT_EQ(data, read_data);
+}
+
+} // namespace test
+} // namespace flash
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "simulated_flash.h"
+#include "verifying_flash.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace flash;
+using Result = memory::SpiNorFlashIf::Result;
+
+static constexpr memory::SpiNorFlashIf::Geometry geometry{256, 4096, 1024 * 1024};
+
+// Records the sequence of accesses to the simulated flash
+class RecordingFlash : public memory::SpiNorFlashIf
+{
+public:
+    Geometry getGeometry() const override
+    {
+        return geometry;
+    }
+
+    Result read(const uint32_t address, uint8_t* data, const uint32_t size) override
+    {
+        accesses.push_back("read " + std::to_string(address));
+        return simulated_flash.read(address, data, size);
+    }
+
+    Result program(const uint32_t address, const uint8_t* const data, const uint32_t size) override
+    {
+        accesses.push_back("program " + std::to_string(address));
+        return simulated_flash.program(address, data, size);
+    }
+
+    Result erase(const uint32_t address, const uint32_t size) override
+    {
+        return simulated_flash.erase(address, size);
+    }
+
+    SimulatedFlash simulated_flash{geometry};
+    std::vector<std::string> accesses;
+};
+
+class VerifyingFlashTest : public ::testing::Test
+{
+protected:
+    RecordingFlash flash;
+    VerifyingFlash verifying_flash{flash};
+    std::vector<uint8_t> data = std::vector<uint8_t>(1024, 0);
+
+    virtual void SetUp()
+    {
+        for(uint32_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<uint8_t>(i * 7);
+        }
+    }
+
+    std::vector<uint8_t> read(const uint32_t address, const uint32_t size)
+    {
+        std::vector<uint8_t> result(size, 0);
+        EXPECT_EQ(flash.simulated_flash.read(address, result.data(), size), Result::OK);
+        return result;
+    }
+};
+
+TEST_F(VerifyingFlashTest, ReadBackOfPageIsComparedWhileNextPageIsProgrammed)
+{
+    ASSERT_EQ(verifying_flash.program(0x80, data.data(), 512), Result::OK);
+    EXPECT_EQ(read(0x80, 512), std::vector<uint8_t>(data.begin(), data.begin() + 512));
+    EXPECT_EQ(verifying_flash.getStatistics().verified_pages, 3U);
+    EXPECT_EQ(verifying_flash.getStatistics().mismatches, 0U);
+
+    const std::vector<std::string> expected_accesses{
+        "program 128", "read 128", "program 256", "read 256", "program 512", "read 512"};
+    EXPECT_EQ(flash.accesses, expected_accesses);
+}
+
+TEST_F(VerifyingFlashTest, SilentlyTornPageIsProgrammedAgain)
+{
+    // second page program reports success, but only its first 100 bytes reach the array
+    flash.simulated_flash.injectFault({SimulatedFlash::Operation::PROGRAM, 1, Result::OK, 100});
+    ASSERT_EQ(verifying_flash.program(0, data.data(), 768), Result::OK);
+    EXPECT_EQ(read(0, 768), std::vector<uint8_t>(data.begin(), data.begin() + 768));
+
+    const auto& statistics = verifying_flash.getStatistics();
+    EXPECT_EQ(statistics.verified_pages, 3U);
+    EXPECT_EQ(statistics.mismatches, 1U);
+    EXPECT_EQ(statistics.retries, 1U);
+    EXPECT_EQ(statistics.failures, 0U);
+}
+
+TEST_F(VerifyingFlashTest, PageThatCannotBeProgrammedIsReported)
+{
+    // cleared bits can't be set by a program
+    std::vector<uint8_t> zeros(256, 0);
+    ASSERT_EQ(flash.simulated_flash.program(0x300, zeros.data(), zeros.size()), Result::OK);
+
+    EXPECT_EQ(verifying_flash.program(0x200, data.data(), 512), Result::ERROR_GENERAL);
+    const auto& statistics = verifying_flash.getStatistics();
+    EXPECT_EQ(statistics.mismatches, 1U);
+    EXPECT_EQ(statistics.retries, VerifyingFlash::default_max_retries);
+    EXPECT_EQ(statistics.failures, 1U);
+    EXPECT_EQ(statistics.last_failure_address, 0x300U);
+
+    verifying_flash.resetStatistics();
+    EXPECT_EQ(verifying_flash.getStatistics().failures, 0U);
+}
+
+TEST_F(VerifyingFlashTest, ProgramErrorIsPassedToTheCaller)
+{
+    flash.simulated_flash.injectFault({SimulatedFlash::Operation::PROGRAM, 0, Result::ERROR_TIMEOUT, 0});
+    EXPECT_EQ(verifying_flash.program(0, data.data(), 256), Result::ERROR_TIMEOUT);
+    EXPECT_EQ(verifying_flash.getStatistics().verified_pages, 0U);
+}
+
+TEST_F(VerifyingFlashTest, DisabledVerificationPassesProgramsThrough)
+{
+    verifying_flash.setEnabled(false);
+    flash.simulated_flash.injectFault({SimulatedFlash::Operation::PROGRAM, 0, Result::OK, 10});
+    EXPECT_EQ(verifying_flash.program(0, data.data(), 256), Result::OK);
+    EXPECT_EQ(flash.accesses, std::vector<std::string>{"program 0"});
+    EXPECT_EQ(verifying_flash.getStatistics().verified_pages, 0U);
+}
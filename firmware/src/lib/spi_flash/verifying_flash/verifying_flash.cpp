@@ -0,0 +1,112 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "verifying_flash.h"
+
+#include <string.h>
+
+namespace flash
+{
+
+constexpr uint32_t VerifyingFlash::max_page_size;
+constexpr uint32_t VerifyingFlash::default_max_retries;
+
+VerifyingFlash::Geometry VerifyingFlash::getGeometry() const
+{
+    return _flash.getGeometry();
+}
+
+VerifyingFlash::Result VerifyingFlash::read(const uint32_t address, uint8_t* data, const uint32_t size)
+{
+    return _flash.read(address, data, size);
+}
+
+VerifyingFlash::Result VerifyingFlash::erase(const uint32_t address, const uint32_t size)
+{
+    return _flash.erase(address, size);
+}
+
+VerifyingFlash::Result VerifyingFlash::program(const uint32_t address, const uint8_t* const data, const uint32_t size)
+{
+    if(!_is_enabled)
+    {
+        return _flash.program(address, data, size);
+    }
+    if(data == nullptr)
+    {
+        return Result::ERROR_INPUT;
+    }
+    const uint32_t flash_page_size = _flash.getGeometry().page_size;
+    const uint32_t page_size = (flash_page_size < max_page_size) ? flash_page_size : max_page_size;
+
+    // page that has been read back, but not compared yet
+    Page pending{0, nullptr, 0};
+    uint32_t position{0};
+    while(position < size)
+    {
+        const uint32_t current_address = address + position;
+        const uint32_t page_left = page_size - (current_address % page_size);
+        const uint32_t chunk_size = (size - position < page_left) ? size - position : page_left;
+        const auto program_result = _flash.program(current_address, &data[position], chunk_size);
+        if(program_result != Result::OK)
+        {
+            return program_result;
+        }
+        // chip is programming the current page at this point
+        if(pending.data != nullptr)
+        {
+            const auto check_result = checkPage(pending);
+            if(check_result != Result::OK)
+            {
+                return check_result;
+            }
+        }
+        const auto read_result = _flash.read(current_address, _readback, chunk_size);
+        if(read_result != Result::OK)
+        {
+            return read_result;
+        }
+        pending = Page{current_address, &data[position], chunk_size};
+        position += chunk_size;
+    }
+    if(pending.data != nullptr)
+    {
+        return checkPage(pending);
+    }
+    return Result::OK;
+}
+
+VerifyingFlash::Result VerifyingFlash::checkPage(const Page& page)
+{
+    _statistics.verified_pages++;
+    if(memcmp(_readback, page.data, page.size) == 0)
+    {
+        return Result::OK;
+    }
+    _statistics.mismatches++;
+    for(uint32_t retry = 0; retry < _max_retries; ++retry)
+    {
+        _statistics.retries++;
+        const auto program_result = _flash.program(page.address, page.data, page.size);
+        if(program_result != Result::OK)
+        {
+            return program_result;
+        }
+        const auto read_result = _flash.read(page.address, _readback, page.size);
+        if(read_result != Result::OK)
+        {
+            return read_result;
+        }
+        if(memcmp(_readback, page.data, page.size) == 0)
+        {
+            return Result::OK;
+        }
+    }
+    _statistics.failures++;
+    _statistics.last_failure_address = page.address;
+    return Result::ERROR_GENERAL;
+}
+
+} // namespace flash
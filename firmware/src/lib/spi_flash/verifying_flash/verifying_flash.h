@@ -0,0 +1,94 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "spi_flash_if.h"
+#include <stdint.h>
+
+namespace flash
+{
+
+/// Optional read-back verification of the programmed data, placed between the block device and the flash.
+/// Data is programmed page by page, each page is read back and compared with the source. Chip doesn't serve
+/// reads while it's programming, so the read-back of page N waits for its program to end, but the comparison
+/// of page N runs while the chip is already programming page N+1.
+/// Mismatching page is programmed once again (NOR program only clears bits, so the correctly programmed
+/// cells are not affected), failure is reported to the caller if it still mismatches after all retries.
+class VerifyingFlash : public memory::SpiNorFlashIf
+{
+public:
+    static constexpr uint32_t max_page_size{256};
+    static constexpr uint32_t default_max_retries{2};
+
+    struct Statistics
+    {
+        uint32_t verified_pages{0};
+        /// pages that haven't matched the source after the program
+        uint32_t mismatches{0};
+        /// repeated programs of the mismatching pages
+        uint32_t retries{0};
+        /// pages that haven't matched after all retries
+        uint32_t failures{0};
+        /// address of the last failed page
+        uint32_t last_failure_address{0};
+    };
+
+    explicit VerifyingFlash(memory::SpiNorFlashIf& flash, uint32_t max_retries = default_max_retries)
+        : _flash{flash}
+        , _max_retries{max_retries}
+    {
+    }
+
+    VerifyingFlash() = delete;
+    VerifyingFlash(const VerifyingFlash&) = delete;
+    VerifyingFlash(VerifyingFlash&&) = delete;
+    VerifyingFlash& operator=(const VerifyingFlash&) = delete;
+    VerifyingFlash& operator=(VerifyingFlash&&) = delete;
+    ~VerifyingFlash() = default;
+
+    Geometry getGeometry() const override;
+    Result read(uint32_t address, uint8_t* data, uint32_t size) override;
+    /// @return ERROR_GENERAL if a page doesn't match the data after all retries
+    Result program(uint32_t address, const uint8_t* const data, uint32_t size) override;
+    Result erase(uint32_t address, uint32_t size) override;
+
+    /// Programs are passed to the flash as they are, when the verification is disabled
+    void setEnabled(bool is_enabled)
+    {
+        _is_enabled = is_enabled;
+    }
+    bool isEnabled() const
+    {
+        return _is_enabled;
+    }
+
+    const Statistics& getStatistics() const
+    {
+        return _statistics;
+    }
+    void resetStatistics()
+    {
+        _statistics = Statistics{};
+    }
+
+private:
+    struct Page
+    {
+        uint32_t address;
+        const uint8_t* data;
+        uint32_t size;
+    };
+
+    memory::SpiNorFlashIf& _flash;
+    const uint32_t _max_retries;
+    bool _is_enabled{true};
+    uint8_t _readback[max_page_size];
+    Statistics _statistics;
+
+    /// @brief Compare the read-back page with its source, program and read it again on mismatch
+    Result checkPage(const Page& page);
+};
+
+} // namespace flash
@@ -31,20 +31,25 @@ public:
         , codec_(codec)
     { }
 
-    void init();
+    /// Called from the microphone interrupt, when a new sample is pending (f.e. to wake up the processing task)
+    using DataReadyNotification = void (*)();
+
+    void init(DataReadyNotification data_ready_notification = nullptr);
     void start();
     void stop();
 
-    // This function should be periodically called from the OS context.
-    // TODO: define minimal call period depending on sample size
-    CyclicCallStatus cyclic();
-
-    // TODO: replace this sample with after-codec one when it's available
-    CodecOutputSample& get_last_sample()
+    /// @return true if the microphone has collected a sample, that waits for cyclic()
+    bool is_sample_pending() const
     {
-        return processed_sample_;
+        return is_data_frame_pending_;
     }
 
+    // This function should be called from the OS context once per sample (see init()) or periodically.
+    /// @brief Encode the pending microphone sample. Microphone buffer is passed to the codec in place and
+    /// the codec writes the result directly to the output, so the sample is not copied on the way.
+    /// @param output location of the encoded sample (f.e. a slot of the data ring). nullptr drops the pending sample.
+    CyclicCallStatus cyclic(CodecOutputSample* output);
+
     AudioProcessor() = delete;
     AudioProcessor(AudioProcessor&) = delete;
     AudioProcessor(const AudioProcessor&) = delete;
@@ -53,11 +58,10 @@ public:
 
 private:
     Microphone<MicrophoneSample>& microphone_;
-    MicrophoneSample sample_;
-    CodecOutputSample processed_sample_;
     codec::Codec<MicrophoneSample, CodecOutputSample>& codec_;
     void microphone_data_ready_callback();
     volatile bool is_data_frame_pending_{false};
+    DataReadyNotification data_ready_notification_{nullptr};
 };
 
 } // namespace audio
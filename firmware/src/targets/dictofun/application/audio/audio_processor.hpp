@@ -8,8 +8,9 @@ namespace audio
 {
 
 template <typename MicrophoneSample, typename CodecOutputSample>
-void AudioProcessor<MicrophoneSample, CodecOutputSample>::init()
+void AudioProcessor<MicrophoneSample, CodecOutputSample>::init(const DataReadyNotification data_ready_notification)
 {
+    data_ready_notification_ = data_ready_notification;
     microphone_.init();
     microphone_.register_data_ready_callback(
         std::bind(&AudioProcessor<MicrophoneSample, CodecOutputSample>::microphone_data_ready_callback, this));
@@ -29,20 +30,27 @@ void AudioProcessor<MicrophoneSample, CodecOutputSample>::stop()
 }
 
 template <typename MicrophoneSample, typename CodecOutputSample>
-CyclicCallStatus AudioProcessor<MicrophoneSample, CodecOutputSample>::cyclic()
+CyclicCallStatus AudioProcessor<MicrophoneSample, CodecOutputSample>::cyclic(CodecOutputSample* output)
 {
     if (is_data_frame_pending_)
     {
         is_data_frame_pending_ = false;
-        const auto result = microphone_.get_samples(sample_);
-        if (result::Result::OK != result)
+        if (nullptr == output)
+        {
+            // buffer is not acquired, the microphone reuses it
+            return CyclicCallStatus::NO_ACTION;
+        }
+        auto* sample = microphone_.acquire_samples();
+        if (nullptr == sample)
         {
             // TODO: define an appropriate action
             // - early option: propagate the data to the application for the microphone operation check
             // - the good option: run the data through the codec and then push the compressed data to the application
             return CyclicCallStatus::ERROR;
         }
-        const auto processing_result = codec_.encode(sample_, processed_sample_);
+        // microphone doesn't reuse the buffer until it's released
+        const auto processing_result = codec_.encode(*sample, *output);
+        microphone_.release_samples();
         if (result::Result::OK != processing_result)
         {
             return CyclicCallStatus::ERROR;
@@ -57,6 +65,10 @@ template <typename MicrophoneSample, typename CodecOutputSample>
 void AudioProcessor<MicrophoneSample, CodecOutputSample>::microphone_data_ready_callback()
 {
     is_data_frame_pending_ = true;
+    if (nullptr != data_ready_notification_)
+    {
+        data_ready_notification_();
+    }
 }
 
 }
@@ -59,7 +59,8 @@ application::QueueDescriptor<audio::CommandQueueElement, 1>          audio_comma
 application::QueueDescriptor<audio::StatusQueueElement, 1>           audio_status_queue;
 application::QueueDescriptor<audio::tester::ControlQueueElement, 1>  audio_tester_commands_queue;
 
-application::QueueDescriptor<audio::CodecOutputType, 4>              audio_data_queue;
+// Lock-free, audio samples are written and consumed in place (see audio::data_ring_duration_ms)
+audio::DataRing                                                      audio_data_ring;
 
 application::QueueDescriptor<memory::CommandQueueElement, 1>         memory_commands_queue;
 application::QueueDescriptor<memory::StatusQueueElement, 1>          memory_status_queue; 
@@ -156,12 +157,6 @@ int main()
         APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
     }
 
-    const auto audio_data_init_result = audio_data_queue.init();
-    if(result::Result::OK != audio_data_init_result)
-    {
-        APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
-    }
-
     const auto audio_status_init_result = audio_status_queue.init();
     if(result::Result::OK != audio_status_init_result)
     {
@@ -287,7 +282,7 @@ int main()
     // Tasks' initialization
     audio_context.commands_queue = audio_commands_queue.handle;
     audio_context.status_queue = audio_status_queue.handle;
-    audio_context.data_queue = audio_data_queue.handle;
+    audio_context.data_ring = &audio_data_ring;
 
     const auto audio_task_init_result = audio_task.init(audio::task_audio, "AUDIO", &audio_context);
     if(result::Result::OK != audio_task_init_result)
@@ -295,7 +290,7 @@ int main()
         APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
     }
 
-    audio_tester_context.data_queue = audio_data_queue.handle;
+    audio_tester_context.data_ring = &audio_data_ring;
     audio_tester_context.commands_queue = audio_tester_commands_queue.handle;
 
     const auto audio_tester_task_init_result =
@@ -346,7 +341,7 @@ int main()
     memory_context.command_from_ble_queue = ble_to_mem_commands_queue.handle;
     memory_context.status_to_ble_queue = ble_from_mem_status_queue.handle;
     memory_context.data_to_ble_queue = ble_from_mem_data_queue.handle;
-    memory_context.audio_data_queue = audio_data_queue.handle;
+    memory_context.audio_data_ring = &audio_data_ring;
     memory_context.commands_to_rtc_queue = rtc_commands_queue.handle;
     memory_context.response_from_rtc_queue = rtc_response_queue.handle;
     const auto memory_task_init_result =
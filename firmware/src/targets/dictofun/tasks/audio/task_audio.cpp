@@ -11,6 +11,7 @@
 #include "task.h"
 
 #include "audio_processor.h"
+#include "cycle_counter.h"
 #include "codec_adpcm.h"
 #include "codec_decimate.h"
 #include "microphone_pdm.h"
@@ -20,10 +21,29 @@ namespace audio
 
 CommandQueueElement audio_command_buffer;
 constexpr TickType_t audio_command_wait_passive_ticks{10};
-constexpr TickType_t audio_command_wait_active_ticks{2};
+// While recording the task sleeps until the PDM interrupt notifies it about a new sample, commands are checked
+// after each sample. The timeout only covers a stalled microphone, it's 2 frames rounded up to the next tick.
+constexpr TickType_t audio_sample_wait_ticks{(2 * frame_duration_ms * configTICK_RATE_HZ + 999) / 1000};
+static_assert(audio_sample_wait_ticks * 1000 >= 2 * frame_duration_ms * configTICK_RATE_HZ,
+              "sample wait has to cover 2 frames");
+
+static TaskHandle_t audio_task_handle{nullptr};
+// cycle counter value at the last PDM notification
+static volatile uint32_t data_ready_cycles{0};
+
+// Time from the PDM interrupt to the encoded sample in the ring, collected over a record
+static struct SampleLatency
+{
+    uint32_t samples_count{0};
+    uint32_t max_cycles{0};
+    uint64_t total_cycles{0};
+    // wake-ups without a sample (notification wait timed out)
+    uint32_t wait_timeouts{0};
+} sample_latency;
 
 static uint32_t recorded_data_size{0};
-static uint32_t lost_data_size{0};
+// ring statistics are accumulated over the records, the drops of the current one are counted from this value
+static uint32_t dropped_samples_at_start{0};
 
 audio::microphone::PdmMicrophone<pdm_sample_size> pdm_mic{CONFIG_IO_PDM_CLK, CONFIG_IO_PDM_DATA};
 using MicrophoneOutputType = audio::microphone::PdmMicrophone<pdm_sample_size>::SampleType;
@@ -43,24 +63,43 @@ void microphone::isr_pdm_event_handler(const nrfx_pdm_evt_t* const p_evt)
     pdm_mic.pdm_event_handler(p_evt);
 }
 
+// Called from the PDM interrupt
+static void notify_audio_task()
+{
+    data_ready_cycles = common::CycleCounter::now();
+    BaseType_t is_higher_priority_task_woken{pdFALSE};
+    vTaskNotifyGiveFromISR(audio_task_handle, &is_higher_priority_task_woken);
+    portYIELD_FROM_ISR(is_higher_priority_task_woken);
+}
+
 void task_audio(void* context_ptr)
 {
     NRF_LOG_DEBUG("task audio: initialized");
     Context& context = *(reinterpret_cast<Context*>(context_ptr));
-    audio_processor.init();
+    audio_task_handle = xTaskGetCurrentTaskHandle();
+    common::CycleCounter::enable();
+    audio_processor.init(notify_audio_task);
     while(1)
     {
+        if(context.is_recording_active)
+        {
+            const auto notifications_count = ulTaskNotifyTake(pdTRUE, audio_sample_wait_ticks);
+            if(0 == notifications_count)
+            {
+                sample_latency.wait_timeouts++;
+            }
+        }
         const auto audio_queue_receive_status =
             xQueueReceive(context.commands_queue,
                           reinterpret_cast<void*>(&audio_command_buffer),
-                          ((context.is_recording_active) ? audio_command_wait_active_ticks
-                                                         : audio_command_wait_passive_ticks));
+                          ((context.is_recording_active) ? 0 : audio_command_wait_passive_ticks));
         if(pdPASS == audio_queue_receive_status)
         {
             if(audio_command_buffer.command_id == Command::RECORD_START)
             {
                 recorded_data_size = 0;
-                lost_data_size = 0;
+                sample_latency = SampleLatency{};
+                dropped_samples_at_start = context.data_ring->getStatistics().dropped;
                 NRF_LOG_INFO("audio: received record_start command");
                 audio_processor.start();
                 context.is_recording_active = true;
@@ -69,24 +108,46 @@ void task_audio(void* context_ptr)
             {
                 context.is_recording_active = false;
                 audio_processor.stop();
+                const auto ring_stats = context.data_ring->getStatistics();
+                // statistics could have been reset during the record
+                const auto dropped_samples = (ring_stats.dropped >= dropped_samples_at_start)
+                                                 ? ring_stats.dropped - dropped_samples_at_start
+                                                 : ring_stats.dropped;
                 NRF_LOG_INFO("audio: received record_stop command. recorded %d bytes, lost %d",
                              recorded_data_size,
-                             lost_data_size);
+                             dropped_samples * sizeof(CodecOutputType));
+                NRF_LOG_INFO("audio: data ring max fill %d of %d samples, %d PDM buffers overwritten",
+                             ring_stats.high_water,
+                             DataRing::capacity(),
+                             pdm_mic.get_lost_samples_count());
+                const auto average_latency_cycles = (sample_latency.samples_count > 0)
+                                                        ? sample_latency.total_cycles / sample_latency.samples_count
+                                                        : 0;
+                NRF_LOG_INFO("audio: PDM to ring latency avg %d us, max %d us, %d wait timeouts",
+                             common::CycleCounter::to_us(static_cast<uint32_t>(average_latency_cycles)),
+                             common::CycleCounter::to_us(sample_latency.max_cycles),
+                             sample_latency.wait_timeouts);
             }
         }
-        const auto cyclic_call_result = audio_processor.cyclic();
-        if(CyclicCallStatus::DATA_READY == cyclic_call_result)
+        if(audio_processor.is_sample_pending())
         {
-            auto& sample = audio_processor.get_last_sample();
-            // TODO: push this item to the data queue
-            const auto data_queue_send_result =
-                xQueueSend(context.data_queue, reinterpret_cast<void*>(sample.data), 0);
-            if(pdPASS != data_queue_send_result)
+            // codec writes the sample straight into the ring. If the ring is full, the slot is nullptr,
+            // the sample is dropped and counted by the ring.
+            // TODO: it may be needed to abort the whole record process here.
+            auto* slot = context.data_ring->acquire();
+            const auto cyclic_call_result = audio_processor.cyclic(slot);
+            if(CyclicCallStatus::DATA_READY == cyclic_call_result)
             {
-                // TODO: it may be needed to abort the whole record process here.
-                lost_data_size += sizeof(sample);
+                context.data_ring->commit();
+                recorded_data_size += sizeof(CodecOutputType);
+                const uint32_t latency_cycles = common::CycleCounter::now() - data_ready_cycles;
+                sample_latency.samples_count++;
+                sample_latency.total_cycles += latency_cycles;
+                if(latency_cycles > sample_latency.max_cycles)
+                {
+                    sample_latency.max_cycles = latency_cycles;
+                }
             }
-            recorded_data_size += sizeof(sample);
         }
     }
 }
@@ -10,6 +10,7 @@
 #include "FreeRTOS.h"
 #include "codec.h"
 #include "queue.h"
+#include "spsc_ring.h"
 
 namespace audio
 {
@@ -26,6 +27,12 @@ using CodecAdpcmOutputType = audio::codec::Sample<pdm_sample_size / adpcm_factor
 using CodecOutputType = CodecAdpcmOutputType;
 // using CodecOutputType = CodecDecimatorOutputType;
 
+// Each PDM buffer produces a single codec output sample. Buffer size is in bytes, PCM samples are 16-bit.
+constexpr uint32_t frame_duration_ms{(pdm_sample_size / sizeof(int16_t)) * 1000 / pdm_sampling_frequency};
+// Amount of audio, that can wait for the memory task (f.e. while it is busy with an erase)
+constexpr uint32_t data_ring_duration_ms{256};
+using DataRing = common::SpscRing<CodecOutputType, data_ring_duration_ms / frame_duration_ms>;
+
 /// @brief Function that implements audio task
 /// @param context_ptr pointer to struct Context, passed from the main.cpp
 void task_audio(void* context_ptr);
@@ -60,7 +67,8 @@ struct Context
     QueueHandle_t commands_queue{nullptr};
     QueueHandle_t status_queue{nullptr};
 
-    QueueHandle_t data_queue{nullptr};
+    /// Audio task is the producer, memory task (or audio tester) is the consumer
+    DataRing* data_ring{nullptr};
 };
 
 } // namespace audio
@@ -10,7 +10,7 @@ namespace audio
 namespace tester
 {
 
-float calculate_average(uint8_t* buffer, size_t size)
+float calculate_average(const uint8_t* buffer, size_t size)
 {
     int sum{0};
     for(size_t i = 0; i < size; ++i)
@@ -20,7 +20,7 @@ float calculate_average(uint8_t* buffer, size_t size)
     return sum / size;
 }
 
-float calculate_deviation(float average, uint8_t* buffer, size_t size)
+float calculate_deviation(float average, const uint8_t* buffer, size_t size)
 {
     float deviation_accum{0.0};
     for(size_t i = 0; i < size; ++i)
@@ -34,8 +34,6 @@ float calculate_deviation(float average, uint8_t* buffer, size_t size)
 void task_audio_tester(void* context_ptr)
 {
     Context& context{*(reinterpret_cast<Context*>(context_ptr))};
-    constexpr size_t buffer_size{128}; // TODO: derive this size from the application configuration
-    uint8_t buffer[buffer_size]{0};
     ControlQueueElement command;
 
     size_t received_samples_count{0};
@@ -47,14 +45,15 @@ void task_audio_tester(void* context_ptr)
     {
         if(is_tester_active)
         {
-            const auto data_result =
-                xQueueReceive(context.data_queue, reinterpret_cast<void*>(buffer), 2);
-            if(pdPASS == data_result)
+            // sample is processed in place and released afterwards
+            const auto* sample = context.data_ring->peek();
+            if(nullptr != sample)
             {
                 received_samples_count++;
-                last_sample_average = calculate_average(buffer, buffer_size);
+                last_sample_average = calculate_average(sample->data, sizeof(sample->data));
                 last_sample_deviation =
-                    calculate_deviation(last_sample_average, buffer, buffer_size);
+                    calculate_deviation(last_sample_average, sample->data, sizeof(sample->data));
+                context.data_ring->pop();
             }
         }
 
@@ -6,6 +6,7 @@
 
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "task_audio.h"
 
 namespace audio
 {
@@ -20,7 +21,8 @@ struct ControlQueueElement
 
 struct Context
 {
-    QueueHandle_t data_queue{nullptr};
+    /// Shared with the memory task, only one of them consumes the ring at a time (tester is active outside of records)
+    DataRing* data_ring{nullptr};
     QueueHandle_t commands_queue{nullptr};
 };
 
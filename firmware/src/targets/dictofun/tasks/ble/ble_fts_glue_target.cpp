@@ -9,6 +9,7 @@
 #include "nrf_log.h"
 #include "queue.h"
 #include "task_ble.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace ble::fts;
@@ -395,6 +396,62 @@ result::Result fs_status(FileSystemInterface::FSStatus& status)
     return result::Result::OK;
 }
 
+result::Result get_diagnostics(const uint8_t section,
+                               const bool should_reset,
+                               uint8_t* buffer,
+                               uint32_t& actual_size,
+                               const uint32_t max_size)
+{
+    if(!is_fs_communication_valid())
+    {
+        return result::Result::ERROR_GENERAL;
+    }
+    if(buffer == nullptr || max_size == 0)
+    {
+        return result::Result::ERROR_INVALID_PARAMETER;
+    }
+
+    xQueueReset(_data_from_fs_queue);
+
+    const uint32_t arg = (should_reset ? ble::diagnostics_reset_flag : 0UL) | section;
+    ble::CommandToMemoryQueueElement cmd{ble::CommandToMemory::GET_DIAGNOSTICS, 0, arg};
+    ble::StatusFromMemoryQueueElement response;
+
+    const auto cmd_result = xQueueSend(_command_to_fs_queue, &cmd, 0);
+    if(pdTRUE != cmd_result)
+    {
+        NRF_LOG_ERROR("diagnostics: failed to send cmd to mem");
+        return result::Result::ERROR_GENERAL;
+    }
+    const auto status_result =
+        xQueueReceive(_status_from_fs_queue, &response, max_status_wait_time);
+    if(pdTRUE != status_result)
+    {
+        NRF_LOG_ERROR("diagnostics: timed out recv status from mem");
+        return result::Result::ERROR_GENERAL;
+    }
+    if(response.status != ble::StatusFromMemory::OK)
+    {
+        NRF_LOG_ERROR("diagnostics: recv error status(%d)", static_cast<int>(response.status));
+        return result::Result::ERROR_GENERAL;
+    }
+
+    ble::FileDataFromMemoryQueueElement& data{data_from_memory_queue_element};
+    const auto data_result = xQueueReceive(_data_from_fs_queue, &data, max_short_data_wait_time);
+    if(pdTRUE != data_result)
+    {
+        NRF_LOG_ERROR("diagnostics: timed out recv data from mem");
+        return result::Result::ERROR_GENERAL;
+    }
+
+    ble::KeepaliveQueueElement keepalive{ble::KeepaliveEvent::FILESYSTEM_EVENT};
+    xQueueSend(_keepalive_queue, &keepalive, 0);
+
+    actual_size = std::min(data.size, max_size);
+    memcpy(buffer, data.data, actual_size);
+    return result::Result::OK;
+}
+
 void receive_completed()
 {
     if(!is_fs_communication_valid())
@@ -424,7 +481,8 @@ FileSystemInterface dictofun_fs_if{
     get_data,
     fs_status,
     get_files_list_next,
-    receive_completed
+    receive_completed,
+    get_diagnostics
 };
 
 } // namespace target
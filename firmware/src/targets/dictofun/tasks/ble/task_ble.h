@@ -75,14 +75,21 @@ enum class CommandToMemory
     GET_FS_STATUS,
     GET_FILES_LIST_NEXT,
     ALLOW_MEMORY_FORMATTING,
+    GET_DIAGNOSTICS,
 };
 
 struct CommandToMemoryQueueElement
 {
     CommandToMemory command_id;
     ble::fts::file_id_type file_id;
+    // command-specific argument (f.e. diagnostics section and reset flag)
+    uint32_t arg{0};
 };
 
+// GET_DIAGNOSTICS argument: bits 0..7 contain the section id, this flag requests counters' reset after readout
+constexpr uint32_t diagnostics_reset_flag{1UL << 8};
+constexpr uint32_t diagnostics_section_mask{0xFFUL};
+
 enum class StatusFromMemory
 {
     OK,
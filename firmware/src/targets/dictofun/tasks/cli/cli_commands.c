@@ -152,6 +152,16 @@ void register_memory_test_callback(memory_test_callback callback)
 /// Test 2: erase a sector in the end of flash memory (second from the end), write a page of data and read it back.
 ///         Print test status and duration afterwards
 /// Test 3: test file system: create a file, write data into it, close it, open it for read back and validate the content. 
+/// Test 5: print the content of the memory range (memtest 5 range_start range_end)
+/// Test 6: print I/O statistics of the file system and of the flash memory driver
+/// Test 7: reset I/O statistics
+/// Test 8: check integrity of the file system (memtest 8 [tail_check_limit 0]),
+///         tail check limit is amount of bytes after the last file that should be erased (0 - up to the end of flash)
+/// Test 9: measure per-operation latency of flash reads and programs with polled and with signalled completion,
+///         and program throughput with single-page and multi-page calls (uses the same area as test 2)
+/// Test 10: erase, program and read back the test 2 area through the asynchronous flash request queue
+/// Test 11: measure throughput (MB/s) and latency percentiles (us) of sequential and random reads of 16 B - 4 KB,
+///          single-page and 4 KB programs and of each erase command. Destroys the data in the last 64 KB of flash.
 static void cmd_test_memory(nrf_cli_t const * p_cli, const size_t argc, char ** argv)
 {
     if (2 != argc && 4 != argc)
@@ -167,7 +177,7 @@ static void cmd_test_memory(nrf_cli_t const * p_cli, const size_t argc, char **
         range_start = atoi(argv[2]);
         range_end = atoi(argv[3]);
     }
-    if (test_id < 1 || test_id > 5)
+    if (test_id < 1 || test_id > 11)
     {
         nrf_cli_fprintf(p_cli, NRF_CLI_ERROR, "Wrong test ID\n", argc);
         return;
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+
+#include "io_stats.h"
+
+#include "nrf_log.h"
+#include <cstring>
+
+namespace memory
+{
+namespace io_stats
+{
+
+using namespace ::filesystem;
+
+static constexpr uint32_t myfs_ops_count{static_cast<uint32_t>(myfs_op::COUNT)};
+static constexpr uint32_t flash_commands_count{
+    static_cast<uint32_t>(flash::SpiFlash::Command::COUNT)};
+
+static const char* myfs_op_names[myfs_ops_count]{
+    "format", "mount", "create", "write", "close", "read", "meta"};
+static const char* flash_command_names[flash_commands_count]{
+    "read", "program", "erase 4K", "erase 64K", "erase chip", "erase suspend", "erase 32K"};
+
+// section id, then all values of the section as uint32_t
+static constexpr uint32_t filesystem_section_size{
+    1 + (myfs_ops_count * sizeof(myfs_op_stats)) + 2 * sizeof(uint32_t)};
+static constexpr uint32_t flash_section_size{
+    1 + flash_commands_count * sizeof(flash::SpiFlash::CommandStatistics)};
+static constexpr uint32_t page_cache_section_size{1 + sizeof(flash::PageCache::Statistics)};
+static constexpr uint32_t program_verify_section_size{1 + sizeof(flash::VerifyingFlash::Statistics)};
+static constexpr uint32_t flash_power_section_size{1 + sizeof(flash::SpiFlash::PowerStatistics)};
+// ring statistics are followed by the ring capacity
+static constexpr uint32_t audio_ring_section_size{1 + sizeof(audio::DataRing::Statistics) + sizeof(uint32_t)};
+
+void print(const myfs_t& fs,
+           const flash::SpiFlash& flash,
+           const flash::PageCache& cache,
+           const flash::VerifyingFlash& verifier,
+           const audio::DataRing& ring)
+{
+    const auto& stats = myfs_get_io_stats(fs);
+    uint32_t total_bytes_programmed{0};
+    for(auto i = 0UL; i < myfs_ops_count; ++i)
+    {
+        const auto& op = stats.ops[i];
+        total_bytes_programmed += op.bytes_programmed;
+        NRF_LOG_INFO("%s: %d calls, rd %d, pr %d, er %d",
+                     myfs_op_names[i],
+                     op.calls,
+                     op.reads,
+                     op.programs,
+                     op.erases);
+        NRF_LOG_INFO("%s: rd %d B, pr %d B", myfs_op_names[i], op.bytes_read, op.bytes_programmed);
+    }
+    const auto& create_stats = stats.ops[static_cast<uint32_t>(myfs_op::CREATE)];
+    const auto& write_stats = stats.ops[static_cast<uint32_t>(myfs_op::WRITE)];
+    const auto& close_stats = stats.ops[static_cast<uint32_t>(myfs_op::CLOSE)];
+    const auto record_programs = create_stats.programs + write_stats.programs + close_stats.programs;
+    const auto write_amplification_pct =
+        (stats.user_bytes_written > 0) ? (total_bytes_programmed * 100) / stats.user_bytes_written : 0;
+    const auto programs_per_record =
+        (stats.records_closed > 0) ? record_programs / stats.records_closed : 0;
+    NRF_LOG_INFO("myfs: %d B written, %d records, WA %d%%, %d prog/record",
+                 stats.user_bytes_written,
+                 stats.records_closed,
+                 write_amplification_pct,
+                 programs_per_record);
+
+    for(auto i = 0UL; i < flash_commands_count; ++i)
+    {
+        const auto& cmd = flash.getStatistics(static_cast<flash::SpiFlash::Command>(i));
+        NRF_LOG_INFO("flash %s: %d cmds, %d B, wait %d ticks, %d retries",
+                     flash_command_names[i],
+                     cmd.count,
+                     cmd.bytes,
+                     cmd.busy_wait_ticks,
+                     cmd.retries);
+    }
+
+    const auto& cache_stats = cache.getStatistics();
+    NRF_LOG_INFO("page cache: %d hits, %d misses, %d bypassed, %d invalidated",
+                 cache_stats.hits,
+                 cache_stats.misses,
+                 cache_stats.bypassed,
+                 cache_stats.invalidations);
+
+    const auto& verify_stats = verifier.getStatistics();
+    NRF_LOG_INFO("program verify: %d pages, %d mismatches, %d retries, %d failures (last at 0x%x)",
+                 verify_stats.verified_pages,
+                 verify_stats.mismatches,
+                 verify_stats.retries,
+                 verify_stats.failures,
+                 verify_stats.last_failure_address);
+
+    const auto power_stats = flash.getPowerStatistics();
+    const auto power_down_pct =
+        (power_stats.observed_ticks > 0) ? (power_stats.power_down_ticks * 100ULL) / power_stats.observed_ticks : 0;
+    NRF_LOG_INFO("flash power: %d%% of %d ticks in deep power-down, %d power-downs",
+                 static_cast<uint32_t>(power_down_pct),
+                 power_stats.observed_ticks,
+                 power_stats.power_downs);
+    NRF_LOG_INFO("flash power: %d early wake-ups, %d late ones waited %d us",
+                 power_stats.early_wake_ups,
+                 power_stats.late_wake_ups,
+                 power_stats.wake_wait_us);
+
+    const auto ring_stats = ring.getStatistics();
+    NRF_LOG_INFO("audio ring: %d samples, %d dropped, max fill %d of %d",
+                 ring_stats.pushed,
+                 ring_stats.dropped,
+                 ring_stats.high_water,
+                 audio::DataRing::capacity());
+}
+
+void reset(myfs_t& fs,
+           flash::SpiFlash& flash,
+           flash::PageCache& cache,
+           flash::VerifyingFlash& verifier,
+           audio::DataRing& ring)
+{
+    myfs_reset_io_stats(fs);
+    flash.resetStatistics();
+    flash.resetPowerStatistics();
+    cache.resetStatistics();
+    verifier.resetStatistics();
+    ring.resetStatistics();
+}
+
+void reset(const Section section,
+           myfs_t& fs,
+           flash::SpiFlash& flash,
+           flash::PageCache& cache,
+           flash::VerifyingFlash& verifier,
+           audio::DataRing& ring)
+{
+    if(Section::FILESYSTEM == section)
+    {
+        myfs_reset_io_stats(fs);
+    }
+    else if(Section::FLASH == section)
+    {
+        flash.resetStatistics();
+    }
+    else if(Section::PAGE_CACHE == section)
+    {
+        cache.resetStatistics();
+    }
+    else if(Section::PROGRAM_VERIFY == section)
+    {
+        verifier.resetStatistics();
+    }
+    else if(Section::FLASH_POWER == section)
+    {
+        flash.resetPowerStatistics();
+    }
+    else if(Section::AUDIO_RING == section)
+    {
+        ring.resetStatistics();
+    }
+}
+
+static void append_value(uint8_t* buffer, uint32_t& position, const uint32_t value)
+{
+    memcpy(&buffer[position], &value, sizeof(value));
+    position += sizeof(value);
+}
+
+result::Result serialize(const Section section,
+                         const myfs_t& fs,
+                         const flash::SpiFlash& flash,
+                         const flash::PageCache& cache,
+                         const flash::VerifyingFlash& verifier,
+                         const audio::DataRing& ring,
+                         uint8_t* buffer,
+                         uint32_t& data_size_bytes,
+                         const uint32_t max_data_size)
+{
+    if(nullptr == buffer)
+    {
+        return result::Result::ERROR_INVALID_PARAMETER;
+    }
+    uint32_t position{0};
+    if(Section::FILESYSTEM == section)
+    {
+        if(max_data_size < filesystem_section_size)
+        {
+            return result::Result::ERROR_INVALID_PARAMETER;
+        }
+        const auto& stats = myfs_get_io_stats(fs);
+        buffer[position++] = static_cast<uint8_t>(section);
+        for(const auto& op : stats.ops)
+        {
+            append_value(buffer, position, op.calls);
+            append_value(buffer, position, op.reads);
+            append_value(buffer, position, op.programs);
+            append_value(buffer, position, op.erases);
+            append_value(buffer, position, op.bytes_read);
+            append_value(buffer, position, op.bytes_programmed);
+        }
+        append_value(buffer, position, stats.user_bytes_written);
+        append_value(buffer, position, stats.records_closed);
+    }
+    else if(Section::FLASH == section)
+    {
+        if(max_data_size < flash_section_size)
+        {
+            return result::Result::ERROR_INVALID_PARAMETER;
+        }
+        buffer[position++] = static_cast<uint8_t>(section);
+        for(auto i = 0UL; i < flash_commands_count; ++i)
+        {
+            const auto& cmd = flash.getStatistics(static_cast<flash::SpiFlash::Command>(i));
+            append_value(buffer, position, cmd.count);
+            append_value(buffer, position, cmd.bytes);
+            append_value(buffer, position, cmd.busy_wait_ticks);
+            append_value(buffer, position, cmd.retries);
+        }
+    }
+    else if(Section::PAGE_CACHE == section)
+    {
+        if(max_data_size < page_cache_section_size)
+        {
+            return result::Result::ERROR_INVALID_PARAMETER;
+        }
+        const auto& cache_stats = cache.getStatistics();
+        buffer[position++] = static_cast<uint8_t>(section);
+        append_value(buffer, position, cache_stats.hits);
+        append_value(buffer, position, cache_stats.misses);
+        append_value(buffer, position, cache_stats.bypassed);
+        append_value(buffer, position, cache_stats.invalidations);
+    }
+    else if(Section::PROGRAM_VERIFY == section)
+    {
+        if(max_data_size < program_verify_section_size)
+        {
+            return result::Result::ERROR_INVALID_PARAMETER;
+        }
+        const auto& verify_stats = verifier.getStatistics();
+        buffer[position++] = static_cast<uint8_t>(section);
+        append_value(buffer, position, verify_stats.verified_pages);
+        append_value(buffer, position, verify_stats.mismatches);
+        append_value(buffer, position, verify_stats.retries);
+        append_value(buffer, position, verify_stats.failures);
+        append_value(buffer, position, verify_stats.last_failure_address);
+    }
+    else if(Section::FLASH_POWER == section)
+    {
+        if(max_data_size < flash_power_section_size)
+        {
+            return result::Result::ERROR_INVALID_PARAMETER;
+        }
+        const auto power_stats = flash.getPowerStatistics();
+        buffer[position++] = static_cast<uint8_t>(section);
+        append_value(buffer, position, power_stats.power_downs);
+        append_value(buffer, position, power_stats.early_wake_ups);
+        append_value(buffer, position, power_stats.late_wake_ups);
+        append_value(buffer, position, power_stats.wake_wait_us);
+        append_value(buffer, position, power_stats.power_down_ticks);
+        append_value(buffer, position, power_stats.observed_ticks);
+    }
+    else if(Section::AUDIO_RING == section)
+    {
+        if(max_data_size < audio_ring_section_size)
+        {
+            return result::Result::ERROR_INVALID_PARAMETER;
+        }
+        const auto ring_stats = ring.getStatistics();
+        buffer[position++] = static_cast<uint8_t>(section);
+        append_value(buffer, position, ring_stats.pushed);
+        append_value(buffer, position, ring_stats.dropped);
+        append_value(buffer, position, ring_stats.high_water);
+        append_value(buffer, position, audio::DataRing::capacity());
+    }
+    else
+    {
+        return result::Result::ERROR_INVALID_PARAMETER;
+    }
+    data_size_bytes = position;
+    return result::Result::OK;
+}
+
+} // namespace io_stats
+} // namespace memory
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier:  Apache-2.0
+/*
+ * Copyright (c) 2023, Roman Turkin
+ */
+#pragma once
+
+#include "result.h"
+#include <stdint.h>
+
+#include "myfs.h"
+#include "page_cache.h"
+#include "spi_flash.h"
+#include "task_audio.h"
+#include "verifying_flash.h"
+
+namespace memory
+{
+namespace io_stats
+{
+
+/// Diagnostics are split into sections, so each of them fits into a single BLE transaction.
+/// Layout of each section is described in the FTS documentation (Diagnostics characteristic).
+enum class Section : uint8_t
+{
+    FILESYSTEM = 0,
+    FLASH = 1,
+    PAGE_CACHE = 2,
+    PROGRAM_VERIFY = 3,
+    FLASH_POWER = 4,
+    AUDIO_RING = 5,
+    COUNT,
+};
+
+void print(const ::filesystem::myfs_t& fs,
+           const flash::SpiFlash& flash,
+           const flash::PageCache& cache,
+           const flash::VerifyingFlash& verifier,
+           const audio::DataRing& ring);
+void reset(::filesystem::myfs_t& fs,
+           flash::SpiFlash& flash,
+           flash::PageCache& cache,
+           flash::VerifyingFlash& verifier,
+           audio::DataRing& ring);
+void reset(Section section,
+           ::filesystem::myfs_t& fs,
+           flash::SpiFlash& flash,
+           flash::PageCache& cache,
+           flash::VerifyingFlash& verifier,
+           audio::DataRing& ring);
+
+result::Result serialize(Section section,
+                         const ::filesystem::myfs_t& fs,
+                         const flash::SpiFlash& flash,
+                         const flash::PageCache& cache,
+                         const flash::VerifyingFlash& verifier,
+                         const audio::DataRing& ring,
+                         uint8_t* buffer,
+                         uint32_t& data_size_bytes,
+                         uint32_t max_data_size);
+
+} // namespace io_stats
+} // namespace memory
@@ -8,8 +8,11 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+#include "cycle_counter.h"
 #include "myfs_access.h"
 #include "nrf_log.h"
+#include "spi_flash_queue.h"
+#include "verifying_flash.h"
 
 namespace memory
 {
@@ -19,7 +22,11 @@ void launch_test_1(flash::SpiFlash& flash)
     NRF_LOG_INFO("task memory: launching chip erase. Memory task shall not accept commands during "
                  "the execution of this command.");
     const auto start_tick = xTaskGetTickCount();
-    flash.eraseChip();
+    if(flash.eraseChip() != memory::SpiNorFlashIf::Result::OK)
+    {
+        NRF_LOG_ERROR("task memory: chip erase has not been started");
+        return;
+    }
     static constexpr uint32_t max_chip_erase_duration{50000};
     while(flash.isBusy() && (xTaskGetTickCount() - start_tick) < max_chip_erase_duration)
     {
@@ -32,7 +39,9 @@ void launch_test_1(flash::SpiFlash& flash)
     }
     else
     {
-        NRF_LOG_INFO("task memory: chip erase took %d ms", end_tick - start_tick);
+        NRF_LOG_INFO("task memory: chip erase took %d ms (typical %d ms)",
+                     end_tick - start_tick,
+                     flash.getEraseTiming().get(flash::EraseType::CHIP));
     }
 }
 
@@ -40,10 +49,11 @@ void launch_test_2(flash::SpiFlash& flash)
 {
     NRF_LOG_INFO("task memory: launching read-program-read-erase-program test. \n"
                  "Memory task shall not accept commands during the execution of this command.");
-    constexpr uint32_t test_area_start_address{16 * 1024 * 1024 -
-                                               2 * 4096}; // second sector from the end.
+    const auto geometry = flash.getGeometry();
+    const uint32_t test_area_start_address{geometry.total_size -
+                                           2 * geometry.sector_size}; // second sector from the end.
     constexpr uint32_t test_data_size{256};
-    constexpr uint32_t test_erase_size{4096};
+    const uint32_t test_erase_size{geometry.sector_size};
     uint8_t test_data[test_data_size]{0};
 
     // ===== Step 1: read the current content of the memory
@@ -299,4 +309,417 @@ void launch_test_5(flash::SpiFlash& flash,const uint32_t range_start, const uint
     }
 }
 
+// average duration of a single operation, in microseconds
+static uint32_t ticks_to_us_per_op(const uint32_t ticks, const uint32_t ops_count)
+{
+    return (ops_count == 0) ? 0 : (ticks * (1000000UL / configTICK_RATE_HZ)) / ops_count;
+}
+
+static uint32_t throughput_bytes_per_s(const uint32_t bytes, const uint32_t ticks)
+{
+    return (ticks == 0) ? 0 : (bytes / ticks) * configTICK_RATE_HZ;
+}
+
+void launch_flash_benchmark(flash::SpiFlash& flash)
+{
+    NRF_LOG_INFO("memtest: flash latency benchmark (polled vs signalled completion). \n"
+                 "Memory task shall not accept commands during the execution of this command.");
+    const auto geometry = flash.getGeometry();
+    // same area as in test 2: second sector from the end
+    const uint32_t test_area_start_address{geometry.total_size - 2 * geometry.sector_size};
+    static constexpr uint32_t reads_count{256};
+    static constexpr uint32_t max_data_size{256};
+    static constexpr uint32_t multi_page_program_size{1024};
+    const uint32_t data_size{(geometry.page_size < max_data_size) ? geometry.page_size : max_data_size};
+    const uint32_t programs_count{geometry.sector_size / data_size};
+    uint8_t data[max_data_size];
+    for(uint32_t i = 0; i < max_data_size; ++i)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+
+    const bool was_signalling_enabled{flash.isCompletionSignallingEnabled()};
+    static constexpr bool completion_modes[]{false, true};
+    for(const bool is_signalled : completion_modes)
+    {
+        flash.enableCompletionSignalling(is_signalled);
+        if(is_signalled && !flash.isCompletionSignallingEnabled())
+        {
+            NRF_LOG_WARNING("memtest: completion signalling is not set up");
+            break;
+        }
+        const auto erase_res = flash.erase(test_area_start_address, geometry.sector_size);
+        if(memory::SpiNorFlashIf::Result::OK != erase_res)
+        {
+            NRF_LOG_ERROR("memtest: failed to erase the test area");
+            break;
+        }
+
+        const auto& read_stats = flash.getStatistics(flash::SpiFlash::Command::READ);
+        const uint32_t read_delays_before{read_stats.retries};
+        const auto read_start_tick{xTaskGetTickCount()};
+        for(uint32_t i = 0; i < reads_count; ++i)
+        {
+            flash.read(test_area_start_address, data, data_size);
+        }
+        const uint32_t read_ticks{xTaskGetTickCount() - read_start_tick};
+
+        const auto& program_stats = flash.getStatistics(flash::SpiFlash::Command::PROGRAM);
+        const uint32_t program_delays_before{program_stats.retries};
+        const auto program_start_tick{xTaskGetTickCount()};
+        for(uint32_t i = 0; i < programs_count; ++i)
+        {
+            flash.program(test_area_start_address + i * data_size, data, data_size);
+        }
+        const uint32_t program_ticks{xTaskGetTickCount() - program_start_tick};
+
+        NRF_LOG_INFO("%s: read %d us/op (%d delays)",
+                     is_signalled ? "signalled" : "polled",
+                     ticks_to_us_per_op(read_ticks, reads_count),
+                     read_stats.retries - read_delays_before);
+        NRF_LOG_INFO("%s: program %d us/op (%d delays)",
+                     is_signalled ? "signalled" : "polled",
+                     ticks_to_us_per_op(program_ticks, programs_count),
+                     program_stats.retries - program_delays_before);
+
+        // same sector once again, but several pages per program call
+        const auto multi_erase_res = flash.erase(test_area_start_address, geometry.sector_size);
+        if(memory::SpiNorFlashIf::Result::OK != multi_erase_res)
+        {
+            NRF_LOG_ERROR("memtest: failed to erase the test area");
+            break;
+        }
+        uint8_t multi_page_data[multi_page_program_size];
+        for(uint32_t i = 0; i < multi_page_program_size; ++i)
+        {
+            multi_page_data[i] = static_cast<uint8_t>(i);
+        }
+        const auto multi_program_start_tick{xTaskGetTickCount()};
+        for(uint32_t offset = 0; offset < geometry.sector_size; offset += multi_page_program_size)
+        {
+            flash.program(test_area_start_address + offset, multi_page_data, multi_page_program_size);
+        }
+        const uint32_t multi_program_ticks{xTaskGetTickCount() - multi_program_start_tick};
+        NRF_LOG_INFO("%s: program %d B/s by page, %d B/s by %d bytes",
+                     is_signalled ? "signalled" : "polled",
+                     throughput_bytes_per_s(programs_count * data_size, program_ticks),
+                     throughput_bytes_per_s(geometry.sector_size, multi_program_ticks),
+                     multi_page_program_size);
+
+        // header and data of a read are sent by separate DMA transactions, each of them ends with an interrupt
+        const auto& spi_stats = spi::Spi::getInstance().getStatistics();
+        const uint32_t interrupts_before{spi_stats.interrupts};
+        flash.read(test_area_start_address, multi_page_data, multi_page_program_size);
+        NRF_LOG_INFO("%s: %d SPI interrupts per %d B read",
+                     is_signalled ? "signalled" : "polled",
+                     spi_stats.interrupts - interrupts_before,
+                     multi_page_program_size);
+    }
+
+    // test area is left erased, as test 2 expects it
+    flash.erase(test_area_start_address, geometry.sector_size);
+    flash.enableCompletionSignalling(was_signalling_enabled);
+}
+
+struct QueueTestState
+{
+    uint32_t completed_count{0};
+    uint32_t failed_count{0};
+};
+
+static void queue_test_callback(const flash::SpiFlashQueue::Result result, void* context)
+{
+    auto& state = *reinterpret_cast<QueueTestState*>(context);
+    state.completed_count++;
+    if(result != flash::SpiFlashQueue::Result::OK)
+    {
+        state.failed_count++;
+    }
+}
+
+void launch_flash_queue_test(flash::SpiFlash& flash)
+{
+    NRF_LOG_INFO("memtest: queued erase-program-read of the test area. \n"
+                 "Memory task shall not accept commands during the execution of this command.");
+    const auto geometry = flash.getGeometry();
+    // same area as in test 2: second sector from the end
+    const uint32_t test_area_start_address{geometry.total_size - 2 * geometry.sector_size};
+    static constexpr uint32_t program_size{1024};
+    static constexpr uint32_t read_size{256};
+    uint8_t program_data[program_size];
+    uint8_t read_data[read_size]{0};
+    for(uint32_t i = 0; i < program_size; ++i)
+    {
+        program_data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    flash::SpiFlashQueue queue{flash};
+    QueueTestState state;
+    using Request = flash::SpiFlashQueue::Request;
+    uint32_t submitted_count{0};
+    const Request erase{
+        Request::Type::ERASE, test_area_start_address, nullptr, geometry.sector_size, queue_test_callback, &state};
+    submitted_count += (queue.submit(erase) == flash::SpiFlashQueue::Result::OK) ? 1 : 0;
+    for(uint32_t offset = 0; offset < geometry.sector_size; offset += program_size)
+    {
+        const Request program{Request::Type::PROGRAM,
+                              test_area_start_address + offset,
+                              program_data,
+                              program_size,
+                              queue_test_callback,
+                              &state};
+        submitted_count += (queue.submit(program) == flash::SpiFlashQueue::Result::OK) ? 1 : 0;
+    }
+    const Request read{
+        Request::Type::READ, test_area_start_address + program_size, read_data, read_size, queue_test_callback, &state};
+    submitted_count += (queue.submit(read) == flash::SpiFlashQueue::Result::OK) ? 1 : 0;
+
+    // CPU is free while the chip programs/erases: count how many process() calls have found it busy
+    const auto start_tick{xTaskGetTickCount()};
+    uint32_t busy_polls_count{0};
+    while(queue.process())
+    {
+        ++busy_polls_count;
+        if((xTaskGetTickCount() - start_tick) > 1000)
+        {
+            NRF_LOG_ERROR("memtest: queue has not been completed in time");
+            break;
+        }
+    }
+    const auto end_tick{xTaskGetTickCount()};
+
+    bool is_data_correct{true};
+    for(uint32_t i = 0; i < read_size; ++i)
+    {
+        is_data_correct = is_data_correct && (read_data[i] == program_data[i]);
+    }
+    NRF_LOG_INFO("queue: %d/%d requests done (%d failed) in %d ms",
+                 state.completed_count,
+                 submitted_count,
+                 state.failed_count,
+                 end_tick - start_tick);
+    NRF_LOG_INFO("queue: %d polls while busy, data %s", busy_polls_count, is_data_correct ? "OK" : "mismatch");
+
+    // test area is left erased, as test 2 expects it
+    flash.erase(test_area_start_address, geometry.sector_size);
+}
+
+// Latencies of a single benchmark case, sorted before the report
+struct LatencySamples
+{
+    static constexpr uint32_t max_count{32};
+    uint32_t us[max_count]{0};
+    uint32_t count{0};
+    uint32_t total_us{0};
+    uint32_t bytes{0};
+
+    void add(const uint32_t cycles, const uint32_t size)
+    {
+        const uint32_t duration_us{common::CycleCounter::to_us(cycles)};
+        if(count < max_count)
+        {
+            us[count++] = duration_us;
+        }
+        total_us += duration_us;
+        bytes += size;
+    }
+};
+
+static void report_latency(const char* name, const uint32_t size, LatencySamples& samples)
+{
+    if(samples.count == 0)
+    {
+        return;
+    }
+    // insertion sort, there are only a few samples
+    for(uint32_t i = 1; i < samples.count; ++i)
+    {
+        const uint32_t value{samples.us[i]};
+        uint32_t j{i};
+        for(; j > 0 && samples.us[j - 1] > value; --j)
+        {
+            samples.us[j] = samples.us[j - 1];
+        }
+        samples.us[j] = value;
+    }
+    // bytes per microsecond are megabytes per second
+    const uint32_t milli_mb_per_s = (samples.total_us == 0)
+                                        ? 0
+                                        : static_cast<uint32_t>((static_cast<uint64_t>(samples.bytes) * 1000) /
+                                                                samples.total_us);
+    NRF_LOG_INFO("%s %d B: %d.%03d MB/s", name, size, milli_mb_per_s / 1000, milli_mb_per_s % 1000);
+    NRF_LOG_INFO("%s %d B: p50 %d us, p90 %d us, max %d us",
+                 name,
+                 size,
+                 samples.us[samples.count / 2],
+                 samples.us[(samples.count * 9) / 10],
+                 samples.us[samples.count - 1]);
+}
+
+// Program/erase ends are detected with sub-tick resolution. Longer erases sleep through the most
+// of their typical duration, so other tasks are not starved.
+static void wait_while_busy(flash::SpiFlash& flash, const uint32_t typical_ms)
+{
+    if(typical_ms > 2)
+    {
+        vTaskDelay(typical_ms - typical_ms / 8);
+    }
+    while(flash.isBusy())
+        ;
+}
+
+static uint32_t next_random(uint32_t& state)
+{
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void launch_flash_throughput_benchmark(flash::SpiFlash& flash)
+{
+    NRF_LOG_INFO("memtest: flash throughput benchmark in the last 64 KB of the flash. \n"
+                 "Memory task shall not accept commands during the execution of this command.");
+    common::CycleCounter::enable();
+    const auto geometry = flash.getGeometry();
+    static constexpr uint32_t area_size{0x10000};
+    const uint32_t area_start{geometry.total_size - area_size};
+    static constexpr uint32_t max_data_size{4096};
+    static uint8_t data[max_data_size];
+    // the area is shared with the end of the FS data area, records written there (f.e. after a wrap of
+    // the format generations) would be destroyed behind the FS's back
+    for(uint32_t offset = 0; offset < area_size; offset += max_data_size)
+    {
+        if(flash.read(area_start + offset, data, max_data_size) != memory::SpiNorFlashIf::Result::OK)
+        {
+            NRF_LOG_ERROR("memtest: failed to read the benchmark area");
+            return;
+        }
+        for(uint32_t i = 0; i < max_data_size; ++i)
+        {
+            if(data[i] != 0xFF)
+            {
+                NRF_LOG_ERROR("memtest: benchmark area holds data at 0x%x. aborting, format the FS to run it",
+                              area_start + offset + i);
+                return;
+            }
+        }
+    }
+    for(uint32_t i = 0; i < max_data_size; ++i)
+    {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    const auto& erase_timing = flash.getEraseTiming();
+    if(flash.erase(area_start, area_size) != memory::SpiNorFlashIf::Result::OK)
+    {
+        NRF_LOG_ERROR("memtest: failed to erase the benchmark area");
+        return;
+    }
+
+    // ===== Reads: sequential ones continue each other, random ones start at arbitrary offsets of the area
+    static constexpr uint32_t read_sizes[]{16, 256, 4096};
+    uint32_t random_state{0x2545F491UL};
+    for(const uint32_t size : read_sizes)
+    {
+        LatencySamples sequential;
+        LatencySamples random;
+        for(uint32_t i = 0; i < LatencySamples::max_count; ++i)
+        {
+            const uint32_t sequential_address{area_start + (i * size) % (area_size - size + 1)};
+            uint32_t start{common::CycleCounter::now()};
+            flash.read(sequential_address, data, size);
+            sequential.add(common::CycleCounter::now() - start, size);
+
+            const uint32_t random_address{area_start + next_random(random_state) % (area_size - size + 1)};
+            start = common::CycleCounter::now();
+            flash.read(random_address, data, size);
+            random.add(common::CycleCounter::now() - start, size);
+        }
+        report_latency("seq read", size, sequential);
+        report_latency("rnd read", size, random);
+    }
+
+    // ===== Programs: single pages fill the first half of the area, 4K programs (several pages per call) the second.
+    // Then the same with the read-back verification, that the file system uses, to measure its overhead.
+    static constexpr uint32_t multi_page_size{4096};
+    const uint32_t page_size{geometry.page_size};
+    const uint32_t half_size{area_size / 2};
+    auto measure_programs = [&](memory::SpiNorFlashIf& target, const char* name) {
+        LatencySamples single_page;
+        for(uint32_t i = 0; i < LatencySamples::max_count && (i + 1) * page_size <= half_size; ++i)
+        {
+            const uint32_t start{common::CycleCounter::now()};
+            target.program(area_start + i * page_size, data, page_size);
+            wait_while_busy(flash, 0);
+            single_page.add(common::CycleCounter::now() - start, page_size);
+        }
+        report_latency(name, page_size, single_page);
+        LatencySamples multi_page;
+        for(uint32_t offset = half_size; offset < area_size; offset += multi_page_size)
+        {
+            const uint32_t start{common::CycleCounter::now()};
+            target.program(area_start + offset, data, multi_page_size);
+            wait_while_busy(flash, 0);
+            multi_page.add(common::CycleCounter::now() - start, multi_page_size);
+        }
+        report_latency(name, multi_page_size, multi_page);
+    };
+    measure_programs(flash, "program");
+    static flash::VerifyingFlash verifier{flash};
+    verifier.resetStatistics();
+    flash.erase(area_start, area_size);
+    measure_programs(verifier, "prog+vfy");
+    if(verifier.getStatistics().mismatches > 0)
+    {
+        NRF_LOG_ERROR("memtest: %d programmed pages haven't matched", verifier.getStatistics().mismatches);
+    }
+
+    // ===== Erases: each command separately (not through the planner), the area is programmed again between them
+    static constexpr uint32_t erases_count{4};
+    struct EraseCase
+    {
+        flash::EraseType type;
+        uint32_t size;
+    };
+    static constexpr EraseCase erase_cases[]{
+        {flash::EraseType::SECTOR_4K, 0x1000},
+        {flash::EraseType::BLOCK_32K, 0x8000},
+        {flash::EraseType::BLOCK_64K, 0x10000},
+    };
+    for(const auto& erase_case : erase_cases)
+    {
+        const uint32_t typical_ms{erase_timing.get(erase_case.type)};
+        if(typical_ms == 0)
+        {
+            NRF_LOG_INFO("erase %d B: not supported", erase_case.size);
+            continue;
+        }
+        LatencySamples erases;
+        for(uint32_t i = 0; i < erases_count; ++i)
+        {
+            const uint32_t address{area_start + (i * erase_case.size) % area_size};
+            // erase of an already erased area may be shorter, so it's programmed before
+            flash.program(address, data, page_size);
+            wait_while_busy(flash, 0);
+
+            const uint32_t start{common::CycleCounter::now()};
+            const auto result = (erase_case.type == flash::EraseType::SECTOR_4K)   ? flash.eraseSector(address)
+                                : (erase_case.type == flash::EraseType::BLOCK_32K) ? flash.erase32KBlock(address)
+                                                                                   : flash.erase64KBlock(address);
+            if(result != memory::SpiNorFlashIf::Result::OK)
+            {
+                NRF_LOG_ERROR("memtest: erase %d B has failed", erase_case.size);
+                break;
+            }
+            wait_while_busy(flash, typical_ms);
+            erases.add(common::CycleCounter::now() - start, erase_case.size);
+        }
+        report_latency("erase", erase_case.size, erases);
+    }
+
+    // test area of test 2 is a part of the benchmark area, it is left erased
+    flash.erase(area_start, area_size);
+}
+
 } // namespace memory
\ No newline at end of file
@@ -22,9 +22,9 @@ static bool _is_files_list_next_needed{false};
 static constexpr uint32_t invalid_files_count{0xFEFEFEFDUL};
 static uint32_t _total_files_left{0};
 
-result::Result init_fs(::filesystem::myfs_t& fs)
+// Repair, full FS and formatting are handled the same way for the first mount and the remount
+static result::Result complete_mount(::filesystem::myfs_t& fs, int err)
 {
-    auto err = myfs_mount(fs);
     if (err == ::filesystem::REPAIR_HAS_BEEN_PERFORMED)
     {
         myfs_unmount(fs);
@@ -59,6 +59,25 @@ result::Result init_fs(::filesystem::myfs_t& fs)
     return result::Result::OK;
 }
 
+result::Result init_fs(::filesystem::myfs_t& fs)
+{
+    return complete_mount(fs, myfs_mount(fs));
+}
+
+result::Result remount_fs(::filesystem::myfs_t& fs)
+{
+    if(_active_file.is_open)
+    {
+        const auto close_result = close_file(fs);
+        if(result::Result::OK != close_result)
+        {
+            NRF_LOG_ERROR("failed to close active file at remount stage");
+        }
+        _active_file.is_open = false;
+    }
+    return complete_mount(fs, myfs_remount(fs));
+}
+
 result::Result deinit_fs(::filesystem::myfs_t& fs)
 {
     if(_active_file.is_open)
@@ -320,7 +339,7 @@ result::Result get_fs_stat(::filesystem::myfs_t& fs, uint8_t* buffer)
     }
     fs_stat.files_count = files_count;
     fs_stat.occupied_space = occupied_space;
-    fs_stat.free_space = fs.config.block_count * 4096 - occupied_space;
+    fs_stat.free_space = fs.config.block_count * fs.config.block_size - occupied_space;
     memcpy(buffer, &fs_stat, sizeof(fs_stat));
     
     return result::Result::OK;
@@ -352,6 +371,51 @@ result::Result create_file(::filesystem::myfs_t& fs, uint8_t* file_id)
     return result::Result::OK;
 }
 
+result::Result pause_file(::filesystem::myfs_t& fs)
+{
+    if (!_active_file.is_open)
+    {
+        NRF_LOG_WARNING("myfs: attempt to pause unopened file");
+        return result::Result::OK;
+    }
+    const auto pause_result = myfs_file_pause(fs, _active_file);
+    if(pause_result < 0)
+    {
+        NRF_LOG_ERROR("failed to pause active file (%d)", pause_result);
+        return result::Result::ERROR_GENERAL;
+    }
+
+    _active_file.is_open = false;
+    return result::Result::OK;
+}
+
+result::Result append_file(::filesystem::myfs_t& fs, uint8_t* file_id)
+{
+    if (nullptr == file_id)
+    {
+        return result::Result::ERROR_GENERAL;
+    }
+    const auto append_res = myfs_file_open(fs, _active_file, file_id, ::filesystem::MYFS_APPEND_FLAG);
+    if(append_res < 0)
+    {
+        NRF_LOG_WARNING("failed to reopen paused file(error %d)", append_res);
+        return result::Result::ERROR_GENERAL;
+    }
+    _active_file.is_open = true;
+    return result::Result::OK;
+}
+
+result::Result finalize_paused_file(::filesystem::myfs_t& fs)
+{
+    const auto finalize_res = myfs_finalize_paused_file(fs);
+    if(finalize_res < 0)
+    {
+        NRF_LOG_ERROR("failed to finalize paused file(error %d)", finalize_res);
+        return result::Result::ERROR_GENERAL;
+    }
+    return result::Result::OK;
+}
+
 result::Result write_data(::filesystem::myfs_t& fs, uint8_t* data, uint32_t data_size)
 {
     if (nullptr == data)
@@ -16,6 +16,8 @@ namespace filesystem
 
 result::Result init_fs(::filesystem::myfs_t& fs);
 result::Result deinit_fs(::filesystem::myfs_t& fs);
+/// Mount for a new owner, the paused record stays appendable (see myfs_remount)
+result::Result remount_fs(::filesystem::myfs_t& fs);
 result::Result close_file(::filesystem::myfs_t& fs);
 
 // Following methods face into the BLE part of the system
@@ -38,6 +40,9 @@ result::Result get_fs_stat(::filesystem::myfs_t& fs, uint8_t* buffer);
 
 // Following methods face into audio part of the system
 result::Result create_file(::filesystem::myfs_t& fs, uint8_t* file_id);
+result::Result pause_file(::filesystem::myfs_t& fs);
+result::Result append_file(::filesystem::myfs_t& fs, uint8_t* file_id);
+result::Result finalize_paused_file(::filesystem::myfs_t& fs);
 result::Result write_data(::filesystem::myfs_t& fs, uint8_t* data, uint32_t data_size);
 
 void convert_filename_to_myfs_id(const char* name, uint8_t * file_id);
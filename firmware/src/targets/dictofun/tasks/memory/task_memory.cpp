@@ -7,11 +7,15 @@
 #include "nrf_log.h"
 
 #include "FreeRTOS.h"
+#include "semphr.h"
 #include "task.h"
 
 #include "boards.h"
 #include "myfs_access.h"
+#include "page_cache.h"
+#include "shared_flash.h"
 #include "spi_flash.h"
+#include "verifying_flash.h"
 #include <cstdio>
 #include <cstdlib>
 // TODO: this dependency here is really bad
@@ -22,8 +26,10 @@
 #include "task_rtc.h"
 
 #include "time_profiler.h"
+#include "io_stats.h"
 
 #include "myfs.h"
+#include "myfs_fsck.h"
 #include "block_api_myfs.h"
 
 namespace memory
@@ -31,20 +37,58 @@ namespace memory
 
 spi::Spi flash_spi(0, SPI_FLASH_CS_PIN);
 
-static const spi::Spi::Configuration flash_spi_config{NRF_DRV_SPI_FREQ_8M,
-                                                      NRF_DRV_SPI_MODE_0,
-                                                      NRF_DRV_SPI_BIT_ORDER_MSB_FIRST,
+static const spi::Spi::Configuration flash_spi_config{NRF_SPIM_FREQ_8M,
+                                                      NRF_SPIM_MODE_0,
+                                                      NRF_SPIM_BIT_ORDER_MSB_FIRST,
                                                       SPI_FLASH_SCK_PIN,
                                                       SPI_FLASH_MOSI_PIN,
                                                       SPI_FLASH_MISO_PIN};
 
 flash::SpiFlash flash{flash_spi, vTaskDelay, xTaskGetTickCount};
-constexpr uint32_t flash_page_size{256};
-constexpr uint32_t flash_sector_size{4096};
-constexpr uint32_t flash_total_size{16 * 1024 * 1024 - flash_sector_size};
-constexpr uint32_t flash_sectors_count{flash_total_size / flash_sector_size};
 
-constexpr size_t CACHE_SIZE{flash_page_size};
+// Other tasks access the flash through the shared layer, the mutex has priority inheritance,
+// so a low priority owner is not preempted while it holds the chip
+static StaticSemaphore_t flash_mutex_buffer;
+static SemaphoreHandle_t flash_mutex{nullptr};
+static void lock_flash()
+{
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+}
+static void unlock_flash()
+{
+    xSemaphoreGive(flash_mutex);
+}
+flash::SharedFlash shared_flash{flash, lock_flash, unlock_flash, vTaskDelay};
+static bool is_shared_flash_ready{false};
+// Audio records go through the file system, so its accesses always win. The window is set once the geometry is known.
+flash::SharedFlash::Client fs_flash{shared_flash, flash::SharedFlash::Priority::HIGH, 0, 0};
+
+// Programs of the file system are read back and compared, a page that doesn't match is programmed again
+static constexpr bool is_program_verify_enabled{true};
+flash::VerifyingFlash verified_flash{fs_flash};
+// myfs accesses the flash through the cache, memtests that use the flash directly invalidate it
+flash::PageCache flash_cache{verified_flash};
+// Geometry is discovered at the start of the task, the last sector is kept out of the FS
+static memory::SpiNorFlashIf::Geometry flash_geometry{256, 4096, 16 * 1024 * 1024};
+static uint32_t flash_total_size{0};
+
+// SPI transaction end wakes the memory task up, instead of the task polling the transaction state every tick
+static StaticSemaphore_t flash_completion_semaphore_buffer;
+static SemaphoreHandle_t flash_completion_semaphore{nullptr};
+
+static bool wait_flash_completion(const uint32_t timeout_ticks)
+{
+    return pdTRUE == xSemaphoreTake(flash_completion_semaphore, timeout_ticks);
+}
+
+static void signal_flash_completion()
+{
+    BaseType_t is_higher_priority_task_woken{pdFALSE};
+    xSemaphoreGiveFromISR(flash_completion_semaphore, &is_higher_priority_task_woken);
+    portYIELD_FROM_ISR(is_higher_priority_task_woken);
+}
+
+constexpr size_t CACHE_SIZE{::filesystem::page_size};
 
 uint8_t myfs_prog_buffer[CACHE_SIZE];
 uint8_t myfs_read_buffer[CACHE_SIZE];
@@ -63,19 +107,23 @@ struct ::filesystem::myfs_config myfs_configuration = {
     .erase_multiple = memory::block_device::myfs_erase_multiple,
     .sync = memory::block_device::myfs_sync,
 
-    // block device configuration
+    // block device configuration (block size and count are set up from the discovered geometry)
     .read_size = 16,
-    .prog_size = flash_page_size,
-    .block_size = flash_sector_size,
-    .block_count = flash_sectors_count,
+    .prog_size = ::filesystem::page_size,
+    .block_size = 0,
+    .block_count = 0,
     .read_buffer = myfs_read_buffer,
     .prog_buffer = myfs_prog_buffer,
+    .table_size = 0,
 };
 
 ::filesystem::myfs_t myfs{myfs_configuration};
 
 constexpr uint32_t cmd_wait_idle_ticks{5};
 constexpr uint32_t cmd_wait_fast_ticks{1};
+// Deep power-down draws ~1 uA instead of tens of uA in standby. Release takes a few us (tRES1),
+// the record start path wakes the flash up in advance (see WAKE_UP_FLASH).
+constexpr uint32_t flash_idle_power_down_ticks{500};
 constexpr uint32_t ble_command_wait_ticks{5};
 constexpr uint32_t data_send_wait_ticks{10};
 constexpr uint32_t audio_data_wait_ticks{5};
@@ -85,8 +133,16 @@ constexpr uint32_t file_name_size_bytes{16UL};
 // This element allocated statically, as it's rather big (~260 bytes)
 ble::FileDataFromMemoryQueueElement data_queue_elem;
 
-// Single audio sample from audio module
-audio::CodecOutputType audio_data_queue_element;
+// Audio task signals, when the data ring holds a whole flash page of samples, so they are written in one go.
+// Smaller remainders are collected after audio_data_wait_ticks.
+static constexpr uint32_t audio_data_watermark_samples{::filesystem::page_size / sizeof(audio::CodecOutputType)};
+static StaticSemaphore_t audio_data_semaphore_buffer;
+static SemaphoreHandle_t audio_data_semaphore{nullptr};
+static void signal_audio_data()
+{
+    xSemaphoreGive(audio_data_semaphore);
+}
+static void write_audio_data(Context& context);
 
 static struct FileOperationContext
 {
@@ -98,12 +154,22 @@ char active_record_name[sizeof(ble::fts::file_id_type) + 1]{0};
 uint8_t active_record_id[::filesystem::myfs_file_t::id_size]{0};
 
 static uint32_t written_record_size{0};
+static TickType_t record_pause_tick{0};
+
+// fsck is performed in portions between other operations of the task
+static ::filesystem::myfs_fsck_cursor fsck_cursor;
+static ::filesystem::myfs_fsck_report fsck_report;
+static bool is_fsck_running{false};
+static TickType_t fsck_start_tick{0};
+constexpr uint32_t fsck_step_read_budget_bytes{4096};
+static void continue_fsck();
 static bool is_formatting_allowed{false};
 
 static bool is_ble_access_allowed();
 void process_request_from_ble(Context& context,
                               ble::CommandToMemory command_id,
-                              ble::fts::file_id_type file_id);
+                              ble::fts::file_id_type file_id,
+                              uint32_t arg);
 void process_request_from_state(Context& context, Command command_id, uint32_t arg0 = 0, uint32_t arg1 = 0);
 
 void task_memory(void* context_ptr)
@@ -113,15 +179,34 @@ void task_memory(void* context_ptr)
     CommandQueueElement command;
     ble::CommandToMemoryQueueElement command_from_ble;
 
+    flash_completion_semaphore = xSemaphoreCreateBinaryStatic(&flash_completion_semaphore_buffer);
+    flash_mutex = xSemaphoreCreateMutexStatic(&flash_mutex_buffer);
+    audio_data_semaphore = xSemaphoreCreateBinaryStatic(&audio_data_semaphore_buffer);
+    context.audio_data_ring->setWatermark(audio_data_watermark_samples, signal_audio_data);
     flash_spi.init(flash_spi_config);
     flash.init();
+    flash.setCompletionSignalling(wait_flash_completion, signal_flash_completion);
+    // recording and BLE transfer shall not stall behind a background erase
+    flash.enableEraseSuspend(true);
     flash.reset();
     uint8_t jedec_id[6];
     flash.readJedecId(jedec_id);
     NRF_LOG_INFO("memory id: %x-%x-%x", jedec_id[0], jedec_id[1], jedec_id[2]);
 
+    flash_geometry = flash.detectGeometry();
+    flash_total_size = flash_geometry.total_size - flash_geometry.sector_size;
+    myfs_configuration.block_size = flash_geometry.sector_size;
+    myfs_configuration.block_count = flash_total_size / flash_geometry.sector_size;
+    NRF_LOG_INFO("mem: %d sectors of %d bytes, FS table %d bytes",
+                 myfs_configuration.block_count,
+                 myfs_configuration.block_size,
+                 ::filesystem::myfs_get_table_size(myfs_configuration));
+
+    fs_flash.setWindow(0, flash_total_size);
+    verified_flash.setEnabled(is_program_verify_enabled);
+    is_shared_flash_ready = true;
     memory::block_device::myfs_register_flash_device(
-        &flash, flash_sector_size, flash_page_size, flash_total_size);
+        &flash_cache, flash_geometry.sector_size, flash_geometry.page_size, flash_total_size);
 
     const auto init_result = memory::filesystem::init_fs(myfs);
 
@@ -163,6 +248,23 @@ void task_memory(void* context_ptr)
         {
             process_request_from_state(context, command.command_id, command.args[0], command.args[1]);
         }
+        if(is_fsck_running && !_file_operation_context.is_file_open)
+        {
+            continue_fsck();
+        }
+        if(!is_fsck_running && !_file_operation_context.is_file_open && !flash.isPoweredDown())
+        {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::LOW};
+            flash.powerDownIfIdle(flash_idle_power_down_ticks);
+        }
+        if(myfs.is_file_paused && (xTaskGetTickCount() - record_pause_tick) >= context.record_append_window_ticks)
+        {
+            const auto finalize_result = memory::filesystem::finalize_paused_file(myfs);
+            if(result::Result::OK != finalize_result)
+            {
+                NRF_LOG_ERROR("mem: failed to finalize paused record");
+            }
+        }
         if(_memory_owner == MemoryOwner::BLE)
         {
             const auto cmd_from_ble_queue_receive_status =
@@ -171,58 +273,101 @@ void task_memory(void* context_ptr)
                               ble_command_wait_ticks);
             if(pdPASS == cmd_from_ble_queue_receive_status)
             {
-                process_request_from_ble(
-                    context, command_from_ble.command_id, command_from_ble.file_id);
+                process_request_from_ble(context,
+                                         command_from_ble.command_id,
+                                         command_from_ble.file_id,
+                                         command_from_ble.arg);
             }
         }
         else
         {
             if(_file_operation_context.is_file_open)
             {
-                BaseType_t audio_data_receive_status = pdTRUE;
-                while(audio_data_receive_status == pdTRUE)
+                xSemaphoreTake(audio_data_semaphore, audio_data_wait_ticks);
+                write_audio_data(context);
+            }
+        }
+    }
+}
+
+static void write_audio_data(Context& context)
+{
+    // samples are written straight from the ring and released afterwards, the producer keeps filling other slots
+    const audio::CodecOutputType* sample = context.audio_data_ring->peek();
+    while(nullptr != sample && _file_operation_context.is_file_open)
+    {
+        const auto write_result = memory::filesystem::write_data(myfs, sample->data, sizeof(sample->data));
+        context.audio_data_ring->pop();
+
+        if(result::Result::OK != write_result)
+        {
+            NRF_LOG_ERROR("mem: data write failed");
+            if (result::Result::ERROR_OUT_OF_MEMORY == write_result)
+            {
+                // close active file
+                const auto close_result = memory::filesystem::close_file(myfs);
+                if (result::Result::OK != close_result)
                 {
-                    audio_data_receive_status =
-                        xQueueReceive(context.audio_data_queue,
-                                      reinterpret_cast<void*>(&audio_data_queue_element),
-                                      audio_data_wait_ticks);
-                    if(pdPASS == audio_data_receive_status)
-                    {
-                        const auto write_result = memory::filesystem::write_data(
-                            myfs, audio_data_queue_element.data, sizeof(audio_data_queue_element));
-
-                        if(result::Result::OK != write_result)
-                        {
-                            NRF_LOG_ERROR("mem: data write failed");
-                            if (result::Result::ERROR_OUT_OF_MEMORY == write_result)
-                            {
-                                // close active file
-                                const auto close_result = memory::filesystem::close_file(myfs);
-                                if (result::Result::OK != close_result)
-                                {
-                                    NRF_LOG_ERROR("mem: file closure upon out of memory has failed");
-                                    // TODO: define action in this case
-                                    EventQueueElement response{Status::ERROR_FATAL};
-                                    xQueueSend(context.event_queue, reinterpret_cast<void *>(&response), 0);
-                                }
-                                else
-                                {
-                                    // signal task_state the error state
-                                    EventQueueElement response{Status::ERROR_OUT_OF_MEMORY};
-                                    xQueueSend(context.event_queue, reinterpret_cast<void *>(&response), 0);
-                                }
-                                _file_operation_context.is_file_open = false;
-                                myfs.is_full = true;
-                            }
-                        }
-                        else
-                        {
-                            written_record_size += sizeof(audio_data_queue_element);
-                        }
-                    }
+                    NRF_LOG_ERROR("mem: file closure upon out of memory has failed");
+                    // TODO: define action in this case
+                    EventQueueElement response{Status::ERROR_FATAL};
+                    xQueueSend(context.event_queue, reinterpret_cast<void *>(&response), 0);
                 }
+                else
+                {
+                    // signal task_state the error state
+                    EventQueueElement response{Status::ERROR_OUT_OF_MEMORY};
+                    xQueueSend(context.event_queue, reinterpret_cast<void *>(&response), 0);
+                }
+                _file_operation_context.is_file_open = false;
+                myfs.is_full = true;
             }
         }
+        else
+        {
+            written_record_size += sizeof(sample->data);
+        }
+        sample = context.audio_data_ring->peek();
+    }
+}
+
+static void continue_fsck()
+{
+    const auto step_result = ::filesystem::myfs_fsck_step(
+        myfs_configuration, fsck_cursor, fsck_report, fsck_step_read_budget_bytes);
+    if(step_result == 1)
+    {
+        return;
+    }
+    is_fsck_running = false;
+    if(step_result != 0)
+    {
+        NRF_LOG_ERROR("fsck: flash read failed (%d)", step_result);
+        return;
+    }
+    NRF_LOG_INFO("fsck: %d records, data end 0x%x, last unfinalized: %d",
+                 fsck_report.records_count,
+                 fsck_report.data_end_address,
+                 fsck_report.is_last_record_unfinalized);
+    NRF_LOG_INFO("fsck: %d bytes read in %d ticks",
+                 fsck_report.bytes_read,
+                 xTaskGetTickCount() - fsck_start_tick);
+    for(uint32_t i = 0; i < static_cast<uint32_t>(::filesystem::myfs_fsck_issue::COUNT); ++i)
+    {
+        if(fsck_report.issues[i] > 0)
+        {
+            NRF_LOG_WARNING("fsck: %s x%d",
+                            ::filesystem::myfs_fsck_issue_name(static_cast<::filesystem::myfs_fsck_issue>(i)),
+                            fsck_report.issues[i]);
+        }
+    }
+    if(::filesystem::myfs_fsck_is_clean(fsck_report))
+    {
+        NRF_LOG_INFO("fsck: clean");
+    }
+    else
+    {
+        NRF_LOG_WARNING("fsck: first issue at 0x%x", fsck_report.first_issue_location);
     }
 }
 
@@ -240,7 +385,8 @@ void convert_file_id_to_string(ble::fts::file_id_type file_id, char* buffer)
 
 void process_request_from_ble(Context& context,
                               ble::CommandToMemory command_id,
-                              ble::fts::file_id_type file_id)
+                              ble::fts::file_id_type file_id,
+                              uint32_t arg)
 {
     ble::StatusFromMemoryQueueElement status{ble::StatusFromMemory::OK, 0};
     if(!is_ble_access_allowed())
@@ -404,6 +550,33 @@ void process_request_from_ble(Context& context,
         is_formatting_allowed = true;
         break;
     }
+    case ble::CommandToMemory::GET_DIAGNOSTICS: {
+        const auto section =
+            static_cast<io_stats::Section>(arg & ble::diagnostics_section_mask);
+        const auto serialize_result =
+            io_stats::serialize(section,
+                                myfs,
+                                flash,
+                                flash_cache,
+                                verified_flash,
+                                *context.audio_data_ring,
+                                data_queue_elem.data,
+                                data_queue_elem.size,
+                                ble::FileDataFromMemoryQueueElement::element_max_size);
+        if(result::Result::OK != serialize_result)
+        {
+            NRF_LOG_ERROR("mem: failed to fetch diagnostics section %d", static_cast<int>(section));
+            status.status = ble::StatusFromMemory::ERROR_OTHER;
+            status.data_size = 0;
+            break;
+        }
+        if((arg & ble::diagnostics_reset_flag) != 0)
+        {
+            io_stats::reset(section, myfs, flash, flash_cache, verified_flash, *context.audio_data_ring);
+        }
+        status.data_size = data_queue_elem.size;
+        break;
+    }
     default: {
         NRF_LOG_ERROR("mem from ble: command %d not yet implemented", command_id);
         break;
@@ -442,6 +615,21 @@ void process_request_from_state(Context& context, const Command command_id, uint
             break;
         }
         case Command::CREATE_RECORD: {
+            // samples, that have not been consumed by the audio tester, don't belong to the record
+            context.audio_data_ring->clear();
+            if(myfs.is_file_paused && (xTaskGetTickCount() - record_pause_tick) < context.record_append_window_ticks)
+            {
+                const auto append_result = memory::filesystem::append_file(myfs, active_record_id);
+                if(result::Result::OK == append_result)
+                {
+                    NRF_LOG_DEBUG("continued record [%s]", active_record_name);
+                    _file_operation_context.is_file_open = true;
+                    StatusQueueElement response{Command::CREATE_RECORD, Status::OK};
+                    xQueueSend(context.status_queue, reinterpret_cast<void*>(&response), 0);
+                    break;
+                }
+                // paused record gets finalized by creation of the new one
+            }
             memory::generate_next_file_name(active_record_name, context);
             memory::filesystem::convert_filename_to_myfs_id(active_record_name, active_record_id);
             {
@@ -476,7 +664,13 @@ void process_request_from_state(Context& context, const Command command_id, uint
         case Command::CLOSE_WRITTEN_FILE: {
             NRF_LOG_INFO("mem: closing file");
             memory::TimeProfile tp("close_record");
-            const auto close_result = memory::filesystem::close_file(myfs);
+            // audio is stopped before the closure, the tail of the record is still in the ring
+            write_audio_data(context);
+            // record stays appendable for a while, its size is written after the window expires
+            const auto close_result = (context.record_append_window_ticks > 0)
+                                          ? memory::filesystem::pause_file(myfs)
+                                          : memory::filesystem::close_file(myfs);
+            record_pause_tick = xTaskGetTickCount();
             if(close_result != result::Result::OK)
             {
                 NRF_LOG_ERROR("myfs: failed to close file after writing");
@@ -491,15 +685,8 @@ void process_request_from_state(Context& context, const Command command_id, uint
             break;
         }
         case Command::SELECT_OWNER_BLE: {
-            const auto deinit_result = memory::filesystem::deinit_fs(myfs);
-            if(result::Result::OK != deinit_result)
-            {
-                NRF_LOG_ERROR("myfs: deinit failed");
-                StatusQueueElement response{Command::SELECT_OWNER_BLE, Status::ERROR_GENERAL};
-                xQueueSend(context.status_queue, reinterpret_cast<void*>(&response), 0);
-                break;
-            }
-            const auto init_result = memory::filesystem::init_fs(myfs);
+            // paused record survives the owner change, it's finalized when the append window expires
+            const auto init_result = memory::filesystem::remount_fs(myfs);
             if (result::Result::ERROR_OUT_OF_MEMORY == init_result)
             {
                 NRF_LOG_WARNING("mem: FS is full, but available for read operations and formatting");
@@ -519,15 +706,8 @@ void process_request_from_state(Context& context, const Command command_id, uint
             break;
         }
         case Command::SELECT_OWNER_AUDIO: {
-            const auto deinit_result = memory::filesystem::deinit_fs(myfs);
-            if(result::Result::OK != deinit_result)
-            {
-                NRF_LOG_ERROR("myfs: deinit failed");
-                StatusQueueElement response{Command::SELECT_OWNER_AUDIO, Status::ERROR_GENERAL};
-                xQueueSend(context.status_queue, reinterpret_cast<void*>(&response), 0);
-                break;
-            }
-            const auto init_result = memory::filesystem::init_fs(myfs);
+            // paused record survives the owner change, it's finalized when the append window expires
+            const auto init_result = memory::filesystem::remount_fs(myfs);
             if (result::Result::ERROR_OUT_OF_MEMORY == init_result)
             {
                 NRF_LOG_WARNING("mem: FS is full, Audio cannot become an owner of FS");
@@ -549,11 +729,15 @@ void process_request_from_state(Context& context, const Command command_id, uint
             break;
         }
         case Command::LAUNCH_TEST_1: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
             launch_test_1(flash);
+            flash_cache.invalidate();
             break;
         }
         case Command::LAUNCH_TEST_2: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
             launch_test_2(flash);
+            flash_cache.invalidate();
             break;
         }
         case Command::LAUNCH_TEST_3: {
@@ -565,7 +749,48 @@ void process_request_from_state(Context& context, const Command command_id, uint
             break;
         }
         case Command::LAUNCH_TEST_5: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
             launch_test_5(flash, arg0, arg1);
+            flash_cache.invalidate();
+            break;
+        }
+        case Command::LAUNCH_FLASH_BENCHMARK: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
+            launch_flash_benchmark(flash);
+            flash_cache.invalidate();
+            break;
+        }
+        case Command::LAUNCH_FLASH_QUEUE_TEST: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
+            launch_flash_queue_test(flash);
+            flash_cache.invalidate();
+            break;
+        }
+        case Command::LAUNCH_FLASH_THROUGHPUT_BENCHMARK: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
+            launch_flash_throughput_benchmark(flash);
+            flash_cache.invalidate();
+            break;
+        }
+        case Command::WAKE_UP_FLASH: {
+            flash::SharedFlash::Guard guard{shared_flash, flash::SharedFlash::Priority::HIGH};
+            flash.wakeUp();
+            break;
+        }
+        case Command::PRINT_IO_STATS: {
+            io_stats::print(myfs, flash, flash_cache, verified_flash, *context.audio_data_ring);
+            break;
+        }
+        case Command::RUN_FSCK: {
+            ::filesystem::myfs_fsck_begin(fsck_cursor, fsck_report, arg0);
+            is_fsck_running = true;
+            fsck_start_tick = xTaskGetTickCount();
+            NRF_LOG_INFO("mem: fsck started");
+            break;
+        }
+        case Command::RESET_IO_STATS: {
+            io_stats::reset(myfs, flash, flash_cache, verified_flash, *context.audio_data_ring);
+            NRF_LOG_INFO("mem: I/O statistics have been reset");
             break;
         }
         case Command::UNMOUNT_FS: {
@@ -573,7 +798,7 @@ void process_request_from_state(Context& context, const Command command_id, uint
             break;
         }
         case Command::PERFORM_MEMORY_CHECK: {
-            static constexpr uint32_t max_files_count{254};
+            const uint32_t max_files_count{::filesystem::myfs_get_files_capacity(myfs)};
             static constexpr float formatting_trigger_level{0.9};
             const auto fs_stat_result =
                 memory::filesystem::get_fs_stat(myfs, data_queue_elem.data);
@@ -689,4 +914,14 @@ void generate_next_file_name(char* name, const Context& context)
              response.content[0] % 60);
 }
 
+flash::SharedFlash* get_shared_flash()
+{
+    return is_shared_flash_ready ? &shared_flash : nullptr;
+}
+
+uint32_t get_shared_flash_area_start()
+{
+    return flash_total_size;
+}
+
 } // namespace memory
\ No newline at end of file
@@ -8,8 +8,10 @@
 #include "FreeRTOS.h"
 #include "queue.h"
 
+#include "shared_flash.h"
 #include "spi_flash.h"
 #include "myfs.h"
+#include "task_audio.h"
 
 namespace memory
 {
@@ -23,6 +25,16 @@ void launch_test_2(flash::SpiFlash& flash);
 
 void launch_test_3(myfs_t& myfs, const myfs_config& myfs_configuration);
 void launch_test_5(flash::SpiFlash& flash, const uint32_t range_start, const uint32_t range_end);
+void launch_flash_benchmark(flash::SpiFlash& flash);
+void launch_flash_queue_test(flash::SpiFlash& flash);
+void launch_flash_throughput_benchmark(flash::SpiFlash& flash);
+
+/// @brief Flash, that other tasks can access directly instead of sending requests to the memory task.
+///        Their clients have to be LOW priority and use the area after the file system.
+/// @return nullptr until the memory task has initialized the chip
+flash::SharedFlash* get_shared_flash();
+/// The area starts at this address and spans up to the end of the chip
+uint32_t get_shared_flash_area_start();
 
 struct Context;
 void generate_next_file_name(char* name, const Context& context);
@@ -43,6 +55,14 @@ enum class Command
     FORMAT_FS,
 
     LAUNCH_TEST_5, // memory range print
+    PRINT_IO_STATS,
+    RESET_IO_STATS,
+    RUN_FSCK,
+    LAUNCH_FLASH_BENCHMARK,
+    LAUNCH_FLASH_QUEUE_TEST,
+    LAUNCH_FLASH_THROUGHPUT_BENCHMARK,
+    // release the flash from deep power-down ahead of a predicted access (f.e. record start)
+    WAKE_UP_FLASH,
     NONE,
 };
 
@@ -77,7 +97,7 @@ struct EventQueueElement
 
 struct Context
 {
-    QueueHandle_t audio_data_queue{nullptr};
+    audio::DataRing* audio_data_ring{nullptr};
     QueueHandle_t command_queue{nullptr};
     QueueHandle_t status_queue{nullptr};
     QueueHandle_t event_queue{nullptr};
@@ -88,6 +108,9 @@ struct Context
     QueueHandle_t response_from_rtc_queue{nullptr};
 
     bool is_out_of_memory_detected{false};
+    // A record closed less than this amount of ticks ago is reopened by the next CREATE_RECORD
+    // and continued instead of creating a new one. 0 disables appending.
+    uint32_t record_append_window_ticks{5 * configTICK_RATE_HZ};
 };
 
 } // namespace memory
@@ -108,6 +108,7 @@ void task_system_state(void* context_ptr)
                 case button::ButtonState::PRESSED: 
                 {
                     // start preparing record
+                    request_flash_wake_up(*context);
                     context->system_state = SystemState::RECORD_PREPARE;
                     break;
                 }
@@ -137,6 +138,7 @@ void task_system_state(void* context_ptr)
                 const auto button_state = fetch_button_state(*context);
                 if (button_state == button::ButtonState::PRESSED)
                 {
+                    request_flash_wake_up(*context);
                     next_state = SystemState::RECORD_PREPARE;
                 }
                 if (xTaskGetTickCount() >= idle_ble_start_delay)
@@ -253,6 +255,7 @@ void task_system_state(void* context_ptr)
                     const auto button_state = fetch_button_state(*context);
                     if (button::ButtonState::PRESSED == button_state)
                     {
+                        request_flash_wake_up(*context);
                         // stop BLE subsystem
                         const auto disabling_result = disable_ble_subsystem(*context);
                         if (result::Result::OK != disabling_result)
@@ -464,6 +467,17 @@ void task_system_state(void* context_ptr)
     }
 }
 
+void request_flash_wake_up(const Context& context)
+{
+    // record creation follows shortly, its first flash access shouldn't wait for the release from deep power-down
+    memory::CommandQueueElement cmd{memory::Command::WAKE_UP_FLASH, {0, 0}};
+    const auto wake_up_res = xQueueSend(context.memory_commands_handle, reinterpret_cast<void*>(&cmd), 0);
+    if(wake_up_res != pdPASS)
+    {
+        NRF_LOG_WARNING("state: failed to request flash wake-up");
+    }
+}
+
 result::Result request_record_creation(const Context& context)
 {
     // First cleanup response from memory queue
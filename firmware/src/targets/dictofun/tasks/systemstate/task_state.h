@@ -147,6 +147,7 @@ bool process_timeouts(Context& context);
 result::Result enable_ble_subsystem(Context& context);
 result::Result disable_ble_subsystem(Context& context);
 
+void request_flash_wake_up(const Context& context);
 result::Result request_record_creation(const Context& context);
 result::Result request_record_start(Context& context);
 result::Result request_record_stop(const Context& context);
@@ -10,6 +10,7 @@ It allows to:
 - get information about any of the files on the device
 - get the file contents (from device to the user)
 - get status of the filesystem (free/occupied space, files' count)
+- get storage I/O diagnostics counters
 """
 class FtsClient:
     file_transfer_service_uuid = "a0451001-b822-4820-8782-bd8faf68807b"
@@ -20,6 +21,23 @@ class FtsClient:
     fts_file_data_char_uuid =    "00001005-0000-1000-8000-00805f9b34fb"
     fts_fs_status_char_uuid =    "00001006-0000-1000-8000-00805f9b34fb"
     fts_status_char_uuid =       "00001007-0000-1000-8000-00805f9b34fb"
+    fts_diagnostics_char_uuid =  "00001009-0000-1000-8000-00805f9b34fb"
+
+    diagnostics_section_filesystem = 0
+    diagnostics_section_flash = 1
+    diagnostics_section_page_cache = 2
+    diagnostics_section_program_verify = 3
+    diagnostics_section_flash_power = 4
+    diagnostics_section_audio_ring = 5
+    myfs_op_names = ["format", "mount", "create", "write", "close", "read", "meta"]
+    myfs_op_fields = ["calls", "reads", "programs", "erases", "bytes_read", "bytes_programmed"]
+    flash_command_names = ["read", "program", "erase_4k", "erase_64k", "erase_chip", "erase_suspend", "erase_32k"]
+    flash_command_fields = ["count", "bytes", "busy_wait_ticks", "retries"]
+    page_cache_fields = ["hits", "misses", "bypassed", "invalidations"]
+    program_verify_fields = ["verified_pages", "mismatches", "retries", "failures", "last_failure_address"]
+    flash_power_fields = ["power_downs", "early_wake_ups", "late_wake_ups", "wake_wait_us", "power_down_ticks",
+                          "observed_ticks"]
+    audio_ring_fields = ["pushed", "dropped", "high_water", "capacity"]
 
     values = {}
     pending_flags = {}
@@ -31,6 +49,8 @@ class FtsClient:
         self.data_char = dictofun.get_characteristic_by_uuid(self.fts_file_data_char_uuid)
         self.fs_status = dictofun.get_characteristic_by_uuid(self.fts_fs_status_char_uuid)
         self.status = dictofun.get_characteristic_by_uuid(self.fts_status_char_uuid)
+        # optional: older firmware versions don't provide diagnostics
+        self.diagnostics = dictofun.get_characteristic_by_uuid(self.fts_diagnostics_char_uuid)
         if self.cp_char is None  or self.list_char is None or self.data_char is None or self.fs_status is None or self.status is None:
             if self.cp_char is None:
                 logging.error("cp char not resolved")
@@ -98,6 +118,9 @@ class FtsClient:
 
     def _request_fs_status(self):
         self.cp_char.write_value(bytearray([4]))
+
+    def _request_diagnostics(self, section, reset):
+        self.cp_char.write_value(bytearray([7, section, 1 if reset else 0]))
     
     ##################### Implementation of parsers #################
     def _parse_files_count(self, array):
@@ -138,6 +161,46 @@ class FtsClient:
         fs_status["count"] = int.from_bytes(raw[10:13], "little")
         return fs_status
 
+    def _parse_u32_list(self, raw):
+        return [int.from_bytes(raw[i:i + 4], "little") for i in range(0, len(raw) - 3, 4)]
+
+    def _parse_diagnostics(self, raw):
+        section = raw[0]
+        values = self._parse_u32_list(raw[1:])
+        diagnostics = {}
+        if section == self.diagnostics_section_filesystem:
+            fields_count = len(self.myfs_op_fields)
+            for i, op in enumerate(self.myfs_op_names):
+                diagnostics[op] = dict(zip(self.myfs_op_fields, values[i * fields_count:(i + 1) * fields_count]))
+            totals = values[len(self.myfs_op_names) * fields_count:]
+            diagnostics["user_bytes_written"] = totals[0]
+            diagnostics["records_closed"] = totals[1]
+            programmed = sum(diagnostics[op]["bytes_programmed"] for op in self.myfs_op_names)
+            if diagnostics["user_bytes_written"] > 0:
+                diagnostics["write_amplification"] = programmed / diagnostics["user_bytes_written"]
+        elif section == self.diagnostics_section_flash:
+            fields_count = len(self.flash_command_fields)
+            for i, cmd in enumerate(self.flash_command_names):
+                diagnostics[cmd] = dict(zip(self.flash_command_fields, values[i * fields_count:(i + 1) * fields_count]))
+        elif section == self.diagnostics_section_page_cache:
+            diagnostics = dict(zip(self.page_cache_fields, values))
+            accesses = diagnostics["hits"] + diagnostics["misses"]
+            if accesses > 0:
+                diagnostics["hit_rate"] = diagnostics["hits"] / accesses
+        elif section == self.diagnostics_section_program_verify:
+            diagnostics = dict(zip(self.program_verify_fields, values))
+        elif section == self.diagnostics_section_flash_power:
+            diagnostics = dict(zip(self.flash_power_fields, values))
+            if diagnostics["observed_ticks"] > 0:
+                diagnostics["power_down_share"] = diagnostics["power_down_ticks"] / diagnostics["observed_ticks"]
+        elif section == self.diagnostics_section_audio_ring:
+            diagnostics = dict(zip(self.audio_ring_fields, values))
+            if diagnostics["capacity"] > 0:
+                diagnostics["max_fill_share"] = diagnostics["high_water"] / diagnostics["capacity"]
+        else:
+            logging.error("diagnostics: unknown section %d" % section)
+        return diagnostics
+
     ##################### Implementation of public API methods #################
     def get_files_list(self):
         self.list_char.enable_notifications()
@@ -259,3 +322,31 @@ class FtsClient:
         fs_status = self._parse_fs_status(raw)
         
         return fs_status
+
+    def get_diagnostics(self, section, reset=False):
+        if self.diagnostics is None:
+            logging.error("diagnostics: characteristic is not supported by the device")
+            return {}
+        self.diagnostics.enable_notifications()
+        time.sleep(0.5)
+        self.pending_flags[self.diagnostics.uuid] = False
+        self._request_diagnostics(section, reset)
+
+        received_data = bytearray([])
+        start_time = time.time()
+        transaction_timeout = 2
+        expected_size = None
+
+        while (expected_size is None or len(received_data) < expected_size) and time.time() - start_time < transaction_timeout:
+            if self.pending_flags[self.diagnostics.uuid]:
+                received_data += self.values[self.diagnostics.uuid]
+                self.pending_flags[self.diagnostics.uuid] = False
+                if expected_size is None:
+                    expected_size = self._parse_json_size(received_data) + 2
+            time.sleep(0.01)
+
+        if expected_size is None or len(received_data) < expected_size:
+            logging.error("diagnostics: transaction timeout")
+            return {}
+
+        return self._parse_diagnostics(received_data[2:expected_size])